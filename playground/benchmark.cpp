@@ -0,0 +1,1312 @@
+#include <benchmark/benchmark.h>
+#include <date/date.h>
+#include <date/tz.h>
+#include "business_calendar.h"
+#include "calendar_buckets.h"
+#include "civil_batch.h"
+#include "current_zone_cache.h"
+#include "duration_batch.h"
+#include "fast_clock.h"
+#include "leap_second_cursor.h"
+#include "local_to_sys.h"
+#include "metrics.h"
+#include "packed_zoned_time.h"
+#include "recurrence.h"
+#include "static_zones.h"
+#include "timestamp_codec.h"
+#include "timestamp_from_chars.h"
+#include "timestamp_to_chars.h"
+#include "timing_wheel.h"
+#include "tzdb_image.h"
+#include "tzdb_rcu.h"
+#include "zone_pair_converter.h"
+#include "zone_registry.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <queue>
+#include <random>
+#include <sstream>
+#include <utility>
+#include <string>
+#include <vector>
+
+using namespace date;
+using namespace date::literals;
+using namespace std::chrono;
+using namespace std::chrono_literals;
+
+// all inputs are generated from a fixed seed so that two runs of the
+// same binary measure exactly the same values
+// mt19937_64's output sequence is specified by the standard
+// the distributions are not, so they are avoided on purpose
+static constexpr std::uint64_t bench_seed = 19860930;
+static constexpr std::size_t bench_size = 1 << 16;
+
+static std::vector<sys_days> make_sys_days(int first_year, int last_year)
+{
+    const auto first = sys_days{year{first_year} / jan / 1}.time_since_epoch().count();
+    const auto last  = sys_days{year{last_year}  / jan / 1}.time_since_epoch().count();
+    const auto range = static_cast<std::uint64_t>(last - first);
+
+    std::mt19937_64 gen{bench_seed};
+    std::vector<sys_days> v(bench_size);
+    for(auto& d : v)
+        d = sys_days{days{first + static_cast<days::rep>(gen() % range)}};
+    return v;
+}
+
+static std::vector<year_month_day> make_ymds(int first_year, int last_year)
+{
+    const auto sd = make_sys_days(first_year, last_year);
+    return std::vector<year_month_day>(sd.begin(), sd.end());
+}
+
+template<class Duration>
+static std::vector<sys_time<Duration>> make_sys_times(int first_year, int last_year)
+{
+    const auto sd = make_sys_days(first_year, last_year);
+    const auto day = static_cast<std::uint64_t>(Duration{days{1}}.count());
+
+    std::mt19937_64 gen{bench_seed + 1};
+    std::vector<sys_time<Duration>> v;
+    v.reserve(sd.size());
+    for(const auto& d : sd)
+        v.push_back(d + Duration{static_cast<typename Duration::rep>(gen() % day)});
+    return v;
+}
+
+template<class Duration>
+static std::vector<local_time<Duration>> make_local_times(int first_year, int last_year)
+{
+    const auto st = make_sys_times<Duration>(first_year, last_year);
+    std::vector<local_time<Duration>> v;
+    v.reserve(st.size());
+    for(const auto& t : st)
+        v.push_back(local_time<Duration>{t.time_since_epoch()});
+    return v;
+}
+
+// year_month_day{sys_days}
+// args: first year, last year (exclusive) of the inputs
+static void ymd_from_sys_days(benchmark::State& state)
+{
+    const auto in = make_sys_days(static_cast<int>(state.range(0)), static_cast<int>(state.range(1)));
+    std::size_t i = 0;
+    for(auto _ : state)
+    {
+        const auto ymd = year_month_day{in[i++ & (bench_size - 1)]};
+        benchmark::DoNotOptimize(ymd);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(ymd_from_sys_days)
+    ->Args({1970, 1971})
+    ->Args({1900, 1970})
+    ->Args({1600, 2400});
+
+// sys_days{year_month_day}
+static void sys_days_from_ymd(benchmark::State& state)
+{
+    const auto in = make_ymds(static_cast<int>(state.range(0)), static_cast<int>(state.range(1)));
+    std::size_t i = 0;
+    for(auto _ : state)
+    {
+        const auto sd = sys_days{in[i++ & (bench_size - 1)]};
+        benchmark::DoNotOptimize(sd);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(sys_days_from_ymd)
+    ->Args({1970, 1971})
+    ->Args({1900, 1970})
+    ->Args({1600, 2400});
+
+// batch year_month_day from sys_days into structure of arrays
+// args: first year, last year (exclusive), simd_isa
+static void ymd_from_sys_days_batch(benchmark::State& state)
+{
+    const auto in = make_sys_days(static_cast<int>(state.range(0)), static_cast<int>(state.range(1)));
+    const auto isa = static_cast<chrono_date::simd_isa>(state.range(2));
+    if(!chrono_date::is_supported(isa))
+    {
+        state.SkipWithError("isa not supported by this cpu");
+        return;
+    }
+    std::vector<std::int16_t> y(bench_size);
+    std::vector<std::uint8_t> m(bench_size);
+    std::vector<std::uint8_t> d(bench_size);
+    for(auto _ : state)
+    {
+        chrono_date::to_ymd(isa, in.data(), in.size(), {y.data(), m.data(), d.data()});
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(bench_size));
+    state.SetLabel(chrono_date::to_string(isa));
+}
+BENCHMARK(ymd_from_sys_days_batch)
+    ->ArgsProduct({{1600}, {2400}, {0, 1, 2, 3}});
+
+// batch sys_days from structure of arrays year_month_day
+static void sys_days_from_ymd_batch(benchmark::State& state)
+{
+    const auto ymds = make_ymds(static_cast<int>(state.range(0)), static_cast<int>(state.range(1)));
+    const auto isa = static_cast<chrono_date::simd_isa>(state.range(2));
+    if(!chrono_date::is_supported(isa))
+    {
+        state.SkipWithError("isa not supported by this cpu");
+        return;
+    }
+    std::vector<std::int16_t> y;
+    std::vector<std::uint8_t> m;
+    std::vector<std::uint8_t> d;
+    for(const auto& ymd : ymds)
+    {
+        y.push_back(static_cast<std::int16_t>(static_cast<int>(ymd.year())));
+        m.push_back(static_cast<std::uint8_t>(static_cast<unsigned>(ymd.month())));
+        d.push_back(static_cast<std::uint8_t>(static_cast<unsigned>(ymd.day())));
+    }
+    std::vector<sys_days> out(bench_size);
+    for(auto _ : state)
+    {
+        chrono_date::to_sys_days(isa, {y.data(), m.data(), d.data()}, bench_size, out.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(bench_size));
+    state.SetLabel(chrono_date::to_string(isa));
+}
+BENCHMARK(sys_days_from_ymd_batch)
+    ->ArgsProduct({{1600}, {2400}, {0, 1, 2, 3}});
+
+// year_month_day as structure of arrays, the inputs repeated up to n
+struct bench_ymd_columns
+{
+    std::vector<std::int16_t> year;
+    std::vector<std::uint8_t> month;
+    std::vector<std::uint8_t> day;
+
+    chrono_date::const_ymd_columns columns() const
+    {
+        return {year.data(), month.data(), day.data()};
+    }
+};
+
+static bench_ymd_columns make_ymd_columns(const std::vector<year_month_day>& ymds, std::size_t n)
+{
+    bench_ymd_columns c;
+    for(std::size_t i = 0; i < n; ++i)
+    {
+        const auto& ymd = ymds[i % ymds.size()];
+        c.year.push_back(static_cast<std::int16_t>(static_cast<int>(ymd.year())));
+        c.month.push_back(static_cast<std::uint8_t>(static_cast<unsigned>(ymd.month())));
+        c.day.push_back(static_cast<std::uint8_t>(static_cast<unsigned>(ymd.day())));
+    }
+    return c;
+}
+
+// ages in whole years and the days since the last birthday, of birthdays
+// in [1920, 2010) on days in [2020, 2030); one by one like calc_age
+static void age_by_calc_age(benchmark::State& state)
+{
+    const auto birth = make_ymds(1920, 2010);
+    const auto today = make_ymds(2020, 2030);
+    std::vector<std::int32_t> y(bench_size);
+    std::vector<std::int32_t> d(bench_size);
+    for(auto _ : state)
+    {
+        for(std::size_t i = 0; i < bench_size; ++i)
+        {
+            const auto age = floor<years>(today[i].year() / today[i].month() - birth[i].year() / birth[i].month() -
+                                          months{today[i].day() < birth[i].day()});
+            const auto birthday = birth[i].year() / birth[i].month() + age;
+            const auto last_day = (birthday / last).day();
+            y[i] = age.count();
+            d[i] = (sys_days{today[i]} -
+                    sys_days{birthday / (birth[i].day() < last_day ? birth[i].day() : last_day)}).count();
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(bench_size));
+}
+BENCHMARK(age_by_calc_age);
+
+// the same in batches
+// args: simd_isa
+static void age_batch(benchmark::State& state)
+{
+    const auto birth = make_ymd_columns(make_ymds(1920, 2010), bench_size);
+    const auto today = make_ymd_columns(make_ymds(2020, 2030), bench_size);
+    const auto isa = static_cast<chrono_date::simd_isa>(state.range(0));
+    if(!chrono_date::is_supported(isa))
+    {
+        state.SkipWithError("isa not supported by this cpu");
+        return;
+    }
+    std::vector<std::int32_t> y(bench_size);
+    std::vector<std::int32_t> d(bench_size);
+    for(auto _ : state)
+    {
+        chrono_date::calendar_difference(isa, birth.columns(), today.columns(), bench_size,
+                                         chrono_date::difference_unit::years, {y.data(), nullptr, d.data()});
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(bench_size));
+    state.SetLabel(chrono_date::to_string(isa));
+}
+BENCHMARK(age_batch)
+    ->DenseRange(0, 3);
+
+// the same for 4Mi dates on a number of threads
+// args: threads
+static void age_batch_parallel(benchmark::State& state)
+{
+    const std::size_t n = 1 << 22;
+    const auto birth = make_ymd_columns(make_ymds(1920, 2010), n);
+    const auto today = make_ymd_columns(make_ymds(2020, 2030), n);
+    const auto threads = static_cast<unsigned>(state.range(0));
+    std::vector<std::int32_t> y(n);
+    std::vector<std::int32_t> d(n);
+    for(auto _ : state)
+    {
+        chrono_date::parallel_calendar_difference(birth.columns(), today.columns(), n,
+                                                  chrono_date::difference_unit::years, {y.data(), nullptr, d.data()},
+                                                  threads);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(n));
+}
+BENCHMARK(age_batch_parallel)
+    ->RangeMultiplier(2)
+    ->Range(1, 8)
+    ->UseRealTime();
+
+// make_time on the time of day of a time_point
+template<class Duration>
+static void make_time_of_day(benchmark::State& state)
+{
+    const auto in = make_sys_times<Duration>(1970, 2038);
+    std::size_t i = 0;
+    for(auto _ : state)
+    {
+        const auto tp = in[i++ & (bench_size - 1)];
+        const auto hms = make_time(tp - floor<days>(tp));
+        benchmark::DoNotOptimize(hms);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_TEMPLATE(make_time_of_day, seconds);
+BENCHMARK_TEMPLATE(make_time_of_day, milliseconds);
+BENCHMARK_TEMPLATE(make_time_of_day, microseconds);
+
+// operator<< on a sys_time, the way the "stream time_point" test does it
+template<class Duration>
+static void stream_sys_time(benchmark::State& state)
+{
+    const auto in = make_sys_times<Duration>(1970, 2038);
+    std::size_t i = 0;
+    for(auto _ : state)
+    {
+        std::stringstream str;
+        str << in[i++ & (bench_size - 1)];
+        benchmark::DoNotOptimize(str.str());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_TEMPLATE(stream_sys_time, seconds);
+BENCHMARK_TEMPLATE(stream_sys_time, milliseconds);
+
+// the same output written into a stack buffer without allocation or locale
+template<class Duration>
+static void to_chars_sys_time(benchmark::State& state)
+{
+    const auto in = make_sys_times<Duration>(1970, 2038);
+    std::size_t i = 0;
+    char buffer[64];
+    for(auto _ : state)
+    {
+        const auto r = chrono_date::to_chars(buffer, buffer + sizeof buffer, in[i++ & (bench_size - 1)]);
+        benchmark::DoNotOptimize(r.ptr);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_TEMPLATE(to_chars_sys_time, seconds);
+BENCHMARK_TEMPLATE(to_chars_sys_time, milliseconds);
+
+// formatted timestamps of the sys times of make_sys_times, one per line
+template<class Duration>
+static std::string make_timestamp_lines()
+{
+    std::string lines;
+    for(const auto& t : make_sys_times<Duration>(1970, 2038))
+    {
+        std::stringstream str;
+        str << t << '\n';
+        lines += str.str();
+    }
+    return lines;
+}
+
+template<class Duration>
+static std::vector<std::string> make_timestamps()
+{
+    std::vector<std::string> v;
+    std::stringstream str{make_timestamp_lines<Duration>()};
+    for(std::string line; std::getline(str, line);)
+        v.push_back(line);
+    return v;
+}
+
+// parsing timestamps back with date::parse from a stream
+template<class Duration>
+static void stream_parse_sys_time(benchmark::State& state)
+{
+    const auto in = make_timestamps<Duration>();
+    std::size_t i = 0;
+    for(auto _ : state)
+    {
+        std::istringstream str{in[i++ & (bench_size - 1)]};
+        sys_time<Duration> tp;
+        str >> parse("%F %T", tp);
+        benchmark::DoNotOptimize(tp);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_TEMPLATE(stream_parse_sys_time, seconds);
+BENCHMARK_TEMPLATE(stream_parse_sys_time, milliseconds);
+
+// the same with from_chars, scalar and with the vectorized prefix
+template<class Duration>
+static void from_chars_sys_time(benchmark::State& state)
+{
+    const auto isa = static_cast<chrono_date::simd_isa>(state.range(0));
+    if(!chrono_date::is_supported(isa))
+    {
+        state.SkipWithError("isa not supported by this cpu");
+        return;
+    }
+    const auto in = make_timestamps<Duration>();
+    std::size_t i = 0;
+    for(auto _ : state)
+    {
+        const auto& s = in[i++ & (bench_size - 1)];
+        sys_time<Duration> tp;
+        chrono_date::from_chars(isa, s.data(), s.data() + s.size(), tp);
+        benchmark::DoNotOptimize(tp);
+    }
+    state.SetLabel(chrono_date::to_string(isa));
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_TEMPLATE(from_chars_sys_time, seconds)
+    ->Arg(static_cast<int>(chrono_date::simd_isa::generic))
+    ->Arg(static_cast<int>(chrono_date::simd_isa::sse4_1));
+BENCHMARK_TEMPLATE(from_chars_sys_time, milliseconds)
+    ->Arg(static_cast<int>(chrono_date::simd_isa::generic))
+    ->Arg(static_cast<int>(chrono_date::simd_isa::sse4_1));
+
+// a whole buffer of newline separated timestamps at once
+template<class Duration>
+static void lines_from_chars_sys_time(benchmark::State& state)
+{
+    const auto isa = static_cast<chrono_date::simd_isa>(state.range(0));
+    if(!chrono_date::is_supported(isa))
+    {
+        state.SkipWithError("isa not supported by this cpu");
+        return;
+    }
+    const auto in = make_timestamp_lines<Duration>();
+    std::vector<sys_time<Duration>> out(bench_size);
+    for(auto _ : state)
+    {
+        const auto r = chrono_date::lines_from_chars(isa, in.data(), in.data() + in.size(), out.data(), out.size());
+        benchmark::DoNotOptimize(r.count);
+        benchmark::ClobberMemory();
+    }
+    state.SetLabel(chrono_date::to_string(isa));
+    state.SetItemsProcessed(state.iterations() * bench_size);
+    state.SetBytesProcessed(state.iterations() * in.size());
+}
+BENCHMARK_TEMPLATE(lines_from_chars_sys_time, milliseconds)
+    ->Arg(static_cast<int>(chrono_date::simd_isa::generic))
+    ->Arg(static_cast<int>(chrono_date::simd_isa::sse4_1));
+
+// cold tzdb: the very first use of the database in this process
+// only meaningful when it is the first tz benchmark that runs, and only
+// once, further repetitions would measure a warm get_tzdb();
+// run_chrono_date_benchmark also runs it alone in a process of its own
+static void tzdb_first_use(benchmark::State& state)
+{
+    for(auto _ : state)
+        benchmark::DoNotOptimize(&get_tzdb());
+}
+BENCHMARK(tzdb_first_use)
+    ->Iterations(1)
+    ->Repetitions(1)
+    ->Unit(benchmark::kMillisecond);
+
+// cold tzdb: parsing the whole database again
+// every reload keeps the previous database alive, hence the fixed
+// iterations and the single repetition
+static void tzdb_reload(benchmark::State& state)
+{
+    for(auto _ : state)
+        benchmark::DoNotOptimize(&reload_tzdb());
+}
+BENCHMARK(tzdb_reload)
+    ->Iterations(10)
+    ->Repetitions(1)
+    ->Unit(benchmark::kMillisecond);
+
+// local to sys for a sorted day of events every few seconds around a dst change
+// one to_sys(choose) per event against bulk_to_sys with its cursor
+static std::vector<local_seconds> make_dst_day()
+{
+    std::vector<local_seconds> v;
+    const auto first = local_seconds{local_days{2016_y / oct / 30} - 12h};
+    for(auto t = first; t < first + days{1}; t += 2s)
+        v.push_back(t);
+    return v;
+}
+
+static void local_to_sys_one_by_one(benchmark::State& state)
+{
+    const auto tz = locate_zone("Europe/Berlin");
+    const auto in = make_dst_day();
+    std::vector<sys_seconds> out(in.size());
+    for(auto _ : state)
+    {
+        for(std::size_t i = 0; i < in.size(); ++i)
+            out[i] = tz->to_sys(in[i], choose::earliest);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(in.size()));
+}
+BENCHMARK(local_to_sys_one_by_one)
+    ->Unit(benchmark::kMicrosecond);
+
+static void local_to_sys_bulk(benchmark::State& state)
+{
+    const auto tz = locate_zone("Europe/Berlin");
+    auto in = make_dst_day();
+    if(state.range(0) != 0)
+        std::shuffle(in.begin(), in.end(), std::mt19937_64{bench_seed});
+    std::vector<sys_seconds> out(in.size());
+    for(auto _ : state)
+    {
+        chrono_date::bulk_to_sys(tz, in.data(), in.size(), out.data(), choose::earliest);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(in.size()));
+    state.SetLabel(state.range(0) != 0 ? "shuffled" : "sorted");
+}
+BENCHMARK(local_to_sys_bulk)
+    ->Arg(0)
+    ->Arg(1)
+    ->Unit(benchmark::kMicrosecond);
+
+// the same one by one conversion on the generated rules of the zone
+static void local_to_sys_static_zone(benchmark::State& state)
+{
+    const auto& tz = chrono_date::static_zones::europe_berlin;
+    const auto in = make_dst_day();
+    std::vector<sys_seconds> out(in.size());
+    for(auto _ : state)
+    {
+        for(std::size_t i = 0; i < in.size(); ++i)
+            out[i] = tz.to_sys(in[i], choose::earliest);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(in.size()));
+}
+BENCHMARK(local_to_sys_static_zone)
+    ->Unit(benchmark::kMicrosecond);
+
+// a sorted telemetry stream from 1970 to 2038 converted to utc
+static std::vector<sys_time<milliseconds>> make_sorted_sys_times()
+{
+    auto v = make_sys_times<milliseconds>(1970, 2038);
+    std::sort(v.begin(), v.end());
+    return v;
+}
+
+static void to_utc_time_one_by_one(benchmark::State& state)
+{
+    const auto in = make_sorted_sys_times();
+    std::vector<date::utc_time<milliseconds>> out(in.size());
+    for(auto _ : state)
+    {
+        for(std::size_t i = 0; i < in.size(); ++i)
+            out[i] = to_utc_time(in[i]);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(in.size()));
+}
+BENCHMARK(to_utc_time_one_by_one)
+    ->Unit(benchmark::kMicrosecond);
+
+static void to_utc_time_cursor(benchmark::State& state)
+{
+    const auto in = make_sorted_sys_times();
+    std::vector<date::utc_time<milliseconds>> out(in.size());
+    for(auto _ : state)
+    {
+        chrono_date::to_utc_time(in.data(), in.size(), out.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(in.size()));
+}
+BENCHMARK(to_utc_time_cursor)
+    ->Unit(benchmark::kMicrosecond);
+
+static void to_sys_time_cursor(benchmark::State& state)
+{
+    std::vector<date::utc_time<milliseconds>> in;
+    for(const auto& st : make_sorted_sys_times())
+        in.push_back(to_utc_time(st));
+    std::vector<sys_time<milliseconds>> out(in.size());
+    for(auto _ : state)
+    {
+        chrono_date::to_sys_time(in.data(), in.size(), out.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(in.size()));
+}
+BENCHMARK(to_sys_time_cursor)
+    ->Unit(benchmark::kMicrosecond);
+
+// months of Europe/Berlin a stream of events from 1970 to 2038 falls into
+static void bucket_months_make_zoned(benchmark::State& state)
+{
+    const auto zone = locate_zone("Europe/Berlin");
+    const auto in = make_sys_times<milliseconds>(1970, 2038);
+    std::vector<year_month> out(in.size());
+    for(auto _ : state)
+    {
+        for(std::size_t i = 0; i < in.size(); ++i)
+        {
+            const auto ymd = year_month_day{floor<days>(make_zoned(zone, in[i]).get_local_time())};
+            out[i] = ymd.year() / ymd.month();
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(in.size()));
+}
+BENCHMARK(bucket_months_make_zoned)
+    ->Unit(benchmark::kMicrosecond);
+
+// the same with precomputed edges, on 1 to 8 threads
+static void bucket_months_calendar_buckets(benchmark::State& state)
+{
+    const auto in = make_sys_times<milliseconds>(1970, 2038);
+    const auto range = std::minmax_element(in.begin(), in.end());
+    const chrono_date::calendar_buckets buckets{locate_zone("Europe/Berlin"), chrono_date::calendar_unit::month,
+                                                floor<seconds>(*range.first), floor<seconds>(*range.second)};
+    std::vector<std::uint32_t> out(in.size());
+    for(auto _ : state)
+    {
+        buckets.assign(in.data(), in.size(), out.data(), static_cast<unsigned>(state.range(0)));
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(in.size()));
+}
+BENCHMARK(bucket_months_calendar_buckets)
+    ->RangeMultiplier(2)
+    ->Range(1, 8)
+    ->Unit(benchmark::kMicrosecond)
+    ->UseRealTime();
+
+// departures in New York converted to local times of arrival in Tehran
+static void local_to_local_make_zoned(benchmark::State& state)
+{
+    const auto from = locate_zone("America/New_York");
+    const auto to = locate_zone("Asia/Tehran");
+    const auto in = make_local_times<seconds>(1970, 2038);
+    std::size_t i = 0;
+    for(auto _ : state)
+    {
+        const auto departure = make_zoned(from, in[i++ & (bench_size - 1)], choose::earliest);
+        benchmark::DoNotOptimize(make_zoned(to, departure.get_sys_time()).get_local_time());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(local_to_local_make_zoned);
+
+static void local_to_local_zone_pair_converter(benchmark::State& state)
+{
+    const auto converter = chrono_date::make_zone_pair_converter(
+        locate_zone("America/New_York"), locate_zone("Asia/Tehran"),
+        sys_seconds{sys_days{1969_y / dec / 31}}, sys_seconds{sys_days{2038_y / jan / 2}});
+    const auto in = make_local_times<seconds>(1970, 2038);
+    std::size_t i = 0;
+    for(auto _ : state)
+        benchmark::DoNotOptimize(converter.to_local(in[i++ & (bench_size - 1)], choose::earliest));
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(local_to_local_zone_pair_converter);
+
+// bench_size timeouts of up to a minute, scheduled and expired in 1ms steps
+static std::vector<milliseconds> make_timeouts()
+{
+    std::mt19937_64 gen{bench_seed};
+    std::vector<milliseconds> v(bench_size);
+    for(auto& t : v)
+        t = milliseconds{static_cast<std::int64_t>(gen() % 60000)};
+    return v;
+}
+
+// the baseline: a binary heap of deadlines, cancelled timers are skipped
+// when they reach the top
+static void timers_priority_queue(benchmark::State& state)
+{
+    const auto cancel = state.range(0) != 0;
+    const auto timeouts = make_timeouts();
+    using entry = std::pair<steady_clock::time_point, std::uint32_t>;
+    std::priority_queue<entry, std::vector<entry>, std::greater<entry>> queue;
+    std::vector<char> cancelled(timeouts.size());
+    auto now = steady_clock::time_point{};
+    std::uint64_t sum = 0;
+    for(auto _ : state)
+    {
+        for(std::uint32_t i = 0; i < timeouts.size(); ++i)
+        {
+            queue.emplace(now + timeouts[i], i);
+            cancelled[i] = 0;
+        }
+        if(cancel)
+            for(std::size_t i = 0; i < timeouts.size(); i += 2)
+                cancelled[i] = 1;
+        for(const auto until = now + 60s; now < until;)
+        {
+            now += 1ms;
+            while(!queue.empty() && queue.top().first <= now)
+            {
+                if(!cancelled[queue.top().second])
+                    sum += queue.top().second;
+                queue.pop();
+            }
+        }
+    }
+    benchmark::DoNotOptimize(sum);
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(timeouts.size()));
+}
+BENCHMARK(timers_priority_queue)
+    ->Arg(0)
+    ->Arg(1)
+    ->Unit(benchmark::kMicrosecond);
+
+static void timers_timing_wheel(benchmark::State& state)
+{
+    const auto cancel = state.range(0) != 0;
+    const auto timeouts = make_timeouts();
+    chrono_date::timing_wheel<std::uint32_t> wheel{steady_clock::time_point{}, timeouts.size()};
+    std::vector<chrono_date::timer_id> ids(timeouts.size());
+    std::uint64_t sum = 0;
+    for(auto _ : state)
+    {
+        const auto now = wheel.now();
+        for(std::uint32_t i = 0; i < timeouts.size(); ++i)
+            ids[i] = wheel.schedule(now + timeouts[i], i);
+        if(cancel)
+            for(std::size_t i = 0; i < timeouts.size(); i += 2)
+                wheel.cancel(ids[i]);
+        for(auto t = now + 1ms; t <= now + 60s; t += 1ms)
+            wheel.advance(t, [&](std::uint32_t i) { sum += i; });
+    }
+    benchmark::DoNotOptimize(sum);
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(timeouts.size()));
+}
+BENCHMARK(timers_timing_wheel)
+    ->Arg(0)
+    ->Arg(1)
+    ->Unit(benchmark::kMicrosecond);
+
+// reading the clocks
+template<class Clock>
+static void clock_now(benchmark::State& state)
+{
+    Clock::now();
+    for(auto _ : state)
+        benchmark::DoNotOptimize(Clock::now());
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_TEMPLATE(clock_now, system_clock);
+BENCHMARK_TEMPLATE(clock_now, steady_clock);
+BENCHMARK_TEMPLATE(clock_now, chrono_date::coarse_system_clock);
+BENCHMARK_TEMPLATE(clock_now, chrono_date::coarse_steady_clock);
+BENCHMARK_TEMPLATE(clock_now, chrono_date::tsc_clock);
+
+static void today_from_system_clock(benchmark::State& state)
+{
+    for(auto _ : state)
+        benchmark::DoNotOptimize(year_month_day{floor<days>(system_clock::now())});
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(today_from_system_clock);
+
+static void today_cached(benchmark::State& state)
+{
+    for(auto _ : state)
+        benchmark::DoNotOptimize(chrono_date::cached_today());
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(today_cached);
+
+// a sorted column of events about a second apart, with range(0)
+// milliseconds of jitter
+static std::vector<sys_time<milliseconds>> make_event_times(std::int64_t jitter)
+{
+    std::mt19937_64 gen{bench_seed};
+    std::vector<sys_time<milliseconds>> v(bench_size);
+    auto t = sys_time<milliseconds>{sys_days{2020_y / jan / 1}};
+    for(auto& e : v)
+    {
+        t += 1000ms + milliseconds{jitter == 0 ? 0 : static_cast<std::int64_t>(gen() % jitter)};
+        e = t;
+    }
+    return v;
+}
+
+// the bandwidth to beat, copying the raw ticks
+static void timestamps_copy(benchmark::State& state)
+{
+    const auto in = make_event_times(state.range(0));
+    std::vector<sys_time<milliseconds>> out(in.size());
+    for(auto _ : state)
+    {
+        std::copy(in.begin(), in.end(), out.begin());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(in.size()));
+    state.SetBytesProcessed(state.iterations() * static_cast<std::int64_t>(in.size() * sizeof(in[0])));
+}
+BENCHMARK(timestamps_copy)
+    ->Arg(0)
+    ->Arg(100);
+
+static void timestamps_encode(benchmark::State& state)
+{
+    const auto in = make_event_times(state.range(0));
+    for(auto _ : state)
+        benchmark::DoNotOptimize(chrono_date::encode_timestamps(in.data(), in.size()));
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(in.size()));
+    state.SetBytesProcessed(state.iterations() * static_cast<std::int64_t>(in.size() * sizeof(in[0])));
+}
+BENCHMARK(timestamps_encode)
+    ->Arg(0)
+    ->Arg(100);
+
+// bytes are those of the decoded ticks, the label the compression ratio
+static void timestamps_decode(benchmark::State& state)
+{
+    const auto in = make_event_times(state.range(0));
+    const auto column = chrono_date::encode_timestamps(in.data(), in.size());
+    std::vector<sys_time<milliseconds>> out(in.size());
+    for(auto _ : state)
+    {
+        column.decode(0, column.size(), out.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(in.size()));
+    state.SetBytesProcessed(state.iterations() * static_cast<std::int64_t>(in.size() * sizeof(in[0])));
+    state.SetLabel(std::to_string(static_cast<double>(in.size() * sizeof(in[0])) /
+                                  static_cast<double>(column.words().size() * sizeof(std::uint64_t))));
+}
+BENCHMARK(timestamps_decode)
+    ->Arg(0)
+    ->Arg(100);
+
+// the fields of year_month_day and hh_mm_ss of every time point
+static void timestamps_fields(benchmark::State& state)
+{
+    const auto in = make_event_times(state.range(0));
+    std::vector<year_month_day> ymd(in.size());
+    std::vector<date::hh_mm_ss<milliseconds>> tod(in.size());
+    for(auto _ : state)
+    {
+        for(std::size_t i = 0; i < in.size(); ++i)
+        {
+            const auto d = floor<days>(in[i]);
+            ymd[i] = year_month_day{d};
+            tod[i] = make_time(in[i] - d);
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(in.size()));
+}
+BENCHMARK(timestamps_fields)
+    ->Arg(100);
+
+static void timestamps_decode_fields(benchmark::State& state)
+{
+    const auto in = make_event_times(state.range(0));
+    const auto column = chrono_date::encode_timestamps(in.data(), in.size());
+    std::vector<std::int16_t> y(in.size());
+    std::vector<std::uint8_t> m(in.size());
+    std::vector<std::uint8_t> d(in.size());
+    std::vector<std::uint8_t> h(in.size());
+    std::vector<std::uint8_t> min(in.size());
+    std::vector<std::uint8_t> s(in.size());
+    std::vector<milliseconds::rep> ms(in.size());
+    for(auto _ : state)
+    {
+        column.decode_fields(0, column.size(), {y.data(), m.data(), d.data()},
+                             {h.data(), min.data(), s.data(), ms.data()});
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(in.size()));
+}
+BENCHMARK(timestamps_decode_fields)
+    ->Arg(100);
+
+// round<seconds> of milliseconds, one at a time and in batches
+static std::vector<milliseconds> make_durations()
+{
+    std::mt19937_64 gen{bench_seed};
+    std::vector<milliseconds> v(bench_size);
+    for(auto& d : v)
+        d = milliseconds{static_cast<std::int64_t>(gen() % (std::uint64_t{1} << 40)) - (std::int64_t{1} << 39)};
+    return v;
+}
+
+static void round_durations(benchmark::State& state)
+{
+    const auto in = make_durations();
+    std::vector<seconds> out(in.size());
+    for(auto _ : state)
+    {
+        for(std::size_t i = 0; i < in.size(); ++i)
+            out[i] = round<seconds>(in[i]);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(in.size()));
+}
+BENCHMARK(round_durations);
+
+static void round_durations_batch(benchmark::State& state)
+{
+    const auto in = make_durations();
+    const auto isa = static_cast<chrono_date::simd_isa>(state.range(0));
+    if(!chrono_date::is_supported(isa))
+    {
+        state.SkipWithError("isa not supported by this cpu");
+        return;
+    }
+    std::vector<seconds> out(in.size());
+    for(auto _ : state)
+    {
+        chrono_date::round_batch(isa, in.data(), in.size(), out.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(in.size()));
+    state.SetLabel(chrono_date::to_string(isa));
+}
+BENCHMARK(round_durations_batch)
+    ->DenseRange(0, 3);
+
+// hh_mm_ss fields of milliseconds
+static void split_durations(benchmark::State& state)
+{
+    const auto in = make_durations();
+    std::vector<date::hh_mm_ss<milliseconds>> out(in.size());
+    for(auto _ : state)
+    {
+        for(std::size_t i = 0; i < in.size(); ++i)
+            out[i] = make_time(in[i]);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(in.size()));
+}
+BENCHMARK(split_durations);
+
+static void split_durations_batch(benchmark::State& state)
+{
+    const auto in = make_durations();
+    const auto isa = static_cast<chrono_date::simd_isa>(state.range(0));
+    if(!chrono_date::is_supported(isa))
+    {
+        state.SkipWithError("isa not supported by this cpu");
+        return;
+    }
+    std::vector<std::uint8_t> negative(in.size());
+    std::vector<hours::rep> h(in.size());
+    std::vector<std::uint8_t> m(in.size());
+    std::vector<std::uint8_t> s(in.size());
+    std::vector<milliseconds::rep> ms(in.size());
+    for(auto _ : state)
+    {
+        chrono_date::split_batch(isa, in.data(), in.size(), {negative.data(), h.data(), m.data(), s.data(), ms.data()});
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(in.size()));
+    state.SetLabel(chrono_date::to_string(isa));
+}
+BENCHMARK(split_durations_batch)
+    ->DenseRange(0, 3);
+
+// monthly recurrences from 1970 to 2038, the 30th clamped to the end of
+// the month and the last friday, by hand with year_month arithmetic and
+// with a recurrence
+static void recurrence_by_hand(benchmark::State& state)
+{
+    const auto until = sys_days{2038_y / jan / 1};
+    std::vector<sys_days> out(1000);
+    std::size_t n = 0;
+    for(auto _ : state)
+    {
+        n = 0;
+        for(auto ym = 1970_y / jan; sys_days{ym / 1} <= until; ym += months{1})
+        {
+            if(state.range(0) == 0)
+            {
+                const auto ymd = ym / 30;
+                out[n++] = sys_days{ymd.ok() ? ymd : ym / last};
+            }
+            else
+                out[n++] = sys_days{ym / fri[last]};
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(n));
+}
+BENCHMARK(recurrence_by_hand)
+    ->DenseRange(0, 1);
+
+static void recurrence_fill(benchmark::State& state)
+{
+    const auto until = sys_days{2038_y / jan / 1};
+    const auto r = state.range(0) == 0
+                       ? chrono_date::recurrence::months(1970_y / jan / 30, until, 1, chrono_date::month_overflow::clamp)
+                       : chrono_date::recurrence::months(1970_y / jan / fri[last], until);
+    std::vector<sys_days> out(1000);
+    std::size_t n = 0;
+    for(auto _ : state)
+    {
+        n = r.fill(out.data(), out.size());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(n));
+}
+BENCHMARK(recurrence_fill)
+    ->DenseRange(0, 1);
+
+// ten business days after random dates of a calendar of 2000 to 2040
+// with a holiday a month, day by day and through the calendar's index
+static const chrono_date::business_calendar& bench_business_calendar()
+{
+    static const chrono_date::business_calendar calendar = []
+    {
+        std::vector<sys_days> holidays;
+        for(auto ym = 2000_y / jan; ym < 2040_y / jan; ym += months{1})
+            holidays.push_back(sys_days{ym / 15});
+        return chrono_date::business_calendar{sys_days{2000_y / jan / 1}, sys_days{2040_y / jan / 1}, holidays};
+    }();
+    return calendar;
+}
+
+static std::vector<sys_days> make_business_dates()
+{
+    std::mt19937_64 gen{bench_seed};
+    std::uniform_int_distribution<int> dist{0, 39 * 365};
+    std::vector<sys_days> v(bench_size);
+    for(auto& d : v)
+        d = sys_days{2000_y / jan / 1} + days{dist(gen)};
+    return v;
+}
+
+static void add_business_days_by_hand(benchmark::State& state)
+{
+    const auto& calendar = bench_business_calendar();
+    const auto in = make_business_dates();
+    std::size_t i = 0;
+    for(auto _ : state)
+    {
+        auto d = in[i++ & (bench_size - 1)];
+        for(int n = 0; n < 10; ++n)
+            do
+                d += days{1};
+            while(!calendar.is_business_day(d));
+        benchmark::DoNotOptimize(d);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(add_business_days_by_hand);
+
+static void add_business_days(benchmark::State& state)
+{
+    const auto& calendar = bench_business_calendar();
+    const auto in = make_business_dates();
+    std::size_t i = 0;
+    for(auto _ : state)
+        benchmark::DoNotOptimize(calendar.add(in[i++ & (bench_size - 1)], 10));
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(add_business_days);
+
+// precompiled tzdb: mapping the image and locating a zone, the startup
+// cost that replaces tzdb_first_use
+static const std::string& bench_image_path()
+{
+    static const std::string path = []
+    {
+        const std::string p = "chrono_date_benchmark.tzdb";
+        chrono_date::write_tzdb_image(get_tzdb(), p,
+                                      sys_days{1850_y / jan / 1}, sys_days{2100_y / jan / 1});
+        return p;
+    }();
+    return path;
+}
+
+// resolving the zone of the process on every call against the cache
+static void current_zone_uncached(benchmark::State& state)
+{
+    for(auto _ : state)
+        benchmark::DoNotOptimize(current_zone());
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(current_zone_uncached)
+    ->ThreadRange(1, 8)
+    ->UseRealTime();
+
+static void current_zone_cached(benchmark::State& state)
+{
+    for(auto _ : state)
+        benchmark::DoNotOptimize(chrono_date::cached_current_zone());
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(current_zone_cached)
+    ->ThreadRange(1, 8)
+    ->UseRealTime();
+
+// eagerly every zone is loaded, lazily only Europe/Berlin
+static void tzdb_image_open(benchmark::State& state)
+{
+    const auto& path = bench_image_path();
+    const auto loading = state.range(0) != 0 ? chrono_date::tzdb_loading::lazy : chrono_date::tzdb_loading::eager;
+    for(auto _ : state)
+    {
+        const chrono_date::tzdb_image image{path, loading};
+        benchmark::DoNotOptimize(image.locate_zone("Europe/Berlin"));
+    }
+    const chrono_date::tzdb_image image{path, loading};
+    image.locate_zone("Europe/Berlin");
+    const auto stats = image.memory_stats();
+    state.counters["loaded_zones"] = static_cast<double>(stats.loaded_zones);
+    state.counters["loaded_bytes"] = static_cast<double>(stats.loaded_bytes);
+    state.counters["index_bytes"] = static_cast<double>(stats.index_bytes);
+    state.SetLabel(std::string{state.range(0) != 0 ? "lazy, " : "eager, "} + std::to_string(image.size_bytes()) + " bytes");
+}
+BENCHMARK(tzdb_image_open)
+    ->Arg(0)
+    ->Arg(1)
+    ->Unit(benchmark::kMicrosecond);
+
+// compiling every zone into an image on range(0) threads; only the first
+// iteration builds the transitions date computes on first use
+static void tzdb_image_write(benchmark::State& state)
+{
+    chrono_date::tzdb_image_options options;
+    options.threads = static_cast<unsigned>(state.range(0));
+    const std::string path = "chrono_date_benchmark_write.tzdb";
+    for(auto _ : state)
+        chrono_date::write_tzdb_image(get_tzdb(), path, sys_days{1850_y / jan / 1}, sys_days{2100_y / jan / 1},
+                                      options);
+    std::remove(path.c_str());
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(get_tzdb().zones.size()));
+}
+BENCHMARK(tzdb_image_write)
+    ->Arg(1)
+    ->Arg(4)
+    ->Unit(benchmark::kMillisecond);
+
+// warm tzdb: make_zoned by zone name
+// run single and multi threaded to expose contention inside the lookup
+static void make_zoned_by_name(benchmark::State& state, const char* zone)
+{
+    static_cast<void>(get_tzdb());
+    const auto in = make_local_times<seconds>(1970, 2038);
+    const auto name = std::string{zone};
+    std::size_t i = static_cast<std::size_t>(state.thread_index()) * 4099;
+    for(auto _ : state)
+    {
+        const auto zt = make_zoned(name, in[i++ & (bench_size - 1)], choose::earliest);
+        benchmark::DoNotOptimize(zt);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_CAPTURE(make_zoned_by_name, berlin, "Europe/Berlin")
+    ->ThreadRange(1, 8)
+    ->UseRealTime();
+BENCHMARK_CAPTURE(make_zoned_by_name, new_york, "America/New_York")
+    ->ThreadRange(1, 8)
+    ->UseRealTime();
+BENCHMARK_CAPTURE(make_zoned_by_name, tehran, "Asia/Tehran")
+    ->ThreadRange(1, 8)
+    ->UseRealTime();
+
+// warm tzdb: make_zoned with an already located zone
+// the difference to make_zoned_by_name is the cost of the name lookup
+static void make_zoned_by_zone(benchmark::State& state, const char* zone)
+{
+    const auto tz = locate_zone(zone);
+    const auto in = make_local_times<seconds>(1970, 2038);
+    std::size_t i = static_cast<std::size_t>(state.thread_index()) * 4099;
+    for(auto _ : state)
+    {
+        const auto zt = make_zoned(tz, in[i++ & (bench_size - 1)], choose::earliest);
+        benchmark::DoNotOptimize(zt);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_CAPTURE(make_zoned_by_zone, berlin, "Europe/Berlin")
+    ->ThreadRange(1, 8)
+    ->UseRealTime();
+
+// make_zoned by zone name resolved through the interned zone registry
+// and its per thread cache
+static void make_zoned_by_interned_name(benchmark::State& state, const char* zone)
+{
+    static_cast<void>(chrono_date::get_zone_registry());
+    const auto in = make_local_times<seconds>(1970, 2038);
+    const auto name = std::string{zone};
+    std::size_t i = static_cast<std::size_t>(state.thread_index()) * 4099;
+    for(auto _ : state)
+    {
+        const auto zt = chrono_date::make_zoned(chrono_date::intern_zone(name),
+                                                in[i++ & (bench_size - 1)], choose::earliest);
+        benchmark::DoNotOptimize(zt);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_CAPTURE(make_zoned_by_interned_name, berlin, "Europe/Berlin")
+    ->ThreadRange(1, 8)
+    ->UseRealTime();
+
+// sorting zoned times of a few zones by time and zone, as zoned_time
+// with its zone looked up and packed into a word
+static std::vector<zoned_time<seconds>> make_zoned_times()
+{
+    const char* const names[] = {"Europe/Berlin", "America/New_York", "Asia/Jerusalem", "UTC"};
+    const auto st = make_sys_times<seconds>(1970, 2038);
+    std::vector<zoned_time<seconds>> v;
+    v.reserve(st.size());
+    for(std::size_t i = 0; i < st.size(); ++i)
+        v.push_back(make_zoned(names[i % 4], st[i]));
+    return v;
+}
+
+static void sort_zoned_times(benchmark::State& state)
+{
+    const auto& registry = chrono_date::get_zone_registry();
+    const auto in = make_zoned_times();
+    std::vector<zoned_time<seconds>> v;
+    for(auto _ : state)
+    {
+        v = in;
+        std::sort(v.begin(), v.end(), [&](const zoned_time<seconds>& a, const zoned_time<seconds>& b)
+        {
+            return std::make_pair(a.get_sys_time(), registry.intern(a.get_time_zone())) <
+                   std::make_pair(b.get_sys_time(), registry.intern(b.get_time_zone()));
+        });
+        benchmark::DoNotOptimize(v.data());
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(in.size()));
+}
+BENCHMARK(sort_zoned_times);
+
+static void sort_packed_zoned_times(benchmark::State& state)
+{
+    const auto zts = make_zoned_times();
+    std::vector<chrono_date::packed_zoned_time<>> in(zts.size());
+    chrono_date::pack_zoned_times(zts.data(), zts.size(), in.data());
+    std::vector<chrono_date::packed_zoned_time<>> v;
+    for(auto _ : state)
+    {
+        v = in;
+        std::sort(v.begin(), v.end());
+        benchmark::DoNotOptimize(v.data());
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(in.size()));
+}
+BENCHMARK(sort_packed_zoned_times);
+
+// what a counter costs on a hot path, nothing unless CHRONO_DATE_METRICS
+static void count_metric(benchmark::State& state)
+{
+    for(auto _ : state)
+    {
+        chrono_date::count_metric(chrono_date::metric_counter::local_to_sys_hits);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetLabel(chrono_date::metrics_enabled ? "enabled" : "disabled");
+}
+BENCHMARK(count_metric)
+    ->ThreadRange(1, 8)
+    ->UseRealTime();
+
+// name resolution alone: locate_zone, the perfect hash and the cached lookup
+static void zone_lookup_locate_zone(benchmark::State& state)
+{
+    const auto name = std::string{"Europe/Berlin"};
+    for(auto _ : state)
+        benchmark::DoNotOptimize(locate_zone(name));
+}
+BENCHMARK(zone_lookup_locate_zone);
+
+static void zone_lookup_registry(benchmark::State& state)
+{
+    const auto& registry = chrono_date::get_zone_registry();
+    const auto name = std::string{"Europe/Berlin"};
+    for(auto _ : state)
+        benchmark::DoNotOptimize(registry.find(name));
+}
+BENCHMARK(zone_lookup_registry);
+
+static void zone_lookup_intern_zone(benchmark::State& state)
+{
+    const auto name = std::string{"Europe/Berlin"};
+    for(auto _ : state)
+        benchmark::DoNotOptimize(chrono_date::intern_zone(name));
+}
+BENCHMARK(zone_lookup_intern_zone);
+
+// make_zoned on a zone of a precompiled tzdb image
+static void make_zoned_by_compiled_zone(benchmark::State& state, const char* zone)
+{
+    const chrono_date::tzdb_image image{bench_image_path()};
+    const auto tz = image.locate_zone(zone);
+    const auto in = make_local_times<seconds>(1970, 2038);
+    std::size_t i = static_cast<std::size_t>(state.thread_index()) * 4099;
+    for(auto _ : state)
+    {
+        const auto zt = make_zoned(tz, in[i++ & (bench_size - 1)], choose::earliest);
+        benchmark::DoNotOptimize(zt);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_CAPTURE(make_zoned_by_compiled_zone, berlin, "Europe/Berlin")
+    ->ThreadRange(1, 8)
+    ->UseRealTime();
+
+// make_zoned on a compiled zone of a snapshot of a hot swappable database
+static void make_zoned_by_rcu_snapshot(benchmark::State& state, const char* zone)
+{
+    static const chrono_date::rcu_tzdb<chrono_date::tzdb_image> db{
+        std::make_unique<const chrono_date::tzdb_image>(bench_image_path())};
+    const auto in = make_local_times<seconds>(1970, 2038);
+    std::size_t i = static_cast<std::size_t>(state.thread_index()) * 4099;
+    for(auto _ : state)
+    {
+        const auto snapshot = db.get();
+        const auto zt = make_zoned(snapshot->locate_zone(zone), in[i++ & (bench_size - 1)], choose::earliest);
+        benchmark::DoNotOptimize(zt);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_CAPTURE(make_zoned_by_rcu_snapshot, berlin, "Europe/Berlin")
+    ->ThreadRange(1, 8)
+    ->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,233 @@
+#include "business_calendar.h"
+#include "timestamp_from_chars.h"
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace chrono_date
+{
+
+namespace
+{
+
+int popcount(std::uint64_t w) noexcept
+{
+#if defined(__POPCNT__)
+    return __builtin_popcountll(w);
+#else
+    w = w - ((w >> 1) & 0x5555555555555555);
+    w = (w & 0x3333333333333333) + ((w >> 2) & 0x3333333333333333);
+    w = (w + (w >> 4)) & 0x0f0f0f0f0f0f0f0f;
+    return static_cast<int>((w * 0x0101010101010101) >> 56);
+#endif
+}
+
+constexpr std::uint64_t byte_ones = 0x0101010101010101;
+constexpr std::uint64_t byte_highs = 0x8080808080808080;
+
+// index of the r-th (from 0) set bit of w, which has more than r; without
+// branches, whose outcome would be as random as the dates
+unsigned select_bit(std::uint64_t w, unsigned r) noexcept
+{
+    // the set bits of every byte and of all bytes below it
+    auto s = w - ((w >> 1) & 0x5555555555555555);
+    s = (s & 0x3333333333333333) + ((s >> 2) & 0x3333333333333333);
+    s = ((s + (s >> 4)) & 0x0f0f0f0f0f0f0f0f) * byte_ones;
+    // the high bit of every byte with at most r, the bit is in the next
+    const auto full = (((r * byte_ones) | byte_highs) - s) & byte_highs;
+    const auto byte = static_cast<unsigned>(((full >> 7) * byte_ones) >> 56) * 8;
+    r -= static_cast<unsigned>(((s << 8) >> byte) & 0xff);
+    // the same for the bits of that byte, spread one to a byte
+    const auto bits = ((w >> byte) & 0xff) * byte_ones & 0x8040201008040201;
+    const auto t = (((bits + 0x7f7f7f7f7f7f7f7f) >> 7) & byte_ones) * byte_ones;
+    const auto below = (((r * byte_ones) | byte_highs) - t) & byte_highs;
+    return byte + static_cast<unsigned>(((below >> 7) * byte_ones) >> 56);
+}
+
+// sun to sat, or any longer prefix of sunday to saturday, in any case;
+// !ok() if it is none of them
+date::weekday parse_weekday(const std::string& s)
+{
+    static const char* const names[] = {"sunday", "monday", "tuesday", "wednesday", "thursday", "friday", "saturday"};
+    for(unsigned i = 0; i < 7; ++i)
+    {
+        const std::string name = names[i];
+        if(s.size() < 3 || s.size() > name.size())
+            continue;
+        if(std::equal(s.begin(), s.end(), name.begin(),
+                      [](char a, char b) { return std::tolower(static_cast<unsigned char>(a)) == b; }))
+            return date::weekday{i};
+    }
+    return date::weekday{8};
+}
+
+// YYYY-MM-DD and nothing else
+bool parse_date(const std::string& s, date::sys_days& d)
+{
+    const auto last = s.data() + s.size();
+    const auto r = from_chars(s.data(), last, d);
+    return r.ec == std::errc{} && r.ptr == last;
+}
+
+[[noreturn]] void bad_file(const std::string& path, std::size_t line, const std::string& what)
+{
+    throw std::runtime_error(path + ':' + std::to_string(line) + ": " + what);
+}
+
+}
+
+business_calendar::business_calendar(date::sys_days first,
+                                     date::sys_days last,
+                                     const std::vector<date::sys_days>& holidays,
+                                     const std::vector<date::weekday>& weekend)
+    : first_{first}
+    , last_{std::max(first, last)}
+{
+    build(holidays, weekend);
+}
+
+business_calendar::business_calendar(const std::string& path)
+{
+    std::ifstream in(path);
+    if(!in)
+        throw std::runtime_error("can not open business calendar " + path);
+
+    bool ranged = false;
+    std::vector<date::weekday> weekend{date::sat, date::sun};
+    std::vector<date::sys_days> holidays;
+    std::string text;
+    for(std::size_t line = 1; std::getline(in, text); ++line)
+    {
+        const auto hash = text.find('#');
+        if(hash != std::string::npos)
+            text.erase(hash);
+        std::istringstream is(text);
+        std::string word;
+        if(!(is >> word))
+            continue;
+        if(word == "range")
+        {
+            std::string from, to;
+            date::sys_days f, l;
+            if(!(is >> from >> to) || !parse_date(from, f) || !parse_date(to, l))
+                bad_file(path, line, "expected range YYYY-MM-DD YYYY-MM-DD");
+            first_ = f;
+            last_ = std::max(f, l);
+            ranged = true;
+        }
+        else if(word == "weekend")
+        {
+            weekend.clear();
+            while(is >> word)
+            {
+                const auto wd = parse_weekday(word);
+                if(!wd.ok())
+                    bad_file(path, line, "not a weekday: " + word);
+                weekend.push_back(wd);
+            }
+        }
+        else
+        {
+            date::sys_days d;
+            if(!parse_date(word, d))
+                bad_file(path, line, "expected YYYY-MM-DD: " + word);
+            if(!ranged)
+                bad_file(path, line, "holiday before range");
+            holidays.push_back(d);
+        }
+    }
+    if(!ranged)
+        throw std::runtime_error("no range in business calendar " + path);
+    build(holidays, weekend);
+}
+
+void business_calendar::build(const std::vector<date::sys_days>& holidays, const std::vector<date::weekday>& weekend)
+{
+    const auto days = static_cast<std::size_t>((last_ - first_).count());
+    if(days > 0xffffffff)
+        throw std::runtime_error("business calendar range too long");
+
+    // one week of bits from the weekday of first, repeated
+    bool work[7];
+    for(unsigned i = 0; i < 7; ++i)
+        work[i] = std::find(weekend.begin(), weekend.end(), date::weekday{first_ + date::days{i}}) == weekend.end();
+    words_.assign((days + 63) / 64, 0);
+    for(std::size_t i = 0; i < days; ++i)
+        if(work[i % 7])
+            words_[i / 64] |= std::uint64_t{1} << (i % 64);
+    for(const auto h : holidays)
+        if(h >= first_ && h < last_)
+        {
+            const auto i = static_cast<std::size_t>((h - first_).count());
+            words_[i / 64] &= ~(std::uint64_t{1} << (i % 64));
+        }
+
+    counts_.resize(words_.size() + 1);
+    std::uint32_t n = 0;
+    for(std::size_t w = 0; w < words_.size(); ++w)
+    {
+        counts_[w] = n;
+        n += static_cast<std::uint32_t>(popcount(words_[w]));
+    }
+    counts_.back() = n;
+}
+
+std::uint32_t business_calendar::rank(date::sys_days d) const
+{
+    if(d == last_)
+        return counts_.back();
+    const auto i = index(d);
+    const auto below = (std::uint64_t{1} << (i % 64)) - 1;
+    return counts_[i / 64] + static_cast<std::uint32_t>(popcount(words_[i / 64] & below));
+}
+
+date::sys_days business_calendar::select(std::int64_t r, std::size_t near) const
+{
+    if(r < 0 || r >= static_cast<std::int64_t>(counts_.back()))
+        out_of_range();
+    const auto rank = static_cast<std::uint32_t>(r);
+    // the word with counts_[w] <= rank < counts_[w + 1], by a few steps
+    // from near and a binary search if it is further away
+    auto w = std::min(near, words_.size() - 1);
+    for(int i = 0; i < 4 && !(counts_[w] <= rank && rank < counts_[w + 1]); ++i)
+        w = counts_[w] > rank ? w - 1 : w + 1;
+    if(!(counts_[w] <= rank && rank < counts_[w + 1]))
+        w = static_cast<std::size_t>(std::upper_bound(counts_.begin(), counts_.end() - 1, rank) - counts_.begin()) - 1;
+    const auto bit = select_bit(words_[w], rank - counts_[w]);
+    return first_ + date::days{static_cast<date::days::rep>(w * 64 + bit)};
+}
+
+date::sys_days business_calendar::add(date::sys_days d, std::int64_t n) const
+{
+    if(n == 0)
+    {
+        index(d);
+        return d;
+    }
+    // business days before d, and d itself if it is one
+    const std::int64_t before = rank(d);
+    const bool is = d != last_ && is_business_day(d);
+    const auto near = static_cast<std::size_t>((d - first_).count()) / 64;
+    return select(n > 0 ? before + is + n - 1 : before + n, near);
+}
+
+date::sys_days business_calendar::next_or_same(date::sys_days d) const
+{
+    return select(rank(d), static_cast<std::size_t>((d - first_).count()) / 64);
+}
+
+date::sys_days business_calendar::previous_or_same(date::sys_days d) const
+{
+    if(d != last_ && is_business_day(d))
+        return d;
+    return select(static_cast<std::int64_t>(rank(d)) - 1, static_cast<std::size_t>((d - first_).count()) / 64);
+}
+
+void business_calendar::out_of_range()
+{
+    throw std::runtime_error("date outside of business calendar");
+}
+
+}
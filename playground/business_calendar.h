@@ -0,0 +1,106 @@
+#ifndef CHRONO_DATE_BUSINESS_CALENDAR_H
+#define CHRONO_DATE_BUSINESS_CALENDAR_H
+
+// Business days of a range of dates.
+//
+// A business_calendar marks every day of [first, last) that is neither a
+// weekend day nor a holiday in a bitset, one bit per day, and keeps the
+// number of business days before every 64 bit word. Whether a day is a
+// business day and the number of business days between two days are
+// then a lookup and a popcount; adding n business days is a search over
+// the counts, a few steps for small n and a binary search for large n,
+// and a search within one word.
+//
+// A calendar is never changed after it is built, so any number of
+// threads can share one. Days outside of the range throw
+// std::runtime_error.
+//
+// Calendars are read from text files of lines
+//   range YYYY-MM-DD YYYY-MM-DD    first and last day, exclusive
+//   weekend sat sun                weekdays that are no business days
+//   YYYY-MM-DD anything            a holiday
+// where range comes first, weekend defaults to sat sun and everything
+// after a # is a comment.
+
+#include <date/date.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace chrono_date
+{
+
+class business_calendar
+{
+public:
+    // holidays outside of [first, last) are ignored
+    business_calendar(date::sys_days first,
+                      date::sys_days last,
+                      const std::vector<date::sys_days>& holidays,
+                      const std::vector<date::weekday>& weekend = {date::sat, date::sun});
+
+    // reads a calendar file, throws std::runtime_error if it can not
+    explicit business_calendar(const std::string& path);
+
+    date::sys_days first() const noexcept
+    {
+        return first_;
+    }
+
+    date::sys_days last() const noexcept
+    {
+        return last_;
+    }
+
+    bool is_business_day(date::sys_days d) const
+    {
+        const auto i = index(d);
+        return (words_[i / 64] >> (i % 64) & 1) != 0;
+    }
+
+    // business days in [from, to), negative if to is before from;
+    // both may be last()
+    std::int64_t count(date::sys_days from, date::sys_days to) const
+    {
+        return static_cast<std::int64_t>(rank(to)) - static_cast<std::int64_t>(rank(from));
+    }
+
+    // the nth business day after d for n > 0, the -nth before d for
+    // n < 0, d itself for n == 0
+    date::sys_days add(date::sys_days d, std::int64_t n) const;
+
+    // the first business day at or after d, and at or before d
+    date::sys_days next_or_same(date::sys_days d) const;
+    date::sys_days previous_or_same(date::sys_days d) const;
+
+private:
+    void build(const std::vector<date::sys_days>& holidays, const std::vector<date::weekday>& weekend);
+
+    // days since first, throws if d is not in [first, last)
+    std::size_t index(date::sys_days d) const
+    {
+        if(d < first_ || d >= last_)
+            out_of_range();
+        return static_cast<std::size_t>((d - first_).count());
+    }
+
+    // business days before d, d may be last
+    std::uint32_t rank(date::sys_days d) const;
+
+    // the business day with rank r, throws if there is none; it is
+    // looked for around the word near first
+    date::sys_days select(std::int64_t r, std::size_t near) const;
+
+    [[noreturn]] static void out_of_range();
+
+    date::sys_days first_;
+    date::sys_days last_;
+    std::vector<std::uint64_t> words_;
+    // business days before each word, and all of them at the end
+    std::vector<std::uint32_t> counts_;
+};
+
+}
+
+#endif
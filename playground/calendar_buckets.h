@@ -0,0 +1,258 @@
+#ifndef CHRONO_DATE_CALENDAR_BUCKETS_H
+#define CHRONO_DATE_CALENDAR_BUCKETS_H
+
+// Grouping of sys times by local calendar unit of a time zone.
+//
+// calendar_buckets computes, once for a range of time, the sys times at
+// which the local days, iso weeks, months, quarters or years of a zone
+// begin. A bucket starts at local midnight of its first day, or where
+// that day begins if midnight does not exist. The covered range is also
+// cut into slots of a power of two seconds no longer than the shortest
+// bucket, and every slot knows the bucket its begin is in. Putting a time
+// point into its bucket is then a shift, a table lookup and a single
+// comparison against the next edge instead of a make_zoned, floor<days>
+// and year_month_day per time point.
+//
+// assign and count split large inputs across threads.
+
+#include <date/date.h>
+#include <date/tz.h>
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+namespace chrono_date
+{
+
+enum class calendar_unit
+{
+    day,
+    iso_week,
+    month,
+    quarter,
+    year
+};
+
+class calendar_buckets
+{
+public:
+    // id of time points outside of the covered range
+    static constexpr std::uint32_t outside = UINT32_MAX;
+
+    // inputs smaller than this are not split across threads
+    static constexpr std::size_t parallel_threshold = 1 << 16;
+
+    // buckets of zone from the one containing first to the one containing last
+    template<class TimeZonePtr>
+    calendar_buckets(const TimeZonePtr& zone, calendar_unit unit, date::sys_seconds first, date::sys_seconds last)
+        : unit_{unit}
+    {
+        auto day = unit_begin(date::floor<date::days>(zone->to_local(first)));
+        auto begin = zone->to_sys(day, date::choose::earliest);
+        do
+        {
+            edges_.push_back(count_of(begin));
+            labels_.push_back(day);
+            day = next(day);
+            begin = zone->to_sys(day, date::choose::earliest);
+        }
+        while(begin <= last);
+        edges_.push_back(count_of(begin));
+        make_slots();
+    }
+
+    calendar_unit unit() const noexcept
+    {
+        return unit_;
+    }
+
+    std::size_t size() const noexcept
+    {
+        return labels_.size();
+    }
+
+    // sys time bucket b begins at
+    date::sys_seconds begin(std::size_t b) const noexcept
+    {
+        return date::sys_seconds{std::chrono::seconds{edges_[b]}};
+    }
+
+    // begin of the next bucket
+    date::sys_seconds end(std::size_t b) const noexcept
+    {
+        return date::sys_seconds{std::chrono::seconds{edges_[b + 1]}};
+    }
+
+    // local first day of bucket b
+    date::local_days label(std::size_t b) const noexcept
+    {
+        return labels_[b];
+    }
+
+    // bucket of tp, outside if there is none
+    template<class Duration>
+    std::uint32_t bucket(date::sys_time<Duration> tp) const noexcept
+    {
+        // edges are whole seconds, so flooring does not change any comparison
+        const auto t = date::floor<std::chrono::seconds>(tp).time_since_epoch().count();
+        if(t < edges_.front() || t >= edges_.back())
+            return outside;
+        auto b = slots_[static_cast<std::uint64_t>(t - edges_.front()) >> shift_];
+        b += edges_[b + 1] <= t;
+        // only after buckets of zero length, days a zone skipped
+        while(edges_[b + 1] <= t)
+            ++b;
+        return b;
+    }
+
+    // out[i] = bucket(in[i]) for i in [0, n)
+    // threads == 0 uses all cores for large inputs
+    template<class Duration>
+    void assign(const date::sys_time<Duration>* in, std::size_t n, std::uint32_t* out, unsigned threads = 0) const
+    {
+        parallel(n, threads, [&](std::size_t from, std::size_t to, unsigned)
+        {
+            for(auto i = from; i < to; ++i)
+                out[i] = bucket(in[i]);
+        });
+    }
+
+    // number of time points of in[0, n) per bucket, and in the last
+    // element those outside of all buckets
+    template<class Duration>
+    std::vector<std::size_t> count(const date::sys_time<Duration>* in, std::size_t n, unsigned threads = 0) const
+    {
+        const auto parts = workers(n, threads);
+        std::vector<std::vector<std::size_t>> partial(parts, std::vector<std::size_t>(size() + 1));
+        parallel(n, threads, [&](std::size_t from, std::size_t to, unsigned part)
+        {
+            auto& counts = partial[part];
+            for(auto i = from; i < to; ++i)
+            {
+                const auto b = bucket(in[i]);
+                ++counts[b == outside ? size() : b];
+            }
+        });
+        auto counts = std::move(partial.front());
+        for(std::size_t p = 1; p < parts; ++p)
+            for(std::size_t b = 0; b < counts.size(); ++b)
+                counts[b] += partial[p][b];
+        return counts;
+    }
+
+private:
+    static std::int64_t count_of(date::sys_seconds s) noexcept
+    {
+        return s.time_since_epoch().count();
+    }
+
+    date::local_days unit_begin(date::local_days d) const
+    {
+        const auto ymd = date::year_month_day{d};
+        switch(unit_)
+        {
+        case calendar_unit::iso_week:
+            return d - (date::weekday{d} - date::mon);
+        case calendar_unit::month:
+            return date::local_days{ymd.year() / ymd.month() / 1};
+        case calendar_unit::quarter:
+        {
+            const auto m = (static_cast<unsigned>(ymd.month()) - 1) / 3 * 3 + 1;
+            return date::local_days{ymd.year() / date::month{m} / 1};
+        }
+        case calendar_unit::year:
+            return date::local_days{ymd.year() / date::jan / 1};
+        default:
+            return d;
+        }
+    }
+
+    date::local_days next(date::local_days d) const
+    {
+        const auto ymd = date::year_month_day{d};
+        const auto ym = ymd.year() / ymd.month();
+        switch(unit_)
+        {
+        case calendar_unit::iso_week:
+            return d + date::weeks{1};
+        case calendar_unit::month:
+            return date::local_days{(ym + date::months{1}) / 1};
+        case calendar_unit::quarter:
+            return date::local_days{(ym + date::months{3}) / 1};
+        case calendar_unit::year:
+            return date::local_days{(ym + date::years{1}) / 1};
+        default:
+            return d + date::days{1};
+        }
+    }
+
+    void make_slots()
+    {
+        auto shortest = edges_.back() - edges_.front();
+        for(std::size_t b = 0; b + 1 < edges_.size(); ++b)
+            if(edges_[b + 1] > edges_[b])
+                shortest = std::min(shortest, edges_[b + 1] - edges_[b]);
+        shift_ = 0;
+        while((std::int64_t{2} << shift_) <= shortest)
+            ++shift_;
+        // slot s begins at edges_.front() + (s << shift_), no slot holds
+        // more than one edge of a bucket that is not empty
+        const auto count = static_cast<std::size_t>((edges_.back() - edges_.front() - 1) >> shift_) + 1;
+        slots_.resize(count);
+        std::uint32_t b = 0;
+        for(std::size_t s = 0; s < count; ++s)
+        {
+            const auto begin = edges_.front() + (static_cast<std::int64_t>(s) << shift_);
+            while(edges_[b + 1] <= begin)
+                ++b;
+            slots_[s] = b;
+        }
+    }
+
+    static unsigned workers(std::size_t n, unsigned threads)
+    {
+        if(threads == 0)
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        if(n < parallel_threshold)
+            return 1;
+        return static_cast<unsigned>(std::min<std::size_t>(threads, n / (parallel_threshold / 4)));
+    }
+
+    // f(from, to, part) for consecutive parts of [0, n), one per worker
+    template<class F>
+    static void parallel(std::size_t n, unsigned threads, F f)
+    {
+        const auto parts = workers(n, threads);
+        if(parts <= 1)
+        {
+            f(0, n, 0);
+            return;
+        }
+        std::vector<std::thread> pool;
+        pool.reserve(parts - 1);
+        const auto chunk = (n + parts - 1) / parts;
+        for(unsigned p = 1; p < parts; ++p)
+            pool.emplace_back([=, &f]
+            {
+                f(std::min(n, p * chunk), std::min(n, (p + 1) * chunk), p);
+            });
+        f(0, std::min(n, chunk), 0);
+        for(auto& t : pool)
+            t.join();
+    }
+
+    calendar_unit unit_;
+    // begin of every bucket and the end of the last one, in seconds
+    std::vector<std::int64_t> edges_;
+    std::vector<date::local_days> labels_;
+    // bucket of the begin of every slot
+    std::vector<std::uint32_t> slots_;
+    unsigned shift_ = 0;
+};
+
+}
+
+#endif
@@ -0,0 +1,366 @@
+#include "civil_batch.h"
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+namespace chrono_date
+{
+
+namespace
+{
+
+// Neri and Schneider, "Euclidean affine functions and their application
+// to calendar algorithms". Only multiplications, shifts and divisions by
+// constants, no branches, so that the block loops below vectorize.
+//
+// The day count is shifted by whole 400 year eras to keep all arithmetic
+// unsigned; 82 eras cover every year date::year can represent.
+constexpr std::uint32_t eras       = 82;
+constexpr std::uint32_t day_shift  = 719468 + 146097 * eras;
+constexpr std::uint32_t year_shift = 400 * eras;
+
+// elements per vectorized loop; a fixed trip count lets the compiler
+// vectorize without a remainder loop at -O2
+constexpr std::size_t block = 32;
+
+// calendar differences per thread at least, fewer are not worth one
+constexpr std::size_t min_part = 1 << 16;
+
+CHRONO_DATE_ALWAYS_INLINE
+void civil_from_days(std::int32_t z, std::int16_t& y, std::uint8_t& m, std::uint8_t& d)
+{
+    const auto n  = static_cast<std::uint32_t>(z) + day_shift;
+    const auto n1 = 4 * n + 3;
+    const auto c  = n1 / 146097;
+    const auto n2 = n1 % 146097 | 3;
+    const auto p2 = std::uint64_t{2939745} * n2;
+    const auto yc = static_cast<std::uint32_t>(p2 >> 32);
+    const auto dy = static_cast<std::uint32_t>(p2) / 2939745 / 4;
+    const auto n3 = 2141 * dy + 197913;
+    const auto mp = n3 >> 16;
+    const auto j  = static_cast<std::uint32_t>(dy >= 306);
+    y = static_cast<std::int16_t>(100 * c + yc - year_shift + j);
+    m = static_cast<std::uint8_t>(mp - 12 * j);
+    d = static_cast<std::uint8_t>((n3 & 0xffff) / 2141 + 1);
+}
+
+CHRONO_DATE_ALWAYS_INLINE
+std::int32_t days_from_civil(std::int16_t y, std::uint8_t m, std::uint8_t d)
+{
+    const auto j  = static_cast<std::uint32_t>(m <= 2);
+    const auto ys = static_cast<std::uint32_t>(std::int32_t{y} + static_cast<std::int32_t>(year_shift)) - j;
+    const auto mp = std::uint32_t{m} + 12 * j;
+    const auto c  = ys / 100;
+    const auto dy = 1461 * ys / 4 - c + c / 4;
+    const auto dm = (979 * mp - 2919) / 32;
+    return static_cast<std::int32_t>(dy + dm + std::uint32_t{d} - 1 - day_shift);
+}
+
+CHRONO_DATE_ALWAYS_INLINE
+std::int32_t floor_days(const date::sys_seconds& s)
+{
+    const auto c = s.time_since_epoch().count();
+    const auto q = c / 86400;
+    return static_cast<std::int32_t>(q - (q * 86400 > c));
+}
+
+CHRONO_DATE_ALWAYS_INLINE
+void to_ymd_block(const std::int32_t* CHRONO_DATE_RESTRICT in,
+                  std::int16_t* CHRONO_DATE_RESTRICT y,
+                  std::uint8_t* CHRONO_DATE_RESTRICT m,
+                  std::uint8_t* CHRONO_DATE_RESTRICT d)
+{
+    for(std::size_t i = 0; i < block; ++i)
+        civil_from_days(in[i], y[i], m[i], d[i]);
+}
+
+CHRONO_DATE_ALWAYS_INLINE
+void to_sys_days_block(const std::int16_t* CHRONO_DATE_RESTRICT y,
+                       const std::uint8_t* CHRONO_DATE_RESTRICT m,
+                       const std::uint8_t* CHRONO_DATE_RESTRICT d,
+                       date::sys_days* CHRONO_DATE_RESTRICT out)
+{
+    for(std::size_t i = 0; i < block; ++i)
+        out[i] = date::sys_days{date::days{days_from_civil(y[i], m[i], d[i])}};
+}
+
+// the day counts are staged in a block of 32 bit integers, which is all
+// civil_from_days needs, whatever the width of days::rep
+CHRONO_DATE_ALWAYS_INLINE
+std::int32_t to_int32(const date::sys_days& d)
+{
+    return static_cast<std::int32_t>(d.time_since_epoch().count());
+}
+
+CHRONO_DATE_ALWAYS_INLINE
+void to_ymd_loop(const date::sys_days* in, std::size_t n, ymd_columns out)
+{
+    std::int32_t days[block];
+    std::size_t i = 0;
+    for(; i + block <= n; i += block)
+    {
+        for(std::size_t k = 0; k < block; ++k)
+            days[k] = to_int32(in[i + k]);
+        to_ymd_block(days, out.year + i, out.month + i, out.day + i);
+    }
+    for(; i < n; ++i)
+        civil_from_days(to_int32(in[i]), out.year[i], out.month[i], out.day[i]);
+}
+
+CHRONO_DATE_ALWAYS_INLINE
+void to_ymd_loop(const date::sys_seconds* in, std::size_t n, ymd_columns out)
+{
+    std::int32_t days[block];
+    std::size_t i = 0;
+    for(; i + block <= n; i += block)
+    {
+        for(std::size_t k = 0; k < block; ++k)
+            days[k] = floor_days(in[i + k]);
+        to_ymd_block(days, out.year + i, out.month + i, out.day + i);
+    }
+    for(; i < n; ++i)
+        civil_from_days(floor_days(in[i]), out.year[i], out.month[i], out.day[i]);
+}
+
+CHRONO_DATE_ALWAYS_INLINE
+void to_sys_days_loop(const_ymd_columns in, std::size_t n, date::sys_days* out)
+{
+    std::size_t i = 0;
+    for(; i + block <= n; i += block)
+        to_sys_days_block(in.year + i, in.month + i, in.day + i, out + i);
+    for(; i < n; ++i)
+        out[i] = date::sys_days{date::days{days_from_civil(in.year[i], in.month[i], in.day[i])}};
+}
+
+// for years shifted by whole eras, so never negative; a year divisible
+// by 25 is one divisible by 100 if it is a leap year at all, and
+// divisibility by 25 is a multiplication by its inverse modulo 2^32
+CHRONO_DATE_ALWAYS_INLINE
+std::int32_t is_leap_year(std::uint32_t ys)
+{
+    const auto centuries = ys * 0xc28f5c29 <= 0x0a3d70a3;
+    return static_cast<std::int32_t>((ys & (centuries ? 15 : 3)) == 0);
+}
+
+// days from March 1st of the year that begins with March, up to the day
+// before the first of month m
+CHRONO_DATE_ALWAYS_INLINE
+std::int32_t days_from_march(std::int32_t m)
+{
+    return (979 * (m + 12 * (m <= 2)) - 2919) >> 5;
+}
+
+// count of [0, block] dates from i into the years, months and days
+// staging blocks; all of them are computed, the unit only picks the
+// anniversary the days are counted from. Nothing is divided: the
+// anniversary is in the year or month of to or the one before, less than
+// a year before to, so the days are a difference of the days since March
+// 1st, plus the length of a year if a March 1st is in between.
+CHRONO_DATE_ALWAYS_INLINE
+void calendar_difference_block(const_ymd_columns from, const_ymd_columns to, std::size_t i, std::size_t count,
+                               difference_unit unit,
+                               std::int32_t* CHRONO_DATE_RESTRICT years,
+                               std::int32_t* CHRONO_DATE_RESTRICT months,
+                               std::int32_t* CHRONO_DATE_RESTRICT days)
+{
+    const auto by_years = unit == difference_unit::years;
+    for(std::size_t k = 0; k < count; ++k)
+    {
+        const std::int32_t fy = from.year[i + k];
+        const std::int32_t fm = from.month[i + k];
+        const std::int32_t fd = from.day[i + k];
+        const std::int32_t ty = to.year[i + k];
+        const std::int32_t tm = to.month[i + k];
+        const std::int32_t td = to.day[i + k];
+
+        // the day or the day of the year of from is not reached yet
+        const std::int32_t day_ahead = td < fd;
+        const std::int32_t year_ahead = tm < fm || (tm == fm && day_ahead);
+        const auto m = 12 * (ty - fy) + tm - fm - day_ahead;
+        years[k] = ty - fy - year_ahead;
+        months[k] = unit == difference_unit::months ? m : m - 12 * years[k];
+
+        // the anniversary, its day clamped to the length of its month
+        const auto back = day_ahead & (tm == 1);
+        const auto ay = by_years ? ty - year_ahead : ty - back;
+        const auto am = by_years ? fm : tm - day_ahead + 12 * back;
+        const auto ays = static_cast<std::uint32_t>(ay + static_cast<std::int32_t>(year_shift));
+        const auto length = am != 2 ? 30 + ((am + (am >> 3)) & 1) : 28 + is_leap_year(ays);
+        const auto ad = fd < length ? fd : length;
+
+        // the february of the year from the March before to
+        const auto march_year = ty - (tm <= 2);
+        const auto shifted = static_cast<std::uint32_t>(march_year + static_cast<std::int32_t>(year_shift));
+        const auto year = 365 + is_leap_year(shifted);
+        days[k] = days_from_march(tm) + td - days_from_march(am) - ad + (ay - (am <= 2) < march_year ? year : 0);
+    }
+}
+
+CHRONO_DATE_ALWAYS_INLINE
+void copy_column(const std::int32_t* from, std::size_t count, std::int32_t* to)
+{
+    if(to != nullptr)
+        std::copy(from, from + count, to);
+}
+
+CHRONO_DATE_ALWAYS_INLINE
+void calendar_difference_loop(const_ymd_columns from, const_ymd_columns to, std::size_t n, difference_unit unit,
+                              calendar_difference_columns out)
+{
+    std::int32_t years[block];
+    std::int32_t months[block];
+    std::int32_t days[block];
+    const auto years_out = unit != difference_unit::months ? out.years : nullptr;
+    const auto months_out = unit != difference_unit::years ? out.months : nullptr;
+    for(std::size_t i = 0; i < n; i += block)
+    {
+        const auto count = std::min(block, n - i);
+        if(count == block)
+            calendar_difference_block(from, to, i, block, unit, years, months, days);
+        else
+            calendar_difference_block(from, to, i, count, unit, years, months, days);
+        copy_column(years, count, years_out != nullptr ? years_out + i : nullptr);
+        copy_column(months, count, months_out != nullptr ? months_out + i : nullptr);
+        copy_column(days, count, out.days != nullptr ? out.days + i : nullptr);
+    }
+}
+
+#define CHRONO_DATE_CIVIL_KERNELS(suffix, target)                                        \
+    target void to_ymd_days_##suffix(const date::sys_days* in, std::size_t n,           \
+                                     ymd_columns out)                                   \
+    {                                                                                   \
+        to_ymd_loop(in, n, out);                                                        \
+    }                                                                                   \
+    target void to_ymd_secs_##suffix(const date::sys_seconds* in, std::size_t n,        \
+                                     ymd_columns out)                                   \
+    {                                                                                   \
+        to_ymd_loop(in, n, out);                                                        \
+    }                                                                                   \
+    target void to_sys_days_##suffix(const_ymd_columns in, std::size_t n,               \
+                                     date::sys_days* out)                               \
+    {                                                                                   \
+        to_sys_days_loop(in, n, out);                                                   \
+    }                                                                                   \
+    target void calendar_difference_##suffix(const_ymd_columns from,                    \
+                                             const_ymd_columns to, std::size_t n,       \
+                                             difference_unit unit,                        \
+                                             calendar_difference_columns out)           \
+    {                                                                                   \
+        calendar_difference_loop(from, to, n, unit, out);                               \
+    }
+
+CHRONO_DATE_CIVIL_KERNELS(generic, )
+#if CHRONO_DATE_HAS_X86_DISPATCH
+CHRONO_DATE_CIVIL_KERNELS(sse4_1, CHRONO_DATE_TARGET_SSE4_1)
+CHRONO_DATE_CIVIL_KERNELS(avx2, CHRONO_DATE_TARGET_AVX2)
+CHRONO_DATE_CIVIL_KERNELS(avx512, CHRONO_DATE_TARGET_AVX512)
+#endif
+
+#undef CHRONO_DATE_CIVIL_KERNELS
+
+}
+
+void to_ymd(simd_isa isa, const date::sys_days* in, std::size_t n, ymd_columns out)
+{
+    switch(is_supported(isa) ? isa : detect_simd_isa())
+    {
+#if CHRONO_DATE_HAS_X86_DISPATCH
+    case simd_isa::avx512: return to_ymd_days_avx512(in, n, out);
+    case simd_isa::avx2:   return to_ymd_days_avx2(in, n, out);
+    case simd_isa::sse4_1: return to_ymd_days_sse4_1(in, n, out);
+#endif
+    default:               return to_ymd_days_generic(in, n, out);
+    }
+}
+
+void to_ymd(simd_isa isa, const date::sys_seconds* in, std::size_t n, ymd_columns out)
+{
+    switch(is_supported(isa) ? isa : detect_simd_isa())
+    {
+#if CHRONO_DATE_HAS_X86_DISPATCH
+    case simd_isa::avx512: return to_ymd_secs_avx512(in, n, out);
+    case simd_isa::avx2:   return to_ymd_secs_avx2(in, n, out);
+    case simd_isa::sse4_1: return to_ymd_secs_sse4_1(in, n, out);
+#endif
+    default:               return to_ymd_secs_generic(in, n, out);
+    }
+}
+
+void to_sys_days(simd_isa isa, const_ymd_columns in, std::size_t n, date::sys_days* out)
+{
+    switch(is_supported(isa) ? isa : detect_simd_isa())
+    {
+#if CHRONO_DATE_HAS_X86_DISPATCH
+    case simd_isa::avx512: return to_sys_days_avx512(in, n, out);
+    case simd_isa::avx2:   return to_sys_days_avx2(in, n, out);
+    case simd_isa::sse4_1: return to_sys_days_sse4_1(in, n, out);
+#endif
+    default:               return to_sys_days_generic(in, n, out);
+    }
+}
+
+void calendar_difference(simd_isa isa, const_ymd_columns from, const_ymd_columns to, std::size_t n,
+                         difference_unit unit, calendar_difference_columns out)
+{
+    switch(is_supported(isa) ? isa : detect_simd_isa())
+    {
+#if CHRONO_DATE_HAS_X86_DISPATCH
+    case simd_isa::avx512: return calendar_difference_avx512(from, to, n, unit, out);
+    case simd_isa::avx2:   return calendar_difference_avx2(from, to, n, unit, out);
+    case simd_isa::sse4_1: return calendar_difference_sse4_1(from, to, n, unit, out);
+#endif
+    default:               return calendar_difference_generic(from, to, n, unit, out);
+    }
+}
+
+void to_ymd(const date::sys_days* in, std::size_t n, ymd_columns out)
+{
+    to_ymd(detect_simd_isa(), in, n, out);
+}
+
+void to_ymd(const date::sys_seconds* in, std::size_t n, ymd_columns out)
+{
+    to_ymd(detect_simd_isa(), in, n, out);
+}
+
+void to_sys_days(const_ymd_columns in, std::size_t n, date::sys_days* out)
+{
+    to_sys_days(detect_simd_isa(), in, n, out);
+}
+
+void calendar_difference(const_ymd_columns from, const_ymd_columns to, std::size_t n, difference_unit unit,
+                         calendar_difference_columns out)
+{
+    calendar_difference(detect_simd_isa(), from, to, n, unit, out);
+}
+
+void parallel_calendar_difference(const_ymd_columns from, const_ymd_columns to, std::size_t n,
+                                  difference_unit unit, calendar_difference_columns out, unsigned threads)
+{
+    if(threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = static_cast<unsigned>(std::min<std::size_t>(threads, std::max<std::size_t>(n / min_part, 1)));
+    const auto isa = detect_simd_isa();
+    // parts are whole blocks, so that only the last one has a remainder
+    const auto part = ((n + threads - 1) / threads + block - 1) / block * block;
+    auto work = [&](std::size_t i)
+    {
+        if(i >= n)
+            return;
+        const auto count = std::min(part, n - i);
+        const auto at = [i](std::int32_t* column) { return column != nullptr ? column + i : nullptr; };
+        calendar_difference(isa,
+                            {from.year + i, from.month + i, from.day + i},
+                            {to.year + i, to.month + i, to.day + i},
+                            count, unit, {at(out.years), at(out.months), at(out.days)});
+    };
+    std::vector<std::thread> pool;
+    pool.reserve(threads - 1);
+    for(unsigned w = 1; w < threads; ++w)
+        pool.emplace_back(work, w * part);
+    work(0);
+    for(auto& t : pool)
+        t.join();
+}
+
+}
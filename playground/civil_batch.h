@@ -0,0 +1,92 @@
+#ifndef CHRONO_DATE_CIVIL_BATCH_H
+#define CHRONO_DATE_CIVIL_BATCH_H
+
+// Conversion of many serial dates to field based dates and back.
+//
+// Results are identical to year_month_day{sys_days} and sys_days{ymd}
+// for every date in the range of date::year, including dates before 1970.
+// Like sys_days{ymd}, days past the end of a month carry over into the
+// following month.
+//
+// calendar_difference computes ages, tenures and terms: the whole years or
+// months from one date to another, like the month subtraction and day
+// comparison of calc_age, and the days left over.
+
+#include "simd_dispatch.h"
+#include <date/date.h>
+#include <cstddef>
+#include <cstdint>
+
+namespace chrono_date
+{
+
+// structure of arrays of year_month_day fields
+// the field types are the representations of date::year, month and day
+struct ymd_columns
+{
+    std::int16_t* year;
+    std::uint8_t* month;
+    std::uint8_t* day;
+};
+
+struct const_ymd_columns
+{
+    const std::int16_t* year;
+    const std::uint8_t* month;
+    const std::uint8_t* day;
+};
+
+// out[i] = year_month_day{in[i]} for i in [0, n)
+void to_ymd(const date::sys_days* in, std::size_t n, ymd_columns out);
+void to_ymd(simd_isa isa, const date::sys_days* in, std::size_t n, ymd_columns out);
+
+// out[i] = year_month_day{floor<days>(in[i])} for i in [0, n)
+void to_ymd(const date::sys_seconds* in, std::size_t n, ymd_columns out);
+void to_ymd(simd_isa isa, const date::sys_seconds* in, std::size_t n, ymd_columns out);
+
+// out[i] = sys_days{in.year[i] / in.month[i] / in.day[i]} for i in [0, n)
+// months have to be in [1, 12]
+void to_sys_days(const_ymd_columns in, std::size_t n, date::sys_days* out);
+void to_sys_days(simd_isa isa, const_ymd_columns in, std::size_t n, date::sys_days* out);
+
+enum class difference_unit
+{
+    years,
+    months,
+    // whole years, and the whole months on top of them
+    years_months
+};
+
+// structure of arrays of calendar differences
+// columns that are nullptr, or years for difference_unit::months and
+// months for difference_unit::years, are not written
+struct calendar_difference_columns
+{
+    std::int32_t* years;
+    std::int32_t* months;
+    std::int32_t* days;
+};
+
+// For i in [0, n) the calendar difference from from[i] to to[i]: the
+// months between them are
+//   to.year / to.month - from.year / from.month - months{to.day < from.day}
+// of which years are the floor to whole years. days are the days from the
+// last anniversary, or monthly anniversary for months and years_months,
+// at or before to: from plus the whole years or months, with its day
+// clamped to the end of the month, so that February 29th has its
+// anniversary on February 28th in years that are no leap years. days is
+// never negative, years and months are if to is before from.
+void calendar_difference(const_ymd_columns from, const_ymd_columns to, std::size_t n, difference_unit unit,
+                         calendar_difference_columns out);
+void calendar_difference(simd_isa isa, const_ymd_columns from, const_ymd_columns to, std::size_t n,
+                         difference_unit unit, calendar_difference_columns out);
+
+// The same on threads threads, 0 for one per hardware thread, each taking
+// a contiguous part of the dates. Inputs too small to be worth a thread
+// are done on the calling thread.
+void parallel_calendar_difference(const_ymd_columns from, const_ymd_columns to, std::size_t n,
+                                  difference_unit unit, calendar_difference_columns out, unsigned threads = 0);
+
+}
+
+#endif
@@ -0,0 +1,225 @@
+#include "current_zone_cache.h"
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#if !defined(_WIN32)
+#include <climits>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace chrono_date
+{
+
+namespace detail
+{
+
+std::atomic<const date::time_zone*> cached_current_zone{nullptr};
+
+}
+
+namespace
+{
+
+// serializes resolving and dropping the cached zone
+std::mutex resolve_mutex;
+std::atomic<std::uint64_t> resolutions{0};
+
+// what is known about /etc/localtime, equal as long as it did not change
+struct localtime_stamp
+{
+    bool exists = false;
+    std::uint64_t device = 0;
+    std::uint64_t inode = 0;
+    std::int64_t mtime_sec = 0;
+    std::int64_t mtime_nsec = 0;
+    std::int64_t size = 0;
+    std::string target;
+
+    friend bool operator==(const localtime_stamp& a, const localtime_stamp& b)
+    {
+        return a.exists == b.exists && a.device == b.device && a.inode == b.inode &&
+               a.mtime_sec == b.mtime_sec && a.mtime_nsec == b.mtime_nsec &&
+               a.size == b.size && a.target == b.target;
+    }
+
+    friend bool operator!=(const localtime_stamp& a, const localtime_stamp& b)
+    {
+        return !(a == b);
+    }
+};
+
+localtime_stamp stamp_localtime(const std::string& file)
+{
+    localtime_stamp s;
+#if !defined(_WIN32)
+    // the link itself and, through stat, the file it points to
+    const auto path = file.c_str();
+    struct stat st;
+    if(::lstat(path, &st) != 0)
+        return s;
+    s.exists = true;
+    if(S_ISLNK(st.st_mode))
+    {
+        char buf[PATH_MAX];
+        const auto n = ::readlink(path, buf, sizeof buf);
+        if(n > 0)
+            s.target.assign(buf, static_cast<std::size_t>(n));
+        if(::stat(path, &st) != 0)
+            return s;
+    }
+    s.device = static_cast<std::uint64_t>(st.st_dev);
+    s.inode = static_cast<std::uint64_t>(st.st_ino);
+#if defined(__APPLE__)
+    s.mtime_sec = static_cast<std::int64_t>(st.st_mtimespec.tv_sec);
+    s.mtime_nsec = static_cast<std::int64_t>(st.st_mtimespec.tv_nsec);
+#else
+    s.mtime_sec = static_cast<std::int64_t>(st.st_mtim.tv_sec);
+    s.mtime_nsec = static_cast<std::int64_t>(st.st_mtim.tv_nsec);
+#endif
+    s.size = static_cast<std::int64_t>(st.st_size);
+#endif
+    return s;
+}
+
+class localtime_watcher
+{
+public:
+    ~localtime_watcher()
+    {
+        std::unique_lock<std::mutex> lock{mutex_};
+        stop(lock);
+    }
+
+    // starts checking with the current interval, if not yet done
+    void start()
+    {
+        std::unique_lock<std::mutex> lock{mutex_};
+        if(!started_)
+        {
+            started_ = true;
+            restart(lock);
+        }
+    }
+
+    void set_interval(std::chrono::milliseconds interval)
+    {
+        std::unique_lock<std::mutex> lock{mutex_};
+        interval_ = interval;
+        if(started_)
+            restart(lock);
+    }
+
+    // changes are looked for from the current state of path on
+    void set_path(const std::string& path)
+    {
+        std::unique_lock<std::mutex> lock{mutex_};
+        path_ = path;
+        last_ = stamp_localtime(path_);
+    }
+
+private:
+    void restart(std::unique_lock<std::mutex>& lock)
+    {
+        stop(lock);
+        if(interval_ <= std::chrono::milliseconds::zero())
+            return;
+        stopping_ = false;
+        last_ = stamp_localtime(path_);
+        thread_ = std::thread{[this] { run(); }};
+    }
+
+    void stop(std::unique_lock<std::mutex>& lock)
+    {
+        if(!thread_.joinable())
+            return;
+        stopping_ = true;
+        changed_.notify_all();
+        lock.unlock();
+        thread_.join();
+        lock.lock();
+    }
+
+    void run()
+    {
+        std::unique_lock<std::mutex> lock{mutex_};
+        while(!changed_.wait_for(lock, interval_, [this] { return stopping_; }))
+        {
+            const auto path = path_;
+            lock.unlock();
+            const auto now = stamp_localtime(path);
+            lock.lock();
+            if(path == path_ && now != last_)
+            {
+                last_ = now;
+                invalidate_current_zone();
+            }
+        }
+    }
+
+    std::mutex mutex_;
+    std::condition_variable changed_;
+    std::thread thread_;
+    std::chrono::milliseconds interval_{1000};
+    std::string path_{"/etc/localtime"};
+    bool started_ = false;
+    bool stopping_ = false;
+    localtime_stamp last_;
+};
+
+localtime_watcher& watcher()
+{
+    static localtime_watcher w;
+    return w;
+}
+
+}
+
+namespace detail
+{
+
+const date::time_zone* resolve_current_zone()
+{
+    // the stamp is taken before the zone is resolved, so that no change
+    // in between goes unnoticed
+    watcher().start();
+    std::lock_guard<std::mutex> lock{resolve_mutex};
+    auto zone = cached_current_zone.load(std::memory_order_acquire);
+    if(zone == nullptr)
+    {
+        zone = date::current_zone();
+        resolutions.fetch_add(1, std::memory_order_relaxed);
+        count_metric(metric_counter::current_zone_resolutions);
+        cached_current_zone.store(zone, std::memory_order_release);
+    }
+    return zone;
+}
+
+void set_watched_localtime_path(const std::string& path)
+{
+    watcher().set_path(path);
+}
+
+}
+
+// the lock keeps a resolution that is under way from storing the zone
+// this drops
+void invalidate_current_zone()
+{
+    std::lock_guard<std::mutex> lock{resolve_mutex};
+    detail::cached_current_zone.store(nullptr, std::memory_order_release);
+}
+
+void set_current_zone_check_interval(std::chrono::milliseconds interval)
+{
+    watcher().set_interval(interval);
+}
+
+std::uint64_t current_zone_resolutions() noexcept
+{
+    return resolutions.load(std::memory_order_relaxed);
+}
+
+}
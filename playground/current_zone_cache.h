@@ -0,0 +1,59 @@
+#ifndef CHRONO_DATE_CURRENT_ZONE_CACHE_H
+#define CHRONO_DATE_CURRENT_ZONE_CACHE_H
+
+// date::current_zone() resolved once per process.
+//
+// After the first call cached_current_zone is a single atomic load. A
+// background thread checks /etc/localtime at an interval and drops the
+// cached zone when the file or the target of the link changed, so the
+// next call resolves it again. A process that changes its own TZ
+// variable calls invalidate_current_zone.
+
+#include "metrics.h"
+#include <date/tz.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace chrono_date
+{
+
+namespace detail
+{
+
+extern std::atomic<const date::time_zone*> cached_current_zone;
+
+const date::time_zone* resolve_current_zone();
+
+// for tests: the file the background thread watches in place of
+// /etc/localtime. A change to it only drops the cached zone; resolving it
+// again still calls date::current_zone(), which reads the real
+// /etc/localtime or TZ.
+void set_watched_localtime_path(const std::string& path);
+
+}
+
+// date::current_zone() as of the last change that was noticed
+inline const date::time_zone* cached_current_zone()
+{
+    const auto zone = detail::cached_current_zone.load(std::memory_order_acquire);
+    if(zone == nullptr)
+        return detail::resolve_current_zone();
+    count_metric(metric_counter::current_zone_hits);
+    return zone;
+}
+
+// the next cached_current_zone calls date::current_zone() again
+void invalidate_current_zone();
+
+// how often /etc/localtime is checked, one second by default
+// zero stops checking, only invalidate_current_zone drops the zone then
+void set_current_zone_check_interval(std::chrono::milliseconds interval);
+
+// number of times date::current_zone() was called
+std::uint64_t current_zone_resolutions() noexcept;
+
+}
+
+#endif
@@ -0,0 +1,451 @@
+#ifndef CHRONO_DATE_DURATION_BATCH_H
+#define CHRONO_DATE_DURATION_BATCH_H
+
+// Conversion of many durations between periods and into hh_mm_ss fields.
+//
+// Results are identical to duration_cast, floor, ceil, round and
+// hh_mm_ss for every input, including negative ones, as long as the
+// scalar operation does not overflow.
+//
+// The divisions by the constants of the periods are multiplications by
+// a magic number and a shift (Granlund and Montgomery, "Division by
+// invariant integers using multiplication"), computed at compile time.
+// The 64 bit high multiplication is built from 32 bit products, which
+// every isa has as a vector instruction, so the loops vectorize. Kernels
+// are instantiated per isa like those of civil_batch.
+
+#include "simd_dispatch.h"
+#include <date/date.h>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ratio>
+#include <type_traits>
+
+namespace chrono_date
+{
+
+// structure of arrays of hh_mm_ss<Duration> fields; subseconds counts
+// hh_mm_ss<Duration>::precision and negative is 1 for negative durations
+template<class Duration>
+struct hh_mm_ss_columns
+{
+    std::uint8_t* negative;
+    std::chrono::hours::rep* hours;
+    std::uint8_t* minutes;
+    std::uint8_t* seconds;
+    typename date::hh_mm_ss<Duration>::precision::rep* subseconds;
+};
+
+namespace detail
+{
+
+constexpr unsigned ceil_log2(std::uint64_t d)
+{
+    unsigned l = 0;
+    while((std::uint64_t{1} << l) < d)
+        ++l;
+    return l;
+}
+
+// 2^k / d rounded up, by long division one bit at a time
+constexpr std::uint64_t ceil_pow2_div(unsigned k, std::uint64_t d)
+{
+    std::uint64_t q = 0;
+    std::uint64_t r = 1;
+    for(unsigned i = 0; i < k; ++i)
+    {
+        r <<= 1;
+        q <<= 1;
+        if(r >= d)
+        {
+            r -= d;
+            q |= 1;
+        }
+    }
+    return q + (r != 0);
+}
+
+// the high half of a * b from four 32 bit products
+CHRONO_DATE_ALWAYS_INLINE
+std::uint64_t mul_high(std::uint64_t a, std::uint64_t b)
+{
+    const auto a0 = std::uint64_t{static_cast<std::uint32_t>(a)};
+    const auto a1 = std::uint64_t{static_cast<std::uint32_t>(a >> 32)};
+    const auto b0 = std::uint64_t{static_cast<std::uint32_t>(b)};
+    const auto b1 = std::uint64_t{static_cast<std::uint32_t>(b >> 32)};
+    const auto p00 = a0 * b0;
+    const auto p01 = a0 * b1;
+    const auto p10 = a1 * b0;
+    const auto p11 = a1 * b1;
+    const auto mid = (p00 >> 32) + (p01 & 0xffffffff) + (p10 & 0xffffffff);
+    return p11 + (p01 >> 32) + (p10 >> 32) + (mid >> 32);
+}
+
+// v, without the optimizer knowing its value
+template<class T>
+CHRONO_DATE_ALWAYS_INLINE
+T opaque(T v)
+{
+#if defined(__GNUC__)
+    __asm__("" : "+r"(v));
+#endif
+    return v;
+}
+
+// n / D for n < 2^63: with l = ceil(log2(D)) and m = ceil(2^(63 + l) / D),
+// which is below 2^64, n / D = (n * m) >> (63 + l)
+//
+// A divider is made outside of a loop and hides m from the optimizer,
+// which would otherwise expand the vector multiplications by the
+// constant into long chains of shifts and additions.
+template<std::uint64_t D>
+class divider
+{
+public:
+    static_assert(D > 0 && D < (std::uint64_t{1} << 63), "divisor out of range");
+
+    CHRONO_DATE_ALWAYS_INLINE
+    divider()
+        : magic_(opaque(ceil_pow2_div(63 + ceil_log2(D), D)))
+    {
+    }
+
+    CHRONO_DATE_ALWAYS_INLINE
+    std::uint64_t divide(std::uint64_t n) const
+    {
+        return power_of_2 ? n >> ceil_log2(D) : mul_high(n, magic_) >> (ceil_log2(D) - 1);
+    }
+
+private:
+    static constexpr bool power_of_2 = (D & (D - 1)) == 0;
+
+    std::uint64_t magic_;
+};
+
+template<>
+class divider<1>
+{
+public:
+    CHRONO_DATE_ALWAYS_INLINE
+    std::uint64_t divide(std::uint64_t n) const
+    {
+        return n;
+    }
+};
+
+// all ones for negative n, else 0; without an arithmetic shift, which
+// no isa before avx512 has for 64 bit lanes
+CHRONO_DATE_ALWAYS_INLINE
+std::uint64_t sign_mask(std::int64_t n)
+{
+    return 0 - (static_cast<std::uint64_t>(n) >> 63);
+}
+
+// floor(n / D) for any n; for negative n that is ~(~n / D), with ~n >= 0
+template<std::uint64_t D>
+CHRONO_DATE_ALWAYS_INLINE
+std::int64_t floor_divide(const divider<D>& d, std::int64_t n)
+{
+    const auto sign = sign_mask(n);
+    return static_cast<std::int64_t>(d.divide(static_cast<std::uint64_t>(n) ^ sign) ^ sign);
+}
+
+// What to add to the quotient q = floor(x / D) with remainder r. The
+// conditions are the top bits of differences instead of comparisons,
+// every operand is below 2^63.
+struct truncating
+{
+    template<std::uint64_t D>
+    CHRONO_DATE_ALWAYS_INLINE
+    static std::uint64_t adjust(std::int64_t, std::uint64_t r, std::int64_t x)
+    {
+        // r != 0 && x < 0
+        return ((0 - r) & static_cast<std::uint64_t>(x)) >> 63;
+    }
+};
+
+struct flooring
+{
+    template<std::uint64_t D>
+    CHRONO_DATE_ALWAYS_INLINE
+    static std::uint64_t adjust(std::int64_t, std::uint64_t, std::int64_t)
+    {
+        return 0;
+    }
+};
+
+struct ceiling
+{
+    template<std::uint64_t D>
+    CHRONO_DATE_ALWAYS_INLINE
+    static std::uint64_t adjust(std::int64_t, std::uint64_t r, std::int64_t)
+    {
+        // r != 0
+        return (0 - r) >> 63;
+    }
+};
+
+// to nearest, ties to even
+struct rounding
+{
+    template<std::uint64_t D>
+    CHRONO_DATE_ALWAYS_INLINE
+    static std::uint64_t adjust(std::int64_t q, std::uint64_t r, std::int64_t)
+    {
+        // 2 * r > D, or 2 * r == D and q is odd
+        return (D - (2 * r + (static_cast<std::uint64_t>(q) & 1))) >> 63;
+    }
+};
+
+// the conversion of duration_cast, in the common representation of both
+// durations and intmax_t, which is 64 bits wide
+template<class To, class From>
+struct conversion
+{
+    static_assert(std::is_integral<typename To::rep>::value && std::is_integral<typename From::rep>::value,
+                  "only integral durations can be converted in batches");
+    using factor = std::ratio_divide<typename From::period, typename To::period>;
+    static constexpr auto num = static_cast<std::int64_t>(factor::num);
+    static constexpr auto den = static_cast<std::uint64_t>(factor::den);
+};
+
+// elements per vectorized loop; a fixed trip count lets the compiler
+// vectorize without a remainder loop at -O2
+constexpr std::size_t batch_block = 32;
+
+template<class Rounding, class To, class From>
+CHRONO_DATE_ALWAYS_INLINE
+To convert_one(const divider<conversion<To, From>::den>& by, From d)
+{
+    using c = conversion<To, From>;
+    const auto x = static_cast<std::int64_t>(d.count()) * c::num;
+    const auto q = floor_divide(by, x);
+    const auto r = static_cast<std::uint64_t>(x) - static_cast<std::uint64_t>(q) * c::den;
+    return To{static_cast<typename To::rep>(static_cast<std::uint64_t>(q) + Rounding::template adjust<c::den>(q, r, x))};
+}
+
+template<class Rounding, class To, class From>
+CHRONO_DATE_ALWAYS_INLINE
+void convert_block(const divider<conversion<To, From>::den>& by, const From* CHRONO_DATE_RESTRICT in,
+                   To* CHRONO_DATE_RESTRICT out)
+{
+    for(std::size_t i = 0; i < batch_block; ++i)
+        out[i] = convert_one<Rounding, To>(by, in[i]);
+}
+
+template<class Rounding, class To, class From>
+CHRONO_DATE_ALWAYS_INLINE
+void convert_loop(const From* in, std::size_t n, To* out)
+{
+    const divider<conversion<To, From>::den> by;
+    std::size_t i = 0;
+    for(; i + batch_block <= n; i += batch_block)
+        convert_block<Rounding>(by, in + i, out + i);
+    for(; i < n; ++i)
+        out[i] = convert_one<Rounding, To>(by, in[i]);
+}
+
+// the divisions of hh_mm_ss<Duration>
+template<class Duration>
+struct split_dividers
+{
+    using precision = typename date::hh_mm_ss<Duration>::precision;
+    using period = typename Duration::period;
+    // the rest of a second, in 1 / period::den, to precision
+    using rest = std::ratio_divide<std::ratio<1, period::den>, typename precision::period>;
+    static constexpr auto hour = std::uint64_t{3600} * static_cast<std::uint64_t>(period::den);
+    // an hour of 1 / period::den fits 32 bits for milli and microseconds
+    static constexpr bool narrow = hour <= 0xffffffff;
+
+    divider<static_cast<std::uint64_t>(period::den)> by_den;
+    divider<3600> by_3600;
+    divider<hour> by_hour;
+    divider<static_cast<std::uint64_t>(rest::den)> by_rest;
+};
+
+// Hours, or whole seconds, are split off in Duration, so that nothing
+// overflows that does not in hh_mm_ss. What is left of the hour is done
+// in 32 bits where it fits, which is what most isas have vector
+// multiplications for. The rest of the second is converted to the
+// precision of hh_mm_ss, truncating where it does not divide Duration.
+template<class Duration>
+CHRONO_DATE_ALWAYS_INLINE
+void split_one(const split_dividers<Duration>& by, Duration d, std::uint8_t& negative,
+               std::chrono::hours::rep& hours, std::uint8_t& minutes, std::uint8_t& seconds,
+               typename date::hh_mm_ss<Duration>::precision::rep& subseconds)
+{
+    static_assert(std::is_integral<typename Duration::rep>::value, "only integral durations can be split in batches");
+    using dividers = split_dividers<Duration>;
+    constexpr auto num = static_cast<std::uint64_t>(dividers::period::num);
+    constexpr auto den = static_cast<std::uint64_t>(dividers::period::den);
+
+    const auto v = static_cast<std::int64_t>(d.count());
+    const auto sign = sign_mask(v);
+    const auto x = ((static_cast<std::uint64_t>(v) ^ sign) - sign) * num;
+    std::uint64_t h;
+    std::uint32_t s;
+    std::uint64_t r;
+    if(dividers::narrow)
+    {
+        h = by.by_hour.divide(x);
+        const auto t = static_cast<std::uint32_t>(x) - static_cast<std::uint32_t>(h) * static_cast<std::uint32_t>(dividers::hour);
+        s = t / static_cast<std::uint32_t>(den);
+        r = t - s * static_cast<std::uint32_t>(den);
+    }
+    else
+    {
+        const auto all = by.by_den.divide(x);
+        h = by.by_3600.divide(all);
+        s = static_cast<std::uint32_t>(all - 3600 * h);
+        r = x - all * den;
+    }
+    negative = static_cast<std::uint8_t>(sign & 1);
+    hours = static_cast<std::chrono::hours::rep>(h);
+    minutes = static_cast<std::uint8_t>(s / 60);
+    seconds = static_cast<std::uint8_t>(s % 60);
+    subseconds = static_cast<typename dividers::precision::rep>(
+        by.by_rest.divide(r * static_cast<std::uint64_t>(dividers::rest::num)));
+}
+
+template<class Duration>
+CHRONO_DATE_ALWAYS_INLINE
+void split_block(const split_dividers<Duration>& by,
+                 const Duration* CHRONO_DATE_RESTRICT in,
+                 std::uint8_t* CHRONO_DATE_RESTRICT negative,
+                 std::chrono::hours::rep* CHRONO_DATE_RESTRICT hours,
+                 std::uint8_t* CHRONO_DATE_RESTRICT minutes,
+                 std::uint8_t* CHRONO_DATE_RESTRICT seconds,
+                 typename date::hh_mm_ss<Duration>::precision::rep* CHRONO_DATE_RESTRICT subseconds)
+{
+    for(std::size_t i = 0; i < batch_block; ++i)
+        split_one(by, in[i], negative[i], hours[i], minutes[i], seconds[i], subseconds[i]);
+}
+
+template<class Duration>
+CHRONO_DATE_ALWAYS_INLINE
+void split_loop(const Duration* in, std::size_t n, hh_mm_ss_columns<Duration> out)
+{
+    const split_dividers<Duration> by{};
+    std::size_t i = 0;
+    for(; i + batch_block <= n; i += batch_block)
+        split_block(by, in + i, out.negative + i, out.hours + i, out.minutes + i, out.seconds + i,
+                    out.subseconds + i);
+    for(; i < n; ++i)
+        split_one(by, in[i], out.negative[i], out.hours[i], out.minutes[i], out.seconds[i], out.subseconds[i]);
+}
+
+#define CHRONO_DATE_DURATION_KERNELS(suffix, target)                                     \
+    template<class Rounding, class To, class From>                                      \
+    target void convert_##suffix(const From* in, std::size_t n, To* out)                \
+    {                                                                                   \
+        convert_loop<Rounding>(in, n, out);                                             \
+    }                                                                                   \
+    template<class Duration>                                                            \
+    target void split_##suffix(const Duration* in, std::size_t n,                       \
+                               hh_mm_ss_columns<Duration> out)                          \
+    {                                                                                   \
+        split_loop(in, n, out);                                                         \
+    }
+
+CHRONO_DATE_DURATION_KERNELS(generic, )
+#if CHRONO_DATE_HAS_X86_DISPATCH
+CHRONO_DATE_DURATION_KERNELS(sse4_1, CHRONO_DATE_TARGET_SSE4_1)
+CHRONO_DATE_DURATION_KERNELS(avx2, CHRONO_DATE_TARGET_AVX2)
+CHRONO_DATE_DURATION_KERNELS(avx512, CHRONO_DATE_TARGET_AVX512)
+#endif
+
+#undef CHRONO_DATE_DURATION_KERNELS
+
+template<class Rounding, class To, class From>
+void convert(simd_isa isa, const From* in, std::size_t n, To* out)
+{
+    switch(is_supported(isa) ? isa : detect_simd_isa())
+    {
+#if CHRONO_DATE_HAS_X86_DISPATCH
+    case simd_isa::avx512: return convert_avx512<Rounding>(in, n, out);
+    case simd_isa::avx2:   return convert_avx2<Rounding>(in, n, out);
+    case simd_isa::sse4_1: return convert_sse4_1<Rounding>(in, n, out);
+#endif
+    default:               return convert_generic<Rounding>(in, n, out);
+    }
+}
+
+}
+
+// out[i] = duration_cast<To>(in[i]) for i in [0, n)
+template<class To, class Rep, class Period>
+void duration_cast_batch(simd_isa isa, const std::chrono::duration<Rep, Period>* in, std::size_t n, To* out)
+{
+    detail::convert<detail::truncating>(isa, in, n, out);
+}
+
+template<class To, class Rep, class Period>
+void duration_cast_batch(const std::chrono::duration<Rep, Period>* in, std::size_t n, To* out)
+{
+    detail::convert<detail::truncating>(detect_simd_isa(), in, n, out);
+}
+
+// out[i] = floor<To>(in[i]) for i in [0, n)
+template<class To, class Rep, class Period>
+void floor_batch(simd_isa isa, const std::chrono::duration<Rep, Period>* in, std::size_t n, To* out)
+{
+    detail::convert<detail::flooring>(isa, in, n, out);
+}
+
+template<class To, class Rep, class Period>
+void floor_batch(const std::chrono::duration<Rep, Period>* in, std::size_t n, To* out)
+{
+    detail::convert<detail::flooring>(detect_simd_isa(), in, n, out);
+}
+
+// out[i] = ceil<To>(in[i]) for i in [0, n)
+template<class To, class Rep, class Period>
+void ceil_batch(simd_isa isa, const std::chrono::duration<Rep, Period>* in, std::size_t n, To* out)
+{
+    detail::convert<detail::ceiling>(isa, in, n, out);
+}
+
+template<class To, class Rep, class Period>
+void ceil_batch(const std::chrono::duration<Rep, Period>* in, std::size_t n, To* out)
+{
+    detail::convert<detail::ceiling>(detect_simd_isa(), in, n, out);
+}
+
+// out[i] = round<To>(in[i]) for i in [0, n)
+template<class To, class Rep, class Period>
+void round_batch(simd_isa isa, const std::chrono::duration<Rep, Period>* in, std::size_t n, To* out)
+{
+    detail::convert<detail::rounding>(isa, in, n, out);
+}
+
+template<class To, class Rep, class Period>
+void round_batch(const std::chrono::duration<Rep, Period>* in, std::size_t n, To* out)
+{
+    detail::convert<detail::rounding>(detect_simd_isa(), in, n, out);
+}
+
+// the fields of hh_mm_ss<Duration>{in[i]} at i of out for i in [0, n)
+template<class Duration>
+void split_batch(simd_isa isa, const Duration* in, std::size_t n, hh_mm_ss_columns<Duration> out)
+{
+    switch(is_supported(isa) ? isa : detect_simd_isa())
+    {
+#if CHRONO_DATE_HAS_X86_DISPATCH
+    case simd_isa::avx512: return detail::split_avx512(in, n, out);
+    case simd_isa::avx2:   return detail::split_avx2(in, n, out);
+    case simd_isa::sse4_1: return detail::split_sse4_1(in, n, out);
+#endif
+    default:               return detail::split_generic(in, n, out);
+    }
+}
+
+template<class Duration>
+void split_batch(const Duration* in, std::size_t n, hh_mm_ss_columns<Duration> out)
+{
+    split_batch(detect_simd_isa(), in, n, out);
+}
+
+}
+
+#endif
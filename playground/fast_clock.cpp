@@ -0,0 +1,278 @@
+#include "fast_clock.h"
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#if CHRONO_DATE_HAS_TSC
+#include <cpuid.h>
+#endif
+
+namespace chrono_date
+{
+
+namespace detail
+{
+
+std::atomic<std::int64_t> coarse_system_now{0};
+std::atomic<std::int64_t> coarse_steady_now{0};
+tsc_calibration tsc_calibration_data;
+std::atomic<std::uint64_t> cached_today{0};
+
+}
+
+namespace
+{
+
+std::atomic<std::uint64_t> drift_corrections{0};
+std::atomic<std::int64_t> drift_tolerance{20000};
+
+std::int64_t steady_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool invariant_tsc()
+{
+#if CHRONO_DATE_HAS_TSC
+    unsigned a, b, c, d;
+    if(__get_cpuid(0x80000000, &a, &b, &c, &d) == 0 || a < 0x80000007)
+        return false;
+    __get_cpuid(0x80000007, &a, &b, &c, &d);
+    return (d & (1u << 8)) != 0;
+#else
+    return false;
+#endif
+}
+
+// what the current calibration makes of tsc, only called by the writer
+std::int64_t map_tsc(std::uint64_t tsc)
+{
+    const auto& c = detail::tsc_calibration_data;
+    const auto base = c.tsc.load(std::memory_order_relaxed);
+    const auto ticks = tsc > base ? tsc - base : 0;
+    return c.ns.load(std::memory_order_relaxed) +
+           static_cast<std::int64_t>(detail::scale_ticks(ticks, c.scale.load(std::memory_order_relaxed)));
+}
+
+// the first calibration and the samples drift is measured against,
+// only touched by the thread that holds calibration_mutex
+struct tsc_reference
+{
+    std::uint64_t tsc = 0;
+    std::int64_t ns = 0;
+};
+
+std::mutex calibration_mutex;
+tsc_reference reference;
+
+// ns per tick * 2^32 from two samples
+std::uint64_t scale_of(std::uint64_t tsc0, std::int64_t ns0, std::uint64_t tsc1, std::int64_t ns1)
+{
+    return static_cast<std::uint64_t>(static_cast<double>(ns1 - ns0) / static_cast<double>(tsc1 - tsc0) * 4294967296.0);
+}
+
+bool calibrate_tsc()
+{
+    if(!invariant_tsc())
+        return false;
+    std::lock_guard<std::mutex> lock{calibration_mutex};
+    reference.tsc = detail::read_tsc();
+    reference.ns = steady_ns();
+    std::this_thread::sleep_for(std::chrono::milliseconds{10});
+    const auto tsc = detail::read_tsc();
+    const auto ns = steady_ns();
+    if(tsc <= reference.tsc)
+        return false;
+    auto& c = detail::tsc_calibration_data;
+    c.tsc.store(tsc, std::memory_order_relaxed);
+    c.ns.store(ns, std::memory_order_relaxed);
+    c.scale.store(scale_of(reference.tsc, reference.ns, tsc, ns), std::memory_order_relaxed);
+    c.sequence.store(2, std::memory_order_release);
+    return true;
+}
+
+// Compares tsc_clock with steady_clock and picks the scale that makes it
+// meet steady_clock after interval. The new calibration starts at the
+// value the old one has at that counter, unless tsc_clock fell behind by
+// more than the tolerance, then it jumps forward to steady_clock.
+void correct_tsc_drift(std::chrono::nanoseconds interval)
+{
+    std::lock_guard<std::mutex> lock{calibration_mutex};
+    auto& c = detail::tsc_calibration_data;
+    const auto ns = steady_ns();
+    const auto tsc = detail::read_tsc();
+    if(tsc <= reference.tsc || ns <= reference.ns)
+        return;
+    const auto error = map_tsc(tsc) - ns;
+    const auto tolerance = drift_tolerance.load(std::memory_order_relaxed);
+    if(error > tolerance || error < -tolerance)
+        drift_corrections.fetch_add(1, std::memory_order_relaxed);
+
+    const auto rate = static_cast<double>(scale_of(reference.tsc, reference.ns, tsc, ns));
+
+    // readers that see the old calibration read the counter before this
+    const auto sequence = c.sequence.load(std::memory_order_relaxed);
+    c.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    const auto at = detail::read_tsc();
+    auto base = map_tsc(at);
+    const auto steady = steady_ns();
+    if(error < -tolerance)
+        base = std::max(base, steady);
+
+    // the long run rate, slowed down or sped up by at most a half to
+    // make up for what is left of the error
+    const auto span = static_cast<double>(interval.count());
+    const auto catch_up = std::min(std::max((span - static_cast<double>(base - steady)) / span, 0.5), 1.5);
+    const auto scale = static_cast<std::uint64_t>(rate * catch_up);
+    c.tsc.store(at, std::memory_order_relaxed);
+    c.ns.store(base, std::memory_order_relaxed);
+    c.scale.store(scale, std::memory_order_relaxed);
+    c.sequence.store(sequence + 2, std::memory_order_release);
+}
+
+class clock_ticker
+{
+public:
+    ~clock_ticker()
+    {
+        std::unique_lock<std::mutex> lock{mutex_};
+        stop(lock);
+    }
+
+    void start()
+    {
+        std::unique_lock<std::mutex> lock{mutex_};
+        if(!started_)
+        {
+            started_ = true;
+            tick();
+            restart(lock);
+        }
+    }
+
+    void set_resolution(std::chrono::microseconds resolution)
+    {
+        std::unique_lock<std::mutex> lock{mutex_};
+        resolution_ = resolution;
+        if(started_)
+            restart(lock);
+    }
+
+private:
+    static void tick()
+    {
+        detail::coarse_system_now.store(std::chrono::system_clock::now().time_since_epoch().count(),
+                                        std::memory_order_relaxed);
+        detail::coarse_steady_now.store(std::chrono::steady_clock::now().time_since_epoch().count(),
+                                        std::memory_order_relaxed);
+    }
+
+    void restart(std::unique_lock<std::mutex>& lock)
+    {
+        stop(lock);
+        if(resolution_ <= std::chrono::microseconds::zero())
+            return;
+        stopping_ = false;
+        thread_ = std::thread{[this] { run(); }};
+    }
+
+    void stop(std::unique_lock<std::mutex>& lock)
+    {
+        if(!thread_.joinable())
+            return;
+        stopping_ = true;
+        stopped_.notify_all();
+        lock.unlock();
+        thread_.join();
+        lock.lock();
+    }
+
+    void run()
+    {
+        const auto drift_interval = std::chrono::seconds{1};
+        auto next_drift_check = std::chrono::steady_clock::now() + drift_interval;
+        std::unique_lock<std::mutex> lock{mutex_};
+        while(!stopped_.wait_for(lock, resolution_, [this] { return stopping_; }))
+        {
+            tick();
+            const auto now = std::chrono::steady_clock::now();
+            if(now >= next_drift_check)
+            {
+                next_drift_check = now + drift_interval;
+                lock.unlock();
+                // only once tsc_clock was calibrated by its first use
+                if(detail::tsc_calibration_data.sequence.load(std::memory_order_acquire) != 0)
+                    correct_tsc_drift(drift_interval);
+                lock.lock();
+            }
+        }
+    }
+
+    std::mutex mutex_;
+    std::condition_variable stopped_;
+    std::thread thread_;
+    std::chrono::microseconds resolution_{1000};
+    bool started_ = false;
+    bool stopping_ = false;
+};
+
+clock_ticker& ticker()
+{
+    static clock_ticker t;
+    return t;
+}
+
+}
+
+namespace detail
+{
+
+void start_clock_ticker()
+{
+    ticker().start();
+}
+
+bool tsc_usable()
+{
+    static const auto usable = []
+    {
+        const auto calibrated = calibrate_tsc();
+        if(calibrated)
+            start_clock_ticker();
+        return calibrated;
+    }();
+    return usable;
+}
+
+date::year_month_day update_cached_today(date::sys_days today)
+{
+    const auto ymd = date::year_month_day{today};
+    const auto packed = static_cast<std::uint64_t>(static_cast<std::uint32_t>(today.time_since_epoch().count())) << 32 |
+                        static_cast<std::uint64_t>(static_cast<std::uint16_t>(static_cast<int>(ymd.year()))) << 16 |
+                        static_cast<std::uint64_t>(static_cast<unsigned>(ymd.month())) << 8 |
+                        static_cast<std::uint64_t>(static_cast<unsigned>(ymd.day()));
+    cached_today.store(packed, std::memory_order_relaxed);
+    return ymd;
+}
+
+}
+
+void set_clock_ticker_resolution(std::chrono::microseconds resolution)
+{
+    ticker().set_resolution(resolution);
+}
+
+void set_tsc_drift_tolerance(std::chrono::nanoseconds tolerance)
+{
+    drift_tolerance.store(tolerance.count(), std::memory_order_relaxed);
+}
+
+std::uint64_t tsc_drift_corrections() noexcept
+{
+    return drift_corrections.load(std::memory_order_relaxed);
+}
+
+}
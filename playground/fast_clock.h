@@ -0,0 +1,190 @@
+#ifndef CHRONO_DATE_FAST_CLOCK_H
+#define CHRONO_DATE_FAST_CLOCK_H
+
+// Clocks that are cheaper to read than system_clock and steady_clock.
+//
+// coarse_system_clock and coarse_steady_clock return the time a
+// background ticker last read from system_clock and steady_clock, a
+// single atomic load. They lag behind by up to the resolution of the
+// ticker, one millisecond by default. Their time_points are those of the
+// standard clocks, so they mix with sys_days, floor<days> and zoned_time.
+//
+// tsc_clock counts the time stamp counter of the cpu, scaled to
+// steady_clock by a calibration the ticker refines every second. If the
+// counter drifts away from steady_clock further than a tolerance, the
+// scale is corrected so that tsc_clock meets steady_clock again within
+// the next second without ever going backwards. Without an invariant
+// time stamp counter tsc_clock reads steady_clock.
+//
+// cached_today is the current utc date, which is only converted from
+// the coarse system time when the day changed.
+
+#include <date/date.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#define CHRONO_DATE_HAS_TSC 1
+#else
+#define CHRONO_DATE_HAS_TSC 0
+#endif
+
+namespace chrono_date
+{
+
+namespace detail
+{
+
+// counts of the clocks as of the last tick, 0 before the ticker started
+extern std::atomic<std::int64_t> coarse_system_now;
+extern std::atomic<std::int64_t> coarse_steady_now;
+
+// starts the ticker, if not yet done, and returns after its first tick
+void start_clock_ticker();
+
+inline std::int64_t coarse_now(std::atomic<std::int64_t>& now)
+{
+    auto n = now.load(std::memory_order_relaxed);
+    if(n == 0)
+    {
+        start_clock_ticker();
+        n = now.load(std::memory_order_relaxed);
+    }
+    return n;
+}
+
+// tsc_clock::now() = ns + (tsc - tsc) * scale / 2^32, published under a
+// sequence count that is odd while the calibration changes
+struct tsc_calibration
+{
+    std::atomic<std::uint64_t> sequence{0};
+    std::atomic<std::uint64_t> tsc{0};
+    std::atomic<std::int64_t> ns{0};
+    std::atomic<std::uint64_t> scale{0};
+};
+
+extern tsc_calibration tsc_calibration_data;
+
+// true if the time stamp counter is invariant, calibrates it the first time
+bool tsc_usable();
+
+inline std::uint64_t read_tsc() noexcept
+{
+#if CHRONO_DATE_HAS_TSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+// ticks * scale / 2^32 without overflow for any ticks below 2^64 / 2^32 * scale
+inline std::uint64_t scale_ticks(std::uint64_t ticks, std::uint64_t scale) noexcept
+{
+    return (ticks >> 32) * scale + (((ticks & 0xffffffff) * scale) >> 32);
+}
+
+}
+
+struct coarse_system_clock
+{
+    using duration = std::chrono::system_clock::duration;
+    using rep = duration::rep;
+    using period = duration::period;
+    using time_point = std::chrono::system_clock::time_point;
+    static constexpr bool is_steady = false;
+
+    static time_point now()
+    {
+        return time_point{duration{detail::coarse_now(detail::coarse_system_now)}};
+    }
+};
+
+struct coarse_steady_clock
+{
+    using duration = std::chrono::steady_clock::duration;
+    using rep = duration::rep;
+    using period = duration::period;
+    using time_point = std::chrono::steady_clock::time_point;
+    static constexpr bool is_steady = true;
+
+    static time_point now()
+    {
+        return time_point{duration{detail::coarse_now(detail::coarse_steady_now)}};
+    }
+};
+
+struct tsc_clock
+{
+    using duration = std::chrono::nanoseconds;
+    using rep = duration::rep;
+    using period = duration::period;
+    using time_point = std::chrono::time_point<std::chrono::steady_clock, duration>;
+    static constexpr bool is_steady = true;
+
+    static time_point now()
+    {
+        static const auto usable = detail::tsc_usable();
+        if(!usable)
+            return std::chrono::time_point_cast<duration>(std::chrono::steady_clock::now());
+        auto& c = detail::tsc_calibration_data;
+        for(;;)
+        {
+            const auto sequence = c.sequence.load(std::memory_order_acquire);
+            const auto tsc = c.tsc.load(std::memory_order_relaxed);
+            const auto ns = c.ns.load(std::memory_order_relaxed);
+            const auto scale = c.scale.load(std::memory_order_relaxed);
+            const auto now = detail::read_tsc();
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if(sequence % 2 == 0 && c.sequence.load(std::memory_order_relaxed) == sequence)
+            {
+                // a counter read before the calibration it is newer than
+                const auto ticks = now > tsc ? now - tsc : 0;
+                return time_point{duration{ns + static_cast<std::int64_t>(detail::scale_ticks(ticks, scale))}};
+            }
+        }
+    }
+};
+
+// how often the ticker updates the coarse clocks, zero stops it
+void set_clock_ticker_resolution(std::chrono::microseconds resolution);
+
+// how far tsc_clock may be off steady_clock before it is corrected
+void set_tsc_drift_tolerance(std::chrono::nanoseconds tolerance);
+
+// number of times tsc_clock was found off by more than the tolerance
+std::uint64_t tsc_drift_corrections() noexcept;
+
+// true if tsc_clock counts the time stamp counter
+inline bool tsc_clock_is_native()
+{
+    return detail::tsc_usable();
+}
+
+namespace detail
+{
+
+// days since 1970 << 32 | year << 16 | month << 8 | day of the cached date
+extern std::atomic<std::uint64_t> cached_today;
+
+date::year_month_day update_cached_today(date::sys_days today);
+
+}
+
+// the current utc date, as of coarse_system_clock
+inline date::year_month_day cached_today()
+{
+    const auto now = coarse_system_clock::now().time_since_epoch();
+    const auto packed = detail::cached_today.load(std::memory_order_relaxed);
+    const auto begin = date::days{static_cast<std::int32_t>(packed >> 32)};
+    if(packed != 0 && begin <= now && now < begin + date::days{1})
+        return date::year_month_day{date::year{static_cast<std::int16_t>((packed >> 16) & 0xffff)},
+                                    date::month{static_cast<unsigned>((packed >> 8) & 0xff)},
+                                    date::day{static_cast<unsigned>(packed & 0xff)}};
+    return detail::update_cached_today(date::floor<date::days>(coarse_system_clock::time_point{now}));
+}
+
+}
+
+#endif
@@ -0,0 +1,130 @@
+#ifndef CHRONO_DATE_LEAP_SECOND_CURSOR_H
+#define CHRONO_DATE_LEAP_SECOND_CURSOR_H
+
+// Conversion of streams of time points between sys_time and utc_time.
+//
+// date::to_utc_time and date::to_sys_time search the leap second table of
+// the current tzdb on every call. leap_second_cursor copies the table once
+// and remembers, for either direction, between which two leap seconds the
+// last time point was. The next one is compared against those two, and
+// only if it is outside the cursor steps to its neighbours, so sorted input
+// costs O(1) per time point.
+//
+// Results are identical to date::to_utc_time and date::to_sys_time,
+// including time points inside an inserted leap second.
+
+#include <date/date.h>
+#include <date/tz.h>
+#include <chrono>
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+namespace chrono_date
+{
+
+class leap_second_cursor
+{
+public:
+    explicit leap_second_cursor(const date::tzdb& db = date::get_tzdb())
+    {
+        dates_.reserve(db.leap_seconds.size());
+        for(const auto& ls : db.leap_seconds)
+            dates_.push_back(ls.date());
+    }
+
+    // date::to_utc_time(st)
+    template<class Duration>
+    date::utc_time<typename std::common_type<Duration, std::chrono::seconds>::type>
+    to_utc_time(const date::sys_time<Duration>& st)
+    {
+        using CD = typename std::common_type<Duration, std::chrono::seconds>::type;
+        const auto k = seek(sys_, st.time_since_epoch());
+        return date::utc_time<CD>{st.time_since_epoch() + std::chrono::seconds{k}};
+    }
+
+    // date::to_sys_time(ut)
+    template<class Duration>
+    date::sys_time<typename std::common_type<Duration, std::chrono::seconds>::type>
+    to_sys_time(const date::utc_time<Duration>& ut)
+    {
+        using CD = typename std::common_type<Duration, std::chrono::seconds>::type;
+        // like date, the utc count itself is compared against the dates
+        const auto k = seek(utc_, ut.time_since_epoch());
+        auto ds = std::chrono::seconds{k};
+        bool leap = false;
+        if(k > 0)
+        {
+            const auto tp = date::sys_time<CD>{ut.time_since_epoch() - ds};
+            const auto last = dates_[static_cast<std::size_t>(k - 1)];
+            if(tp < last)
+            {
+                if(tp >= last - std::chrono::seconds{1})
+                    leap = true;
+                else
+                    --ds;
+            }
+        }
+        auto tp = date::sys_time<CD>{ut.time_since_epoch() - ds};
+        if(leap)
+            tp = date::floor<std::chrono::seconds>(tp) + std::chrono::seconds{1} - CD{1};
+        return tp;
+    }
+
+    // number of leap seconds the cursor stepped over so far
+    std::size_t steps() const noexcept
+    {
+        return steps_;
+    }
+
+private:
+    // number of leap seconds with a date at or before t, starting at the
+    // position of the last call
+    template<class Rep, class Period>
+    long seek(std::size_t& k, std::chrono::duration<Rep, Period> d)
+    {
+        const auto t = date::sys_time<std::chrono::duration<Rep, Period>>{d};
+        while(k < dates_.size() && dates_[k] <= t)
+        {
+            ++k;
+            ++steps_;
+        }
+        while(k > 0 && t < dates_[k - 1])
+        {
+            --k;
+            ++steps_;
+        }
+        return static_cast<long>(k);
+    }
+
+    std::vector<date::sys_seconds> dates_;
+    std::size_t sys_ = 0;
+    std::size_t utc_ = 0;
+    std::size_t steps_ = 0;
+};
+
+// out[i] = date::to_utc_time(in[i]) for i in [0, n)
+template<class Duration>
+void to_utc_time(const date::sys_time<Duration>* in,
+                 std::size_t n,
+                 date::utc_time<typename std::common_type<Duration, std::chrono::seconds>::type>* out)
+{
+    leap_second_cursor cursor;
+    for(std::size_t i = 0; i < n; ++i)
+        out[i] = cursor.to_utc_time(in[i]);
+}
+
+// out[i] = date::to_sys_time(in[i]) for i in [0, n)
+template<class Duration>
+void to_sys_time(const date::utc_time<Duration>* in,
+                 std::size_t n,
+                 date::sys_time<typename std::common_type<Duration, std::chrono::seconds>::type>* out)
+{
+    leap_second_cursor cursor;
+    for(std::size_t i = 0; i < n; ++i)
+        out[i] = cursor.to_sys_time(in[i]);
+}
+
+}
+
+#endif
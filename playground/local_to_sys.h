@@ -0,0 +1,205 @@
+#ifndef CHRONO_DATE_LOCAL_TO_SYS_H
+#define CHRONO_DATE_LOCAL_TO_SYS_H
+
+// Conversion of many local times of one zone to sys time without exceptions.
+//
+// local_to_sys_cursor remembers the interval of the last conversion
+// together with the window of local times that map to it uniquely. As long
+// as the next local time falls into that window, converting it is one
+// compare and one subtraction. Only local times outside of it search the
+// zone, so mostly sorted input costs amortized O(1) per element.
+//
+// Results are those of zone->to_sys(tp, choose), nonexistent and ambiguous
+// local times are reported instead of thrown.
+
+#include "metrics.h"
+#include <date/date.h>
+#include <date/tz.h>
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+namespace chrono_date
+{
+
+enum class local_result : std::uint8_t
+{
+    unique,
+    nonexistent,
+    ambiguous
+};
+
+struct local_to_sys_counts
+{
+    std::size_t nonexistent;
+    std::size_t ambiguous;
+};
+
+namespace detail
+{
+
+// whether zone has an interval containing s; zones on a table of their
+// own (see zone_base.h) only have those of [table_begin(), table_end())
+template<class Zone>
+auto has_info_at(const Zone& zone, date::sys_seconds s, int) -> decltype(zone.table_begin(), bool())
+{
+    return zone.table_begin() <= s && s < zone.table_end();
+}
+
+template<class Zone>
+bool has_info_at(const Zone&, date::sys_seconds, long)
+{
+    return true;
+}
+
+}
+
+// TimeZonePtr is anything usable as the zone of a date::zoned_time
+template<class TimeZonePtr>
+class local_to_sys_cursor
+{
+public:
+    explicit local_to_sys_cursor(TimeZonePtr zone)
+        : zone_(std::move(zone))
+    {
+    }
+
+    // zone->to_sys(tp, c), with the kind of local time in r
+    template<class Duration>
+    date::sys_time<typename std::common_type<Duration, std::chrono::seconds>::type>
+    to_sys(date::local_time<Duration> tp, date::choose c, local_result& r)
+    {
+        using CT = typename std::common_type<Duration, std::chrono::seconds>::type;
+        const auto lt = date::floor<std::chrono::seconds>(tp).time_since_epoch().count();
+        if(lo_ <= lt && lt < hi_)
+        {
+            count_metric(metric_counter::local_to_sys_hits);
+            r = local_result::unique;
+            return date::sys_time<CT>{tp.time_since_epoch() - std::chrono::seconds{offset_}};
+        }
+
+        count_metric(metric_counter::local_to_sys_searches);
+        const auto i = zone_->get_info(tp);
+        date::sys_time<CT> st;
+        if(i.result == date::local_info::nonexistent)
+        {
+            count_metric(metric_counter::nonexistent_local_times);
+            r = local_result::nonexistent;
+            st = date::sys_time<CT>{i.first.end};
+        }
+        else if(i.result == date::local_info::ambiguous)
+        {
+            count_metric(metric_counter::ambiguous_local_times);
+            r = local_result::ambiguous;
+            const auto& info = c == date::choose::latest ? i.second : i.first;
+            st = date::sys_time<CT>{tp.time_since_epoch() - info.offset};
+        }
+        else
+        {
+            r = local_result::unique;
+            st = date::sys_time<CT>{tp.time_since_epoch() - i.first.offset};
+            seat(i.first);
+        }
+        return st;
+    }
+
+    // number of times the cursor had to move to another interval
+    std::size_t reseats() const noexcept
+    {
+        return reseats_;
+    }
+
+private:
+    // no utc offset exceeds 26 hours
+    static constexpr std::int64_t max_offset = 26 * 3600;
+
+    static std::int64_t count(date::sys_seconds s)
+    {
+        return s.time_since_epoch().count();
+    }
+
+    // The local times that map to cur and nothing else:
+    // at or after the end of prev in local time of prev and cur,
+    // before the begin of next in local time of cur and next,
+    // and far enough from the intervals beyond prev and next
+    // that those can not contain them either.
+    // Without prev or next, as at the ends of a table, the window ends
+    // where cur does.
+    void seat(const date::sys_info& cur)
+    {
+        ++reseats_;
+        const auto b = count(cur.begin);
+        const auto e = count(cur.end);
+        const auto o = cur.offset.count();
+        auto lo = b + o;
+        auto hi = e + o;
+        if(b > min_seconds() && detail::has_info_at(*zone_, cur.begin - std::chrono::seconds{1}, 0))
+        {
+            const auto prev = zone_->get_info(cur.begin - std::chrono::seconds{1});
+            lo = std::max({lo, b + prev.offset.count(), count(prev.begin) + max_offset});
+        }
+        if(e < max_seconds() && detail::has_info_at(*zone_, cur.end, 0))
+        {
+            const auto next = zone_->get_info(cur.end);
+            hi = std::min({hi, e + next.offset.count(), count(next.end) - max_offset});
+        }
+        lo_ = lo;
+        hi_ = hi;
+        offset_ = o;
+    }
+
+    // beyond these, intervals are taken to extend to the end of time
+    static constexpr std::int64_t min_seconds()
+    {
+        return -(std::int64_t{1} << 39);
+    }
+
+    static constexpr std::int64_t max_seconds()
+    {
+        return std::int64_t{1} << 39;
+    }
+
+    TimeZonePtr zone_;
+    std::int64_t lo_ = 1;
+    std::int64_t hi_ = 0;
+    std::int64_t offset_ = 0;
+    std::size_t reseats_ = 0;
+};
+
+template<class TimeZonePtr>
+local_to_sys_cursor<TimeZonePtr> make_local_to_sys_cursor(TimeZonePtr zone)
+{
+    return local_to_sys_cursor<TimeZonePtr>{std::move(zone)};
+}
+
+// out[i] = zone->to_sys(in[i], c) for i in [0, n)
+// result, if not nullptr, receives the kind of every local time
+template<class TimeZonePtr, class Duration>
+local_to_sys_counts
+bulk_to_sys(TimeZonePtr zone,
+            const date::local_time<Duration>* in,
+            std::size_t n,
+            date::sys_time<typename std::common_type<Duration, std::chrono::seconds>::type>* out,
+            date::choose c,
+            local_result* result = nullptr)
+{
+    local_to_sys_cursor<TimeZonePtr> cursor{std::move(zone)};
+    local_to_sys_counts counts{0, 0};
+    for(std::size_t i = 0; i < n; ++i)
+    {
+        local_result r;
+        out[i] = cursor.to_sys(in[i], c, r);
+        counts.nonexistent += r == local_result::nonexistent;
+        counts.ambiguous += r == local_result::ambiguous;
+        if(result != nullptr)
+            result[i] = r;
+    }
+    return counts;
+}
+
+}
+
+#endif
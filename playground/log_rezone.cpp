@@ -0,0 +1,251 @@
+// Converts the timestamps of a log from one time zone to another.
+//
+// usage: log_rezone [-j threads] [--from zone] --to zone <input> [output]
+//
+// Every line that begins with "YYYY-MM-DD hh:mm:ss" (or a 'T' between the
+// date and the time) is taken as a local time of --from, UTC by default,
+// and rewritten as the same instant in local time of --to, see
+// rezone_log.h. Every line keeps its length, so the log is rewritten in
+// place: into the mapped output file, or into the mapped input if there
+// is no output.
+//
+// The log is cut into chunks at line ends, which are converted on one
+// thread per hardware thread unless -j says otherwise. Throughput is
+// printed in MB/s and lines/s.
+
+#include "rezone_log.h"
+#include <date/date.h>
+#include <date/tz.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32)
+#include <fstream>
+#include <iterator>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+
+#if defined(_WIN32)
+
+// no mapping, the log is read, converted and written as a whole
+class mapped_log
+{
+public:
+    mapped_log(const std::string& input, const std::string& output)
+        : output_(output.empty() ? input : output)
+    {
+        std::ifstream in(input, std::ios::binary);
+        if(!in)
+            throw std::runtime_error("can not open " + input);
+        data_.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+
+    void finish()
+    {
+        std::ofstream out(output_, std::ios::binary | std::ios::trunc);
+        if(!out.write(data_.data(), static_cast<std::streamsize>(data_.size())))
+            throw std::runtime_error("can not write " + output_);
+    }
+
+    const char* source() const noexcept
+    {
+        return data_.data();
+    }
+
+    char* data() noexcept
+    {
+        return data_.data();
+    }
+
+    std::size_t size() const noexcept
+    {
+        return data_.size();
+    }
+
+private:
+    std::string output_;
+    std::vector<char> data_;
+};
+
+#else
+
+// the input, and the output mapped for writing, which is the input
+// itself if there is no output
+class mapped_log
+{
+public:
+    mapped_log(const std::string& input, const std::string& output)
+    {
+        const auto in = ::open(input.c_str(), (output.empty() ? O_RDWR : O_RDONLY) | O_CLOEXEC);
+        if(in < 0)
+            throw std::runtime_error("can not open " + input);
+        struct stat st;
+        if(::fstat(in, &st) != 0)
+        {
+            ::close(in);
+            throw std::runtime_error("can not open " + input);
+        }
+        size_ = static_cast<std::size_t>(st.st_size);
+        if(size_ == 0)
+        {
+            ::close(in);
+            if(!output.empty())
+                ::close(::open(output.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644));
+            return;
+        }
+        if(output.empty())
+        {
+            map(in, input);
+            source_ = data_;
+            return;
+        }
+
+        const auto out = ::open(output.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if(out < 0 || ::ftruncate(out, static_cast<off_t>(size_)) != 0)
+        {
+            ::close(in);
+            if(out >= 0)
+                ::close(out);
+            throw std::runtime_error("can not create " + output);
+        }
+        void* source = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, in, 0);
+        ::close(in);
+        if(source == MAP_FAILED)
+        {
+            ::close(out);
+            throw std::runtime_error("can not map " + input);
+        }
+        source_ = static_cast<const char*>(source);
+        try
+        {
+            map(out, output);
+        }
+        catch(...)
+        {
+            ::munmap(source, size_);
+            throw;
+        }
+    }
+
+    ~mapped_log()
+    {
+        if(source_ != data_)
+            ::munmap(const_cast<char*>(source_), size_);
+        if(data_ != nullptr)
+            ::munmap(data_, size_);
+    }
+
+    mapped_log(const mapped_log&) = delete;
+    mapped_log& operator=(const mapped_log&) = delete;
+
+    // the shared mapping is written back by the kernel
+    void finish()
+    {
+    }
+
+    const char* source() const noexcept
+    {
+        return source_;
+    }
+
+    char* data() noexcept
+    {
+        return data_;
+    }
+
+    std::size_t size() const noexcept
+    {
+        return size_;
+    }
+
+private:
+    // maps and closes fd
+    void map(int fd, const std::string& path)
+    {
+        void* p = ::mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if(p == MAP_FAILED)
+            throw std::runtime_error("can not map " + path);
+        data_ = static_cast<char*>(p);
+    }
+
+    const char* source_ = nullptr;
+    char* data_ = nullptr;
+    std::size_t size_ = 0;
+};
+
+#endif
+
+}
+
+int main(int argc, char* argv[])
+{
+    using namespace date;
+
+    const auto usage = "usage: log_rezone [-j threads] [--from zone] --to zone <input> [output]\n";
+    unsigned threads = 0;
+    std::string from = "UTC";
+    std::string to;
+    int arg = 1;
+    for(; arg < argc && argv[arg][0] == '-'; ++arg)
+    {
+        if(std::strcmp(argv[arg], "-j") == 0 && arg + 1 < argc)
+            threads = static_cast<unsigned>(std::atoi(argv[++arg]));
+        else if(std::strcmp(argv[arg], "--from") == 0 && arg + 1 < argc)
+            from = argv[++arg];
+        else if(std::strcmp(argv[arg], "--to") == 0 && arg + 1 < argc)
+            to = argv[++arg];
+        else
+        {
+            std::cerr << usage;
+            return EXIT_FAILURE;
+        }
+    }
+    argc -= arg - 1;
+    argv += arg - 1;
+
+    if(argc < 2 || argc > 3 || to.empty())
+    {
+        std::cerr << usage;
+        return EXIT_FAILURE;
+    }
+    if(threads == 0)
+        threads = std::max(std::thread::hardware_concurrency(), 1u);
+
+    try
+    {
+        const auto start = std::chrono::steady_clock::now();
+        // segments for the years logs are likely to be from, conversions
+        // outside of them go through the zones
+        const chrono_date::log_converter c{locate_zone(from), locate_zone(to),
+                          sys_days{year{1970} / jan / 1}, sys_days{year{2100} / jan / 1}};
+        mapped_log log{argv[1], argc > 2 ? argv[2] : ""};
+        const auto counts = chrono_date::rezone_log(c, log.source(), log.data(), log.size(), threads);
+        log.finish();
+        const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << counts.converted << " of " << counts.lines << " lines converted"
+                  << ", " << log.size() / 1e6 / elapsed << " MB/s"
+                  << ", " << counts.lines / elapsed << " lines/s\n";
+    }
+    catch(const std::exception& e)
+    {
+        std::cerr << e.what() << '\n';
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
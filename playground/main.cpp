@@ -3,8 +3,50 @@
 #include <catch.hpp>
 #include <date/date.h>
 #include <date/tz.h>
+#include "business_calendar.h"
+#include "calendar_buckets.h"
+#include "civil_batch.h"
+#include "current_zone_cache.h"
+#include "duration_batch.h"
+#include "fast_clock.h"
+#include "leap_second_cursor.h"
+#include "local_to_sys.h"
+#include "metrics.h"
+#include "packed_zoned_time.h"
+#include "recurrence.h"
+#include "rezone_log.h"
+#include "static_zones.h"
+#include "timestamp_codec.h"
+#include "timestamp_from_chars.h"
+#include "timestamp_to_chars.h"
+#include "timing_wheel.h"
+#include "tzdb_image.h"
+#include "tzdb_rcu.h"
+#include "zone_pair_converter.h"
+#include "zone_registry.h"
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <random>
 #include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <unistd.h>
+#endif
+
+#if defined(CHRONO_DATE_REQUIRE_COROUTINES) && !defined(CHRONO_DATE_HAS_COROUTINES)
+#error "the coroutine front end of timing_wheel.h is not available with this compiler"
+#endif
 
 using namespace date;
 using namespace date::literals;
@@ -429,6 +471,71 @@ TEST_CASE("from serialbased to field based")
     CHECK(time.seconds() == 20s);
 }
 
+TEST_CASE("batch from serialbased to field based and back")
+{
+    // every day of 800 years around the epoch plus the ends of the year range
+    std::vector<sys_days> serial;
+    for(auto d = sys_days{1600_y / jan / 1}; d < sys_days{2400_y / jan / 1}; d += days{1})
+        serial.push_back(d);
+    serial.push_back(sys_days{year::min() / jan / 1});
+    serial.push_back(sys_days{year::max() / dec / 31});
+    const auto n = serial.size();
+
+    std::vector<sys_seconds> serial_secs;
+    for(const auto d : serial)
+        serial_secs.push_back(d + 23h + 59min + 59s);
+
+    for(const auto isa : {chrono_date::simd_isa::generic,
+                          chrono_date::simd_isa::sse4_1,
+                          chrono_date::simd_isa::avx2,
+                          chrono_date::simd_isa::avx512})
+    {
+        if(!chrono_date::is_supported(isa))
+            continue;
+        INFO(chrono_date::to_string(isa));
+
+        std::vector<std::int16_t> y(n);
+        std::vector<std::uint8_t> m(n);
+        std::vector<std::uint8_t> d(n);
+        std::vector<sys_days> back(n);
+
+        std::size_t wrong = 0;
+        chrono_date::to_ymd(isa, serial.data(), n, {y.data(), m.data(), d.data()});
+        for(std::size_t i = 0; i < n; ++i)
+            wrong += year{y[i]} / month{m[i]} / day{d[i]} != year_month_day{serial[i]};
+        CHECK(wrong == 0);
+
+        chrono_date::to_sys_days(isa, {y.data(), m.data(), d.data()}, n, back.data());
+        CHECK(back == serial);
+
+        std::fill(y.begin(), y.end(), 0);
+        wrong = 0;
+        chrono_date::to_ymd(isa, serial_secs.data(), n, {y.data(), m.data(), d.data()});
+        for(std::size_t i = 0; i < n; ++i)
+            wrong += year{y[i]} / month{m[i]} / day{d[i]} != year_month_day{serial[i]};
+        CHECK(wrong == 0);
+    }
+
+    SECTION("carry over like sys_days{ymd}")
+    {
+        const std::int16_t y = 2000;
+        const std::uint8_t m = 2;
+        const std::uint8_t d = 30;
+        auto carry_over = sys_days{};
+        chrono_date::to_sys_days({&y, &m, &d}, 1, &carry_over);
+        CHECK(carry_over == 2000_y / mar / 1);
+    }
+    SECTION("before 1970")
+    {
+        const auto before = sys_seconds{-1s};
+        std::int16_t y;
+        std::uint8_t m;
+        std::uint8_t d;
+        chrono_date::to_ymd(&before, 1, {&y, &m, &d});
+        CHECK(year{y} / month{m} / day{d} == 1969_y / dec / 31);
+    }
+}
+
 TEST_CASE("local time with time zone")
 {
     const auto today = sys_days{2025_y / oct / 3} + 17h + 43min + 23s;
@@ -632,3 +739,2002 @@ TEST_CASE("flight duration")
         CHECK(arrival.get_local_time() == local_days{1979_y / jan / 1} + 11h + 14min + 59s);
     }
 }
+
+static bool same_info(const sys_info& a, const sys_info& b)
+{
+    return a.begin  == b.begin  &&
+           a.end    == b.end    &&
+           a.offset == b.offset &&
+           a.save   == b.save   &&
+           a.abbrev == b.abbrev;
+}
+
+static bool same_info(const local_info& a, const local_info& b)
+{
+    return a.result == b.result &&
+           same_info(a.first, b.first) &&
+           (a.result == local_info::unique || same_info(a.second, b.second));
+}
+
+TEST_CASE("precompiled tzdb image")
+{
+    const auto path = std::string{"chrono_date_playground.tzdb"};
+    const auto from = sys_seconds{sys_days{1970_y / jan / 1}};
+    const auto to   = sys_seconds{sys_days{2040_y / jan / 1}};
+    chrono_date::write_tzdb_image(get_tzdb(), path, from, to);
+    const chrono_date::tzdb_image image{path};
+    std::remove(path.c_str());
+
+    CHECK(image.version() == get_tzdb().version);
+    CHECK(image.zone_count() == get_tzdb().zones.size());
+    CHECK(image.find_zone("Mars/Olympus_Mons") == nullptr);
+    CHECK_THROWS_AS(image.locate_zone("Mars/Olympus_Mons"), std::runtime_error);
+
+    SECTION("same intervals as the text database around every transition")
+    {
+        std::size_t wrong = 0;
+        for(const auto& tz : get_tzdb().zones)
+        {
+            const auto compiled = image.locate_zone(tz.name());
+            for(auto info = tz.get_info(from); info.begin < to; info = tz.get_info(info.end))
+            {
+                for(const auto d : {-3600s, -1s, 0s, 1s, 3600s})
+                {
+                    const auto st = std::max(info.begin, from) + d;
+                    wrong += !same_info(tz.get_info(st), compiled->get_info(st));
+                    const auto lt = local_seconds{st.time_since_epoch()} + info.offset;
+                    wrong += !same_info(tz.get_info(lt), compiled->get_info(lt));
+                }
+                if(info.end >= to)
+                    break;
+            }
+        }
+        CHECK(wrong == 0);
+    }
+    SECTION("bulk_to_sys over the first and last interval")
+    {
+        for(const auto name : {"Europe/Berlin", "America/New_York", "Asia/Jerusalem"})
+        {
+            const auto zone = image.locate_zone(name);
+            const auto first = zone->get_info(zone->table_begin());
+            const auto last = zone->get_info(zone->table_end() - 1s);
+            std::vector<local_seconds> in;
+            for(const auto& info : {first, last})
+                for(auto t = info.begin + 1h; t < info.end - 1h; t += (info.end - info.begin) / 64)
+                    in.push_back(local_seconds{t.time_since_epoch()} + info.offset);
+            std::vector<sys_seconds> out(in.size());
+            const auto counts = chrono_date::bulk_to_sys(zone, in.data(), in.size(), out.data(), choose::earliest);
+            CHECK(counts.nonexistent + counts.ambiguous == 0);
+            std::size_t wrong = 0;
+            for(std::size_t i = 0; i < in.size(); ++i)
+                wrong += out[i] != zone->to_sys(in[i], choose::earliest);
+            CHECK(wrong == 0);
+        }
+        const auto& berlin = chrono_date::static_zones::europe_berlin;
+        const local_seconds edges[] = {
+            local_seconds{berlin.table_begin().time_since_epoch()} + 2h,
+            local_days{1975_y / jun / 1},
+            local_seconds{berlin.table_end().time_since_epoch()} - 2h};
+        sys_seconds edges_out[3];
+        chrono_date::bulk_to_sys(&berlin, edges, 3, edges_out, choose::earliest);
+        for(std::size_t i = 0; i < 3; ++i)
+            CHECK(edges_out[i] == berlin.to_sys(edges[i], choose::earliest));
+    }
+    SECTION("times past the compiled range throw")
+    {
+        const auto berlin = image.locate_zone("Europe/Berlin");
+        CHECK(berlin->table_begin() <= from);
+        CHECK(berlin->table_end() >= to);
+        const auto past = berlin->table_end() + days{200};
+        CHECK_THROWS_AS(berlin->get_info(past), std::runtime_error);
+        CHECK_THROWS_AS(berlin->to_local(past), std::runtime_error);
+        CHECK_THROWS_AS(berlin->get_info(local_seconds{past.time_since_epoch()}), std::runtime_error);
+        CHECK_THROWS_AS(make_zoned(berlin, past).get_local_time(), std::runtime_error);
+        CHECK(berlin->get_info(berlin->table_end() - 1s).end == berlin->table_end());
+        // a zone without transitions covers all of time
+        const auto utc = image.locate_zone("Etc/UTC");
+        CHECK(utc->get_info(to + days{200}).offset == 0s);
+    }
+    SECTION("links resolve to their zone")
+    {
+        for(const auto& link : get_tzdb().links)
+            CHECK(image.locate_zone(link.name())->name() == locate_zone(link.name())->name());
+    }
+    SECTION("zoned_time on a compiled zone")
+    {
+        const auto berlin = image.locate_zone("Europe/Berlin");
+        const auto never_existed =
+            static_cast<local_days>(2016_y / mar / sun[last]) + 2h + 30min;
+        CHECK_THROWS_AS(make_zoned(berlin, never_existed), nonexistent_local_time);
+        CHECK(make_zoned(berlin, never_existed, choose::earliest).get_local_time()
+              == static_cast<local_days>(2016_y / mar / sun[last]) + 3h);
+
+        const auto existed_twice =
+            static_cast<local_days>(2016_y / oct / sun[last]) + 2h + 30min;
+        CHECK_THROWS_AS(make_zoned(berlin, existed_twice), ambiguous_local_time);
+        CHECK(make_zoned(berlin, existed_twice, choose::latest).get_sys_time()
+              == make_zoned("Europe/Berlin", existed_twice, choose::latest).get_sys_time());
+    }
+}
+
+TEST_CASE("interned time zones")
+{
+    const auto& registry = chrono_date::get_zone_registry();
+    CHECK(registry.size() == get_tzdb().zones.size());
+
+    SECTION("every zone and link resolves like locate_zone")
+    {
+        std::size_t wrong = 0;
+        for(const auto& tz : get_tzdb().zones)
+            wrong += registry.intern(tz.name()).get() != &tz;
+        for(const auto& link : get_tzdb().links)
+            wrong += registry.intern(link.name()).get() != locate_zone(link.name());
+        CHECK(wrong == 0);
+    }
+    SECTION("unknown names")
+    {
+        CHECK_FALSE(registry.find("Europe/Berlinn"));
+        CHECK_FALSE(registry.find(""));
+        CHECK_THROWS_AS(chrono_date::intern_zone("Mars/Olympus_Mons"), std::runtime_error);
+    }
+    SECTION("invalid handles")
+    {
+        const chrono_date::zone_handle none;
+        CHECK_THROWS_AS(none.get(), std::runtime_error);
+        CHECK_THROWS_AS(registry.find("Mars/Olympus_Mons")->name(), std::runtime_error);
+        CHECK_THROWS_AS(chrono_date::make_zoned(none, sys_days{2016_y / jan / 1}), std::runtime_error);
+        CHECK_THROWS_AS(chrono_date::make_zoned(none, local_days{2016_y / jan / 1}), std::runtime_error);
+        const chrono_date::zone_handle past{static_cast<std::uint16_t>(registry.size())};
+        CHECK_THROWS_AS(registry.zone(past), std::runtime_error);
+        CHECK(registry.zone(chrono_date::zone_handle{0}) == &get_tzdb().zones.front());
+    }
+    SECTION("handles from zones")
+    {
+        const auto berlin = chrono_date::intern_zone("Europe/Berlin");
+        CHECK(registry.intern(locate_zone("Europe/Berlin")) == berlin);
+        CHECK(berlin->name() == "Europe/Berlin");
+    }
+    SECTION("thread local cache of recent names")
+    {
+        const auto before = chrono_date::intern_zone_cache_stats();
+        const auto a = chrono_date::intern_zone("Asia/Tehran");
+        const auto b = chrono_date::intern_zone("Asia/Tehran");
+        const auto after = chrono_date::intern_zone_cache_stats();
+        CHECK(a == b);
+        CHECK(after.hits + after.misses == before.hits + before.misses + 2);
+        CHECK(after.hits >= before.hits + 1);
+    }
+    SECTION("make_zoned on a handle")
+    {
+        const auto berlin = chrono_date::intern_zone("Europe/Berlin");
+        const auto before_ds_time =
+            chrono_date::make_zoned(berlin, local_days{2016_y / mar / sat[last]} + 9h);
+        CHECK(before_ds_time.get_sys_time() == sys_days{2016_y / mar / sat[last]} + 8h);
+        CHECK(before_ds_time.get_time_zone() == locate_zone("Europe/Berlin"));
+
+        const auto existed_twice =
+            static_cast<local_days>(2016_y / oct / sun[last]) + 2h + 30min;
+        CHECK_THROWS_AS(chrono_date::make_zoned(berlin, existed_twice), ambiguous_local_time);
+        CHECK(chrono_date::make_zoned(berlin, existed_twice, choose::latest).get_sys_time()
+              == make_zoned("Europe/Berlin", existed_twice, choose::latest).get_sys_time());
+    }
+}
+
+TEST_CASE("bulk local to sys conversion without exceptions")
+{
+    const auto check_zone = [](const char* name, local_days first, local_days last)
+    {
+        INFO(name);
+        const auto tz = locate_zone(name);
+        std::vector<local_seconds> in;
+        for(auto t = local_seconds{first}; t < last; t += 1min)
+            in.push_back(t);
+        const auto n = in.size();
+
+        const auto check = [&](choose c)
+        {
+            std::vector<sys_seconds> out(n);
+            std::vector<chrono_date::local_result> result(n);
+            const auto counts = chrono_date::bulk_to_sys(tz, in.data(), n, out.data(), c, result.data());
+
+            std::size_t wrong = 0;
+            std::size_t nonexistent = 0;
+            std::size_t ambiguous = 0;
+            for(std::size_t i = 0; i < n; ++i)
+            {
+                const auto info = tz->get_info(in[i]);
+                nonexistent += info.result == local_info::nonexistent;
+                ambiguous += info.result == local_info::ambiguous;
+                wrong += out[i] != tz->to_sys(in[i], c);
+                wrong += static_cast<int>(result[i]) != info.result;
+            }
+            CHECK(wrong == 0);
+            CHECK(counts.nonexistent == nonexistent);
+            CHECK(counts.ambiguous == ambiguous);
+            CHECK(nonexistent + ambiguous > 0);
+        };
+        check(choose::earliest);
+        check(choose::latest);
+
+        SECTION("sorted input moves the cursor once per transition")
+        {
+            auto cursor = chrono_date::make_local_to_sys_cursor(tz);
+            auto r = chrono_date::local_result::unique;
+            for(const auto t : in)
+                cursor.to_sys(t, choose::earliest, r);
+            CHECK(cursor.reseats() <= 4);
+        }
+        SECTION("unsorted input")
+        {
+            std::shuffle(in.begin(), in.end(), std::mt19937{42});
+            check(choose::earliest);
+        }
+    };
+
+    check_zone("Europe/Berlin", local_days{2016_y / mar / 26}, local_days{2016_y / mar / 29});
+    check_zone("Europe/Berlin", local_days{2016_y / oct / 29}, local_days{2016_y / nov / 1});
+    check_zone("Asia/Jerusalem", local_days{2020_y / mar / 26}, local_days{2020_y / mar / 29});
+    check_zone("Asia/Jerusalem", local_days{2020_y / oct / 24}, local_days{2020_y / oct / 27});
+
+    SECTION("finer than seconds")
+    {
+        const auto tz = locate_zone("Europe/Berlin");
+        const auto in = local_days{2016_y / mar / sun[last]} + 2h + 30min + 250ms;
+        sys_time<milliseconds> out;
+        chrono_date::bulk_to_sys(tz, &in, 1, &out, choose::latest);
+        CHECK(out == tz->to_sys(in, choose::latest));
+
+        const auto unique = local_days{2016_y / jul / 1} + 12h + 250ms;
+        chrono_date::bulk_to_sys(tz, &unique, 1, &out, choose::latest);
+        CHECK(out == tz->to_sys(unique));
+    }
+}
+
+template<class T>
+static std::string streamed(const T& t)
+{
+    std::stringstream str;
+    str << t;
+    return str.str();
+}
+
+template<class T>
+static std::string to_chars_string(const T& t)
+{
+    char buffer[128];
+    const auto r = chrono_date::to_chars(buffer, buffer + sizeof buffer, t);
+    REQUIRE(r.ec == std::errc{});
+    return std::string(buffer, r.ptr);
+}
+
+TEST_CASE("format timestamps into a char buffer")
+{
+    const auto tp = sys_days{1986_y / sep / 30} + 19h + 53min + 2s + 457ms;
+    SECTION("like stream time_point")
+    {
+        CHECK(to_chars_string(tp) == "1986-09-30 19:53:02.457");
+    }
+    SECTION("every precision like the stream")
+    {
+        using Tick = duration<int, ratio<1, 4>>;
+        using Third = duration<long long, ratio<1, 3>>;
+        using Centi = duration<long long, std::centi>;
+        std::mt19937 gen{19860930};
+        std::uniform_int_distribution<long long> dist{-5000000000000000000, 5000000000000000000};
+        for(int i = 0; i < 1000; ++i)
+        {
+            const auto ns = sys_time<nanoseconds>{nanoseconds{dist(gen)}};
+            CHECK(to_chars_string(ns) == streamed(ns));
+            CHECK(to_chars_string(floor<microseconds>(ns)) == streamed(floor<microseconds>(ns)));
+            CHECK(to_chars_string(floor<milliseconds>(ns)) == streamed(floor<milliseconds>(ns)));
+            CHECK(to_chars_string(floor<Centi>(ns)) == streamed(floor<Centi>(ns)));
+            CHECK(to_chars_string(floor<seconds>(ns)) == streamed(floor<seconds>(ns)));
+            CHECK(to_chars_string(floor<minutes>(ns)) == streamed(floor<minutes>(ns)));
+            CHECK(to_chars_string(floor<days>(ns)) == streamed(floor<days>(ns)));
+            CHECK(to_chars_string(floor<Third>(ns)) == streamed(floor<Third>(ns)));
+            const auto tick = Tick{static_cast<int>(dist(gen) % 1000000000)};
+            CHECK(to_chars_string(make_time(tick)) == streamed(make_time(tick)));
+            CHECK(to_chars_string(make_time(floor<seconds>(ns).time_since_epoch())) ==
+                  streamed(make_time(floor<seconds>(ns).time_since_epoch())));
+        }
+    }
+    SECTION("dates outside of the common range")
+    {
+        for(const auto ymd : {year_month_day{-5_y / jan / 1},
+                              year_month_day{0_y / dec / 31},
+                              year_month_day{32767_y / dec / 31},
+                              year_month_day{2015_y / feb / 30}})
+        {
+            CHECK(to_chars_string(ymd) == streamed(ymd));
+        }
+    }
+    SECTION("buffer too small")
+    {
+        char buffer[23];
+        auto r = chrono_date::to_chars(buffer, buffer + 22, tp);
+        CHECK(r.ec == std::errc::value_too_large);
+        CHECK(r.ptr == buffer + 22);
+        r = chrono_date::to_chars(buffer, buffer + 23, tp);
+        CHECK(r.ec == std::errc{});
+        CHECK(std::string(buffer, r.ptr) == "1986-09-30 19:53:02.457");
+    }
+}
+
+template<class Duration>
+static sys_time<Duration> parsed(const std::string& s, chrono_date::simd_isa isa = chrono_date::detect_simd_isa())
+{
+    sys_time<Duration> tp{};
+    const auto r = chrono_date::from_chars(isa, s.data(), s.data() + s.size(), tp);
+    CHECK(r.ec == std::errc{});
+    CHECK(r.ptr == s.data() + s.size());
+    return tp;
+}
+
+static std::errc parse_error(const std::string& s)
+{
+    sys_seconds tp{};
+    const auto r = chrono_date::from_chars(s.data(), s.data() + s.size(), tp);
+    CHECK(tp == sys_seconds{});
+    return r.ec;
+}
+
+TEST_CASE("parse timestamps from a char buffer")
+{
+    const auto tp = sys_days{1986_y / sep / 30} + 19h + 53min + 2s + 457ms;
+    SECTION("like stream time_point")
+    {
+        CHECK(parsed<milliseconds>("1986-09-30 19:53:02.457") == tp);
+        CHECK(parsed<milliseconds>("1986-09-30T19:53:02.457Z") == tp);
+        CHECK(parsed<milliseconds>("1986-09-30t19:53:02.457z") == tp);
+        CHECK(parsed<milliseconds>("1986-09-30T21:53:02.457+02:00") == tp);
+        CHECK(parsed<milliseconds>("1986-09-30T14:23:02.457-0530") == tp);
+        CHECK(parsed<milliseconds>("1986-09-30 19:53:02.457123456789012345678") == tp);
+        CHECK(parsed<seconds>("1986-09-30 19:53:02.999") == floor<seconds>(tp));
+        CHECK(parsed<days>("1986-09-30") == sys_days{1986_y / sep / 30});
+        CHECK(parsed<seconds>("1986-09-30") == sys_days{1986_y / sep / 30});
+    }
+    SECTION("round trip of formatted time points")
+    {
+        using Tick = duration<long long, ratio<1, 4>>;
+        const auto from = sys_days{0_y / jan / 1}.time_since_epoch().count();
+        const auto to = sys_days{9999_y / dec / 31}.time_since_epoch().count();
+        std::mt19937 gen{19860930};
+        std::uniform_int_distribution<long long> day_dist{from, to};
+        std::uniform_int_distribution<long long> ns_dist{0, 86399999999999};
+        for(int i = 0; i < 1000; ++i)
+        {
+            const auto ns = sys_days{days{day_dist(gen)}} + nanoseconds{ns_dist(gen)};
+            for(const auto isa : {chrono_date::simd_isa::generic, chrono_date::detect_simd_isa()})
+            {
+                CHECK(parsed<nanoseconds>(streamed(ns), isa) == ns);
+                CHECK(parsed<microseconds>(streamed(floor<microseconds>(ns)), isa) == floor<microseconds>(ns));
+                CHECK(parsed<milliseconds>(streamed(floor<milliseconds>(ns)), isa) == floor<milliseconds>(ns));
+                CHECK(parsed<seconds>(streamed(floor<seconds>(ns)), isa) == floor<seconds>(ns));
+                CHECK(parsed<minutes>(streamed(floor<minutes>(ns)), isa) == floor<minutes>(ns));
+                CHECK(parsed<days>(streamed(floor<days>(ns)), isa) == floor<days>(ns));
+                CHECK(parsed<Tick>(to_chars_string(floor<Tick>(ns)), isa) == floor<Tick>(ns));
+            }
+        }
+    }
+    SECTION("stops behind the timestamp")
+    {
+        const std::string s = "2015-08-20 rest";
+        sys_seconds tp;
+        const auto r = chrono_date::from_chars(s.data(), s.data() + s.size(), tp);
+        CHECK(r.ec == std::errc{});
+        CHECK(r.ptr == s.data() + 10);
+        CHECK(tp == sys_days{2015_y / aug / 20});
+    }
+    SECTION("malformed timestamps")
+    {
+        CHECK(parse_error("") == std::errc::invalid_argument);
+        CHECK(parse_error("2015-8-20") == std::errc::invalid_argument);
+        CHECK(parse_error("2015/08/20") == std::errc::invalid_argument);
+        CHECK(parse_error("2015-08-20T") == std::errc::invalid_argument);
+        CHECK(parse_error("2015-08-20T10:00") == std::errc::invalid_argument);
+        CHECK(parse_error("2015-08-20T10:0a:00") == std::errc::invalid_argument);
+        CHECK(parse_error("2015-08-20T10:00:00.") == std::errc::invalid_argument);
+        CHECK(parse_error("2015-08-20T10:00:00+2") == std::errc::invalid_argument);
+        CHECK(parse_error("2015-08-20T10:00:00+02:0") == std::errc::invalid_argument);
+    }
+    SECTION("fields out of range")
+    {
+        CHECK(parse_error("2015-13-01") == std::errc::result_out_of_range);
+        CHECK(parse_error("2015-02-29") == std::errc::result_out_of_range);
+        CHECK(parse_error("2015-08-20 24:00:00") == std::errc::result_out_of_range);
+        CHECK(parse_error("2015-08-20 23:60:00") == std::errc::result_out_of_range);
+        CHECK(parse_error("2015-08-20 23:59:60") == std::errc::result_out_of_range);
+        CHECK(parse_error("2015-08-20 23:59:59+24:00") == std::errc::result_out_of_range);
+    }
+    SECTION("newline separated lines")
+    {
+        const std::string s =
+            "1986-09-30 19:53:02.457\n"
+            "2016-03-27T02:30:00+02:00\r\n"
+            "2000-02-29\n"
+            "2015-08-20 10:00:00 trailing\n"
+            "2015-08-21";
+        std::vector<sys_time<milliseconds>> out(8);
+        auto r = chrono_date::lines_from_chars(s.data(), s.data() + s.size(), out.data(), out.size());
+        CHECK(r.ec == std::errc::invalid_argument);
+        REQUIRE(r.count == 3);
+        CHECK(out[0] == tp);
+        CHECK(out[1] == sys_days{2016_y / mar / 27} + 30min);
+        CHECK(out[2] == sys_days{2000_y / feb / 29});
+        CHECK(std::string(r.ptr, 19) == "2015-08-20 10:00:00");
+
+        r = chrono_date::lines_from_chars(s.data(), s.data() + s.size(), out.data(), 2);
+        CHECK(r.ec == std::errc{});
+        CHECK(r.count == 2);
+        CHECK(std::string(r.ptr, 10) == "2000-02-29");
+
+        const auto next = std::find(r.ptr + 30, s.data() + s.size(), '\n') + 1;
+        r = chrono_date::lines_from_chars(next, s.data() + s.size(), out.data(), out.size());
+        CHECK(r.ec == std::errc{});
+        CHECK(r.count == 1);
+        CHECK(r.ptr == s.data() + s.size());
+        CHECK(out[0] == sys_days{2015_y / aug / 21});
+    }
+}
+
+TEST_CASE("hot swapped tzdb")
+{
+    using chrono_date::tzdb_image;
+    const auto path = std::string{"chrono_date_playground_rcu.tzdb"};
+    chrono_date::write_tzdb_image(get_tzdb(), path,
+                                  sys_days{1970_y / jan / 1}, sys_days{2040_y / jan / 1});
+    chrono_date::rcu_tzdb<tzdb_image> db{std::make_unique<const tzdb_image>(path)};
+
+    SECTION("snapshots keep replaced databases alive")
+    {
+        {
+            const auto before = db.get();
+            const auto nested = db.get();
+            db.publish(std::make_unique<const tzdb_image>(path));
+            const auto after = db.get();
+            CHECK(before.get() == nested.get());
+            CHECK(before.get() != after.get());
+            CHECK(db.retired() == 1);
+            CHECK(before->locate_zone("Europe/Berlin")->name() == "Europe/Berlin");
+        }
+        // the last reader freed it
+        CHECK(db.retired() == 0);
+    }
+    SECTION("make_zoned from many threads during reloads")
+    {
+        const auto dst_begin = local_days{2020_y / mar / 27} + 2h + 30min;
+        const auto expected = make_zoned("Asia/Jerusalem", dst_begin, choose::latest).get_sys_time();
+        const auto readers = std::max(4u, std::thread::hardware_concurrency());
+        std::atomic<bool> stop{false};
+        std::atomic<std::size_t> wrong{0};
+        std::atomic<std::size_t> reads{0};
+        std::vector<std::thread> threads;
+        for(unsigned i = 0; i < readers; ++i)
+        {
+            threads.emplace_back([&]
+            {
+                std::size_t n = 0;
+                while(!stop.load(std::memory_order_relaxed) || n == 0)
+                {
+                    const auto snapshot = db.get();
+                    const auto zt = make_zoned(snapshot->locate_zone("Asia/Jerusalem"), dst_begin, choose::latest);
+                    wrong += zt.get_sys_time() != expected;
+                    ++n;
+                }
+                reads += n;
+            });
+        }
+        for(int i = 0; i < 200; ++i)
+            db.publish(std::make_unique<const tzdb_image>(path));
+        stop = true;
+        for(auto& t : threads)
+            t.join();
+
+        CHECK(wrong == 0);
+        CHECK(reads >= readers);
+        CHECK(db.collect() == 0);
+    }
+    std::remove(path.c_str());
+}
+
+TEST_CASE("time zones at compile time")
+{
+    using namespace chrono_date::static_zones;
+
+    constexpr auto berlin = find("Europe/Berlin");
+    static_assert(berlin == &europe_berlin, "zones shall be found at compile time");
+    static_assert(find("Mars/Olympus_Mons") == nullptr, "unknown zones shall not be found");
+    static_assert(find("UTC") == find("Etc/UTC"), "links shall find their zone");
+
+    constexpr auto dst_begin = sys_days{2016_y / mar / 27} + 1h;
+    static_assert(berlin->to_local(dst_begin - 1s) == local_days{2016_y / mar / 27} + 1h + 59min + 59s
+                  && berlin->to_local(dst_begin) == local_days{2016_y / mar / 27} + 3h
+                  , "sys to local shall be calculated at compile time");
+    static_assert(berlin->to_sys(local_days{2016_y / mar / 27} + 2h + 30min, choose::earliest) == dst_begin
+                  && berlin->to_sys(local_days{2016_y / oct / 30} + 2h + 30min, choose::earliest)
+                     == sys_days{2016_y / oct / 30} + 30min
+                  && berlin->to_sys(local_days{2016_y / oct / 30} + 2h + 30min, choose::latest)
+                     == sys_days{2016_y / oct / 30} + 1h + 30min
+                  , "local to sys shall be calculated at compile time");
+    static_assert(asia_jerusalem.to_sys(local_days{2020_y / jul / 1}) == sys_days{2020_y / jul / 1} - 3h
+                  , "unique local times shall convert at compile time");
+
+    SECTION("same as the text database")
+    {
+        const auto from = sys_days{1970_y / jan / 1};
+        const auto to = sys_days{2100_y / jan / 1};
+        for(const auto zone : {&europe_berlin, &america_new_york, &asia_jerusalem, &utc})
+        {
+            const auto tz = locate_zone(zone->name());
+            std::size_t wrong = 0;
+            for(auto info = tz->get_info(from); info.begin < to; info = tz->get_info(info.end))
+            {
+                for(const auto d : {-3600s, -1s, 0s, 1s, 3600s})
+                {
+                    const auto st = std::max(info.begin, sys_seconds{from}) + d;
+                    wrong += !same_info(tz->get_info(st), zone->get_info(st));
+                    wrong += tz->to_local(st) != zone->to_local(st);
+                    const auto lt = local_seconds{st.time_since_epoch()} + info.offset;
+                    wrong += !same_info(tz->get_info(lt), zone->get_info(lt));
+                    wrong += tz->to_sys(lt, choose::earliest) != zone->to_sys(lt, choose::earliest);
+                    wrong += tz->to_sys(lt, choose::latest) != zone->to_sys(lt, choose::latest);
+                }
+                if(info.end >= to)
+                    break;
+            }
+            CHECK(wrong == 0);
+        }
+    }
+    SECTION("times outside of the generated range throw")
+    {
+        static_assert(europe_berlin.table_begin() <= range_begin() && europe_berlin.table_end() >= range_end()
+                      , "the tables shall cover the generated range");
+        for(const auto zone : {&europe_berlin, &america_new_york, &asia_jerusalem})
+        {
+            CHECK_NOTHROW(zone->get_info(zone->table_begin()));
+            CHECK_NOTHROW(zone->get_info(zone->table_end() - 1s));
+            CHECK_THROWS_AS(zone->get_info(zone->table_begin() - 1s), std::runtime_error);
+            CHECK_THROWS_AS(zone->get_info(zone->table_end()), std::runtime_error);
+            CHECK_THROWS_AS(zone->to_local(zone->table_begin() - days{200}), std::runtime_error);
+            CHECK_THROWS_AS(zone->to_sys(local_seconds{zone->table_end().time_since_epoch()} + days{200}),
+                            std::runtime_error);
+        }
+    }
+    SECTION("zoned_time on a static zone")
+    {
+        const auto never_existed = local_days{2016_y / mar / 27} + 2h + 30min;
+        CHECK_THROWS_AS(make_zoned(&europe_berlin, never_existed), nonexistent_local_time);
+        const auto existed_twice = local_days{2016_y / oct / 30} + 2h + 30min;
+        CHECK_THROWS_AS(make_zoned(&europe_berlin, existed_twice), ambiguous_local_time);
+        CHECK(make_zoned(&europe_berlin, existed_twice, choose::latest).get_info().abbrev == "CET");
+    }
+}
+
+TEST_CASE("lazily loaded tzdb image")
+{
+    using chrono_date::tzdb_image;
+    using chrono_date::tzdb_loading;
+    const auto path = std::string{"chrono_date_playground_lazy.tzdb"};
+    chrono_date::write_tzdb_image(get_tzdb(), path,
+                                  sys_days{1970_y / jan / 1}, sys_days{2040_y / jan / 1});
+    const tzdb_image eager{path, tzdb_loading::eager};
+    const tzdb_image lazy{path, tzdb_loading::lazy};
+    std::remove(path.c_str());
+
+    CHECK(eager.memory_stats().loaded_zones == eager.zone_count());
+    const auto before = lazy.memory_stats();
+    CHECK(before.zones == eager.zone_count());
+    CHECK(before.loaded_zones == 0);
+    CHECK(before.loaded_bytes == 0);
+    CHECK(before.index_bytes > 0);
+
+    SECTION("zones are loaded on first use")
+    {
+        const auto berlin = lazy.locate_zone("Europe/Berlin");
+        CHECK(lazy.locate_zone("Europe/Berlin") == berlin);
+        const auto one = lazy.memory_stats();
+        CHECK(one.loaded_zones == 1);
+        CHECK(one.loaded_bytes > sizeof(chrono_date::compiled_zone));
+        CHECK(one.loaded_bytes * 10 < eager.memory_stats().loaded_bytes);
+        // a link and its zone load the zone once
+        CHECK(lazy.locate_zone("US/Eastern") == lazy.locate_zone("America/New_York"));
+        CHECK(lazy.memory_stats().loaded_zones == 2);
+
+        const auto existed_twice = local_days{2016_y / oct / 30} + 2h + 30min;
+        CHECK(berlin->to_sys(existed_twice, choose::latest) ==
+              eager.locate_zone("Europe/Berlin")->to_sys(existed_twice, choose::latest));
+        CHECK(same_info(berlin->get_info(existed_twice), eager.locate_zone("Europe/Berlin")->get_info(existed_twice)));
+    }
+    SECTION("first use from many threads")
+    {
+        std::vector<const chrono_date::compiled_zone*> found(8);
+        std::vector<std::thread> threads;
+        for(std::size_t i = 0; i < found.size(); ++i)
+            threads.emplace_back([&, i]
+            {
+                found[i] = lazy.locate_zone("Asia/Jerusalem");
+            });
+        for(auto& t : threads)
+            t.join();
+        CHECK(std::count(found.begin(), found.end(), found[0]) == 8);
+        CHECK(lazy.memory_stats().loaded_zones == 1);
+    }
+}
+
+// puts the checks of the current zone back to their defaults, also when
+// a REQUIRE ends a test early
+struct current_zone_checks_reset
+{
+    ~current_zone_checks_reset()
+    {
+        chrono_date::detail::set_watched_localtime_path("/etc/localtime");
+        chrono_date::set_current_zone_check_interval(1s);
+    }
+};
+
+TEST_CASE("cached current time zone")
+{
+    const current_zone_checks_reset reset;
+    chrono_date::set_current_zone_check_interval(10ms);
+    const auto zone = chrono_date::cached_current_zone();
+    CHECK(zone == current_zone());
+
+    SECTION("resolved once")
+    {
+        const auto resolutions = chrono_date::current_zone_resolutions();
+        for(int i = 0; i < 100; ++i)
+            CHECK(chrono_date::cached_current_zone() == zone);
+        // the unchanged /etc/localtime is checked but does not drop the zone
+        std::this_thread::sleep_for(50ms);
+        CHECK(chrono_date::cached_current_zone() == zone);
+        CHECK(chrono_date::current_zone_resolutions() == resolutions);
+    }
+    SECTION("resolved again after invalidation")
+    {
+        const auto resolutions = chrono_date::current_zone_resolutions();
+        chrono_date::invalidate_current_zone();
+        CHECK(chrono_date::cached_current_zone() == zone);
+        CHECK(chrono_date::current_zone_resolutions() == resolutions + 1);
+    }
+    SECTION("from many threads")
+    {
+        std::atomic<std::size_t> wrong{0};
+        std::vector<std::thread> threads;
+        for(int i = 0; i < 4; ++i)
+            threads.emplace_back([&]
+            {
+                for(int j = 0; j < 10000; ++j)
+                {
+                    wrong += chrono_date::cached_current_zone() != zone;
+                    if(j % 1000 == 0)
+                        chrono_date::invalidate_current_zone();
+                }
+            });
+        for(auto& t : threads)
+            t.join();
+        CHECK(wrong == 0);
+    }
+#if !defined(_WIN32)
+    SECTION("resolved again after the link changed")
+    {
+        struct temporary_link
+        {
+            ~temporary_link()
+            {
+                std::remove(name.c_str());
+            }
+
+            std::string name;
+        };
+        const temporary_link temporary{"chrono_date_playground_localtime"};
+        const auto& link = temporary.name;
+        std::remove(link.c_str());
+        REQUIRE(::symlink("../usr/share/zoneinfo/Europe/Berlin", link.c_str()) == 0);
+        chrono_date::detail::set_watched_localtime_path(link);
+        CHECK(chrono_date::cached_current_zone() == zone);
+        const auto resolutions = chrono_date::current_zone_resolutions();
+
+        std::remove(link.c_str());
+        REQUIRE(::symlink("../usr/share/zoneinfo/Asia/Tokyo", link.c_str()) == 0);
+        // until the checking thread noticed, with a deadline far beyond
+        // its 10ms interval so that a missed change fails instead of hangs
+        const auto deadline = steady_clock::now() + 5s;
+        std::size_t wrong = 0;
+        while(chrono_date::current_zone_resolutions() == resolutions && steady_clock::now() < deadline)
+        {
+            wrong += chrono_date::cached_current_zone() != zone;
+            std::this_thread::yield();
+        }
+        CHECK(wrong == 0);
+        CHECK(chrono_date::current_zone_resolutions() == resolutions + 1);
+    }
+#endif
+}
+
+TEST_CASE("leap second cursor")
+{
+    // every leap second, with time points before, inside and after it
+    std::vector<sys_time<milliseconds>> sys_in;
+    for(const auto& ls : get_tzdb().leap_seconds)
+        for(auto d = -2000ms; d <= 2000ms; d += 250ms)
+            sys_in.push_back(ls.date() + d);
+    std::vector<date::utc_time<milliseconds>> utc_in;
+    for(const auto& st : sys_in)
+        for(const auto d : {-1000ms, -1ms, 0ms, 1ms, 1000ms})
+            utc_in.push_back(to_utc_time(st) + d);
+
+    SECTION("sorted streams")
+    {
+        std::vector<date::utc_time<milliseconds>> utc_out(sys_in.size());
+        chrono_date::to_utc_time(sys_in.data(), sys_in.size(), utc_out.data());
+        std::vector<sys_time<milliseconds>> sys_out(utc_in.size());
+        chrono_date::to_sys_time(utc_in.data(), utc_in.size(), sys_out.data());
+
+        std::size_t wrong = 0;
+        for(std::size_t i = 0; i < sys_in.size(); ++i)
+            wrong += utc_out[i] != to_utc_time(sys_in[i]);
+        for(std::size_t i = 0; i < utc_in.size(); ++i)
+            wrong += sys_out[i] != to_sys_time(utc_in[i]);
+        CHECK(wrong == 0);
+
+        chrono_date::leap_second_cursor cursor;
+        for(const auto& st : sys_in)
+            cursor.to_utc_time(st);
+        CHECK(cursor.steps() == get_tzdb().leap_seconds.size());
+    }
+    SECTION("unsorted input")
+    {
+        std::shuffle(sys_in.begin(), sys_in.end(), std::mt19937{19860930});
+        std::shuffle(utc_in.begin(), utc_in.end(), std::mt19937{19860930});
+        chrono_date::leap_second_cursor cursor;
+        std::size_t wrong = 0;
+        for(const auto& st : sys_in)
+            wrong += cursor.to_utc_time(st) != to_utc_time(st);
+        for(const auto& ut : utc_in)
+            wrong += cursor.to_sys_time(ut) != to_sys_time(ut);
+        CHECK(wrong == 0);
+    }
+    SECTION("seconds")
+    {
+        const auto leap = sys_seconds{sys_days{2016_y / dec / 31} + 23h + 59min + 59s};
+        chrono_date::leap_second_cursor cursor;
+        const auto ut = cursor.to_utc_time(leap);
+        CHECK(ut == to_utc_time(leap));
+        CHECK(cursor.to_sys_time(ut + 1s) == to_sys_time(ut + 1s));
+        CHECK(cursor.to_sys_time(ut + 1s) == leap);
+        CHECK(cursor.to_sys_time(ut + 2s) == leap + 1s);
+    }
+}
+
+TEST_CASE("calendar buckets")
+{
+    const auto zone = locate_zone("Europe/Berlin");
+    const std::uint32_t outside = chrono_date::calendar_buckets::outside;
+    // around the dst changes of 2021 and across a year end
+    const auto first = sys_seconds{sys_days{2020_y / dec / 1}};
+    const auto last = sys_seconds{sys_days{2021_y / dec / 31}};
+
+    SECTION("edges")
+    {
+        const chrono_date::calendar_buckets days{zone, chrono_date::calendar_unit::day, first, last};
+        CHECK(days.size() == 396);
+        CHECK(days.begin(0) == first - 1h);
+        CHECK(days.label(0) == local_days{2020_y / dec / 1});
+        const auto b = days.bucket(sys_seconds{sys_days{2021_y / mar / 28}});
+        CHECK(days.label(b) == local_days{2021_y / mar / 28});
+        CHECK(days.end(b) - days.begin(b) == 23h);
+
+        const chrono_date::calendar_buckets weeks{zone, chrono_date::calendar_unit::iso_week, first, last};
+        CHECK(weeks.label(0) == local_days{2020_y / nov / 30});
+        CHECK(weekday{weeks.label(weeks.size() - 1)} == mon);
+
+        const chrono_date::calendar_buckets quarters{zone, chrono_date::calendar_unit::quarter, first, last};
+        CHECK(quarters.size() == 5);
+        CHECK(quarters.label(0) == local_days{2020_y / oct / 1});
+        CHECK(quarters.end(4) == sys_seconds{sys_days{2022_y / jan / 1}} - 1h);
+
+        CHECK(quarters.bucket(quarters.begin(0) - 1s) == outside);
+        CHECK(quarters.bucket(quarters.end(4)) == outside);
+        CHECK(quarters.bucket(quarters.end(4) - 1ms) == 4);
+    }
+    SECTION("skipped day")
+    {
+        // Samoa went from 2011-12-29 directly to 2011-12-31
+        const auto apia = locate_zone("Pacific/Apia");
+        const auto skip = apia->to_sys(local_days{2011_y / dec / 31});
+        const chrono_date::calendar_buckets days{apia, chrono_date::calendar_unit::day, skip - 48h, skip + 48h};
+        CHECK(days.label(days.bucket(skip - 1s)) == local_days{2011_y / dec / 29});
+        CHECK(days.label(days.bucket(skip)) == local_days{2011_y / dec / 31});
+        CHECK(days.bucket(skip) == days.bucket(skip - 1s) + 2);
+    }
+    SECTION("same as make_zoned")
+    {
+        std::mt19937_64 gen{19860930};
+        std::vector<sys_time<milliseconds>> in(200000);
+        const auto range = static_cast<std::uint64_t>(duration_cast<milliseconds>(last - first).count());
+        for(auto& tp : in)
+            tp = first + milliseconds{static_cast<std::int64_t>(gen() % range)};
+
+        for(const auto unit : {chrono_date::calendar_unit::day, chrono_date::calendar_unit::iso_week,
+                               chrono_date::calendar_unit::month, chrono_date::calendar_unit::quarter,
+                               chrono_date::calendar_unit::year})
+        {
+            const chrono_date::calendar_buckets buckets{zone, unit, first, last};
+            std::vector<std::uint32_t> out(in.size());
+            buckets.assign(in.data(), in.size(), out.data(), 4);
+            const auto counts = buckets.count(in.data(), in.size(), 4);
+            CHECK(counts.back() == 0);
+
+            std::size_t wrong = 0;
+            std::vector<std::size_t> expected(buckets.size() + 1);
+            for(std::size_t i = 0; i < in.size(); ++i)
+            {
+                const auto local = floor<days>(make_zoned(zone, in[i]).get_local_time());
+                wrong += out[i] == outside || local < buckets.label(out[i]) ||
+                         (out[i] + 1 < buckets.size() && local >= buckets.label(out[i] + 1));
+                ++expected[out[i]];
+            }
+            CHECK(wrong == 0);
+            CHECK(counts == expected);
+        }
+    }
+}
+
+#if defined(CHRONO_DATE_HAS_COROUTINES)
+namespace
+{
+
+struct detached_task
+{
+    struct promise_type
+    {
+        detached_task get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+detached_task sleep_twice(chrono_date::coroutine_wheel<milliseconds, steady_clock>& wheel,
+                          steady_clock::time_point origin, std::vector<int>& log)
+{
+    log.push_back(0);
+    co_await chrono_date::sleep_until(wheel, origin + 10ms);
+    log.push_back(10);
+    co_await chrono_date::sleep_until(wheel, origin + 25ms);
+    log.push_back(25);
+}
+
+}
+#endif
+
+TEST_CASE("timing wheel")
+{
+    const auto origin = steady_clock::time_point{};
+
+    SECTION("every timer fires once, not early and in order of ticks")
+    {
+        // up to 100 days, beyond the 2^32 ms the levels cover
+        std::mt19937_64 gen{19860930};
+        chrono_date::timing_wheel<std::size_t> wheel{origin};
+        std::vector<milliseconds> deadlines(100000);
+        for(std::size_t i = 0; i < deadlines.size(); ++i)
+        {
+            deadlines[i] = milliseconds{static_cast<std::int64_t>(gen() % (i % 2 == 0 ? 60000 : 8640000000))};
+            wheel.schedule(origin + deadlines[i], i);
+        }
+        CHECK(wheel.size() == deadlines.size());
+
+        std::vector<int> fired(deadlines.size());
+        std::size_t wrong = 0;
+        auto last = milliseconds{0};
+        auto until = milliseconds{0};
+        while(!wheel.empty())
+        {
+            const auto from = until;
+            until += milliseconds{static_cast<std::int64_t>(gen() % (until < 60s ? 100 : 100000000))};
+            wheel.advance(origin + until, [&](std::size_t i)
+            {
+                ++fired[i];
+                const auto d = std::max(deadlines[i], 1ms);
+                wrong += d > until || d <= from || d < last;
+                last = d;
+            });
+            CHECK(wheel.now() == origin + until);
+        }
+        CHECK(wrong == 0);
+        CHECK(std::count(fired.begin(), fired.end(), 1) == static_cast<std::ptrdiff_t>(fired.size()));
+    }
+    SECTION("cancel")
+    {
+        chrono_date::timing_wheel<int> wheel{origin};
+        std::vector<chrono_date::timer_id> ids;
+        for(int i = 0; i < 1000; ++i)
+            ids.push_back(wheel.schedule(origin + milliseconds{i * 7}, i));
+        for(std::size_t i = 0; i < ids.size(); i += 2)
+            CHECK(wheel.cancel(ids[i]));
+        CHECK_FALSE(wheel.cancel(ids[0]));
+        CHECK(wheel.size() == 500);
+
+        int odd = 0;
+        CHECK(wheel.advance(origin + 7000ms, [&](int i) { odd += i % 2; }) == 500);
+        CHECK(odd == 500);
+        CHECK_FALSE(wheel.cancel(ids[1]));
+
+        // a reused node does not answer to the old id
+        const auto id = wheel.schedule(origin + 8s, 0);
+        CHECK(id.index == ids[999].index);
+        CHECK_FALSE(wheel.cancel(ids[999]));
+        CHECK(wheel.cancel(id));
+
+        // far more cancelled than pending timers
+        wheel.schedule(origin + 2h, 1);
+        for(int i = 0; i < 10000; ++i)
+            CHECK(wheel.cancel(wheel.schedule(origin + 1h + milliseconds{i}, i)));
+        CHECK(wheel.advance(origin + 3h, [](int i) { CHECK(i == 1); }) == 1);
+        CHECK(wheel.empty());
+    }
+    SECTION("own ticks")
+    {
+        using Tick = duration<int, ratio<1, 4>>;
+        chrono_date::timing_wheel<int, Tick> wheel{origin};
+        int fired = 0;
+        wheel.schedule(origin + 300ms, 1);
+        CHECK(wheel.advance(origin + 499ms, [&](int i) { fired += i; }) == 0);
+        CHECK(wheel.advance(origin + 500ms, [&](int i) { fired += i; }) == 1);
+        CHECK(fired == 1);
+        CHECK(wheel.now() == origin + 500ms);
+    }
+    SECTION("timers scheduled while expiring")
+    {
+        chrono_date::timing_wheel<int> wheel{origin};
+        std::vector<int> log;
+        wheel.schedule(origin + 1ms, 1);
+        CHECK(wheel.advance(origin + 10ms, [&](int i)
+        {
+            log.push_back(i);
+            if(i < 5)
+            {
+                wheel.schedule(wheel.now(), i + 1);
+                wheel.schedule(origin + 1h, -1);
+            }
+        }) == 5);
+        CHECK(log == (std::vector<int>{1, 2, 3, 4, 5}));
+        CHECK(wheel.size() == 4);
+    }
+    SECTION("callback that throws")
+    {
+        chrono_date::timing_wheel<int> wheel{origin};
+        for(int i = 0; i < 3; ++i)
+            wheel.schedule(origin + 5ms, i);
+        wheel.schedule(origin + 6ms, 3);
+        std::vector<int> log;
+        const auto fire = [&](int i)
+        {
+            log.push_back(i);
+            if(i == 1)
+                throw std::runtime_error("callback");
+        };
+        CHECK_THROWS_AS(wheel.advance(origin + 10ms, fire), std::runtime_error);
+        CHECK(log == (std::vector<int>{0, 1}));
+        CHECK(wheel.size() == 1);
+        CHECK(wheel.now() == origin + 5ms);
+
+        // the wheel goes on, through the same slot a turn later too, and
+        // still drops cancelled entries
+        CHECK(wheel.advance(origin + 10ms, fire) == 1);
+        CHECK(log == (std::vector<int>{0, 1, 3}));
+        wheel.schedule(origin + 261ms, 4);
+        for(int i = 0; i < 10000; ++i)
+            CHECK(wheel.cancel(wheel.schedule(origin + 1h + milliseconds{i}, i)));
+        CHECK(wheel.advance(origin + 2h, fire) == 1);
+        CHECK(log == (std::vector<int>{0, 1, 3, 4}));
+        CHECK(wheel.empty());
+    }
+#if defined(CHRONO_DATE_HAS_COROUTINES)
+    SECTION("sleeping coroutine")
+    {
+        chrono_date::coroutine_wheel<milliseconds, steady_clock> wheel{origin};
+        std::vector<int> log;
+        sleep_twice(wheel, origin, log);
+        CHECK(log == std::vector<int>{0});
+        chrono_date::resume_expired(wheel, origin + 9ms);
+        CHECK(log == std::vector<int>{0});
+        chrono_date::resume_expired(wheel, origin + 30ms);
+        CHECK(log == (std::vector<int>{0, 10, 25}));
+        CHECK(wheel.empty());
+    }
+#endif
+}
+
+TEST_CASE("zone pair converter")
+{
+    const auto first = sys_seconds{sys_days{1975_y / jan / 1}};
+    const auto last = sys_seconds{sys_days{2030_y / jan / 1}};
+
+    SECTION("same as make_zoned")
+    {
+        // local times around every transition of both zones and in between
+        const std::pair<const char*, const char*> pairs[] = {
+            {"America/New_York", "Asia/Tehran"},
+            {"Europe/Berlin", "America/New_York"},
+            {"Asia/Jerusalem", "Pacific/Apia"},
+            {"Australia/Lord_Howe", "Europe/Berlin"}};
+        std::mt19937_64 gen{19860930};
+        for(const auto& p : pairs)
+        {
+            const auto from = locate_zone(p.first);
+            const auto to = locate_zone(p.second);
+            const auto converter = chrono_date::make_zone_pair_converter(from, to, first, last);
+            std::vector<local_time<milliseconds>> in;
+            for(const auto zone : {from, to})
+                for(auto i = zone->get_info(first); i.end < last; i = zone->get_info(i.end))
+                    for(auto d = -180min; d <= 180min; d += 15min)
+                        in.push_back(local_time<milliseconds>{(i.end + d).time_since_epoch() + i.offset} +
+                                     milliseconds{static_cast<std::int64_t>(gen() % 1000)});
+            const auto range = static_cast<std::uint64_t>(duration_cast<milliseconds>(last - first + 48h).count());
+            for(int i = 0; i < 10000; ++i)
+                in.push_back(local_time<milliseconds>{(first - 24h).time_since_epoch()} +
+                             milliseconds{static_cast<std::int64_t>(gen() % range)});
+
+            std::size_t wrong = 0;
+            for(const auto& tp : in)
+            {
+                const auto info = from->get_info(tp);
+                for(const auto c : {choose::earliest, choose::latest})
+                {
+                    auto r = chrono_date::local_result::unique;
+                    const auto lt = converter.to_local(tp, c, r);
+                    wrong += lt != make_zoned(to, make_zoned(from, tp, c).get_sys_time()).get_local_time();
+                    wrong += static_cast<int>(r) != static_cast<int>(info.result);
+                }
+            }
+            CHECK(wrong == 0);
+        }
+    }
+    SECTION("exceptions of make_zoned")
+    {
+        const auto converter =
+            chrono_date::make_zone_pair_converter(locate_zone("Europe/Berlin"), locate_zone("Asia/Tehran"), first, last);
+        CHECK(converter.to_local(local_days{2021_y / mar / 28} + 1h + 59min) ==
+              local_days{2021_y / mar / 28} + 5h + 29min);
+        CHECK_THROWS_AS(converter.to_local(local_days{2021_y / mar / 28} + 2h + 30min), nonexistent_local_time);
+        CHECK_THROWS_AS(converter.to_local(local_days{2021_y / oct / 31} + 2h + 30min), ambiguous_local_time);
+        CHECK(converter.to_local(local_days{2021_y / oct / 31} + 2h + 30min, choose::latest) ==
+              local_days{2021_y / oct / 31} + 5h);
+    }
+}
+
+TEST_CASE("fast clocks")
+{
+    static_assert(chrono_date::coarse_steady_clock::is_steady, "");
+    static_assert(chrono_date::tsc_clock::is_steady, "");
+    // generous bounds, the ticker might not get a cpu for a while; every
+    // check brackets a reading by the standard clock, so none of them
+    // depends on how fast the test runs
+    const auto slack = 100ms;
+
+    SECTION("coarse clocks")
+    {
+        const auto before = system_clock::now();
+        const sys_time<system_clock::duration> coarse = chrono_date::coarse_system_clock::now();
+        CHECK(coarse <= system_clock::now());
+        CHECK(coarse >= before - slack);
+
+        auto last = chrono_date::coarse_steady_clock::now();
+        std::size_t backwards = 0;
+        for(int i = 0; i < 100000; ++i)
+        {
+            const auto now = chrono_date::coarse_steady_clock::now();
+            backwards += now < last;
+            last = now;
+        }
+        CHECK(backwards == 0);
+        const auto steady_before = steady_clock::now();
+        const auto coarse_steady = chrono_date::coarse_steady_clock::now();
+        CHECK(coarse_steady <= steady_clock::now());
+        CHECK(coarse_steady >= steady_before - slack);
+    }
+    SECTION("tsc clock")
+    {
+        auto last = chrono_date::tsc_clock::now();
+        std::size_t backwards = 0;
+        for(int i = 0; i < 100000; ++i)
+        {
+            const auto now = chrono_date::tsc_clock::now();
+            backwards += now < last;
+            last = now;
+        }
+        CHECK(backwards == 0);
+        if(chrono_date::tsc_clock_is_native())
+        {
+            // never before the calibration it is counted from
+            const auto& c = chrono_date::detail::tsc_calibration_data;
+            CHECK(chrono_date::tsc_clock::now().time_since_epoch().count() >= c.ns.load());
+        }
+        const auto steady_before = steady_clock::now();
+        const auto tsc = chrono_date::tsc_clock::now();
+        const auto steady_after = steady_clock::now();
+        CHECK(tsc >= steady_before - slack);
+        CHECK(tsc <= steady_after + slack);
+    }
+    SECTION("today")
+    {
+        const auto coarse_before = floor<days>(chrono_date::coarse_system_clock::now());
+        const auto today = sys_days{chrono_date::cached_today()};
+        const auto coarse_after = floor<days>(chrono_date::coarse_system_clock::now());
+        CHECK(today >= coarse_before);
+        CHECK(today <= coarse_after);
+
+        const auto before = floor<days>(system_clock::now() - slack);
+        const auto cached = sys_days{chrono_date::cached_today()};
+        const auto after = floor<days>(system_clock::now());
+        CHECK(cached >= before);
+        CHECK(cached <= after);
+    }
+}
+
+TEST_CASE("timestamp codec")
+{
+    const auto round_trips = [](const std::vector<sys_time<milliseconds>>& in)
+    {
+        const auto column = chrono_date::encode_timestamps(in.data(), in.size());
+        std::vector<sys_time<milliseconds>> out(in.size());
+        column.decode(0, column.size(), out.data());
+        const chrono_date::timestamp_column<milliseconds> read{column.words()};
+        return column.size() == in.size() && out == in && read[in.size() - 1] == in.back();
+    };
+
+    SECTION("edges of the calendar")
+    {
+        // around the epoch, leap days and the turn of centuries
+        std::vector<sys_time<milliseconds>> in;
+        for(const auto d : {sys_days{1969_y / dec / 31}, sys_days{1600_y / feb / 29}, sys_days{1900_y / feb / 28},
+                            sys_days{2000_y / feb / 29}, sys_days{2024_y / feb / 29}, sys_days{2100_y / mar / 1}})
+        {
+            for(auto t = sys_time<milliseconds>{d} - 1h; t < d + days{1} + 1h; t += 997ms)
+                in.push_back(t);
+        }
+        CHECK(round_trips(in));
+
+        const auto column = chrono_date::encode_timestamps(in.data(), in.size());
+        std::vector<std::int16_t> y(in.size());
+        std::vector<std::uint8_t> m(in.size());
+        std::vector<std::uint8_t> d(in.size());
+        std::vector<std::uint8_t> h(in.size());
+        std::vector<std::uint8_t> min(in.size());
+        std::vector<std::uint8_t> s(in.size());
+        std::vector<milliseconds::rep> ms(in.size());
+        column.decode_fields(0, column.size(), {y.data(), m.data(), d.data()},
+                             {h.data(), min.data(), s.data(), ms.data()});
+        std::size_t wrong = 0;
+        for(std::size_t i = 0; i < in.size(); ++i)
+        {
+            const auto day = floor<days>(in[i]);
+            const auto time = make_time(in[i] - day);
+            wrong += year_month_day{day} != year{y[i]} / month{m[i]} / d[i] || time.hours().count() != h[i] ||
+                     time.minutes().count() != min[i] || time.seconds().count() != s[i] ||
+                     time.subseconds().count() != ms[i];
+        }
+        CHECK(wrong == 0);
+        // regular ticks pack into a few bits each
+        CHECK(column.words().size() * 8 < in.size());
+    }
+    SECTION("arbitrary ticks")
+    {
+        std::mt19937_64 gen{42};
+        std::vector<sys_time<milliseconds>> in(1000);
+        for(auto& t : in)
+            t = sys_time<milliseconds>{milliseconds{static_cast<std::int64_t>(gen())}};
+        in[3] = sys_time<milliseconds>{milliseconds{std::numeric_limits<std::int64_t>::min()}};
+        in[4] = sys_time<milliseconds>{milliseconds{std::numeric_limits<std::int64_t>::max()}};
+        CHECK(round_trips(in));
+        CHECK(round_trips({in.begin(), in.begin() + 1}));
+        CHECK(round_trips({in.begin(), in.begin() + 129}));
+    }
+    SECTION("random access")
+    {
+        std::vector<sys_time<milliseconds>> in;
+        for(auto t = sys_time<milliseconds>{sys_days{1960_y / jan / 1}}; in.size() < 1000; t += milliseconds{in.size() % 7})
+            in.push_back(t);
+        const auto column = chrono_date::encode_timestamps(in.data(), in.size());
+        std::size_t wrong = 0;
+        for(std::size_t i = 0; i < in.size(); ++i)
+            wrong += column[i] != in[i];
+        CHECK(wrong == 0);
+
+        std::vector<sys_time<milliseconds>> out(300);
+        column.decode(100, 300, out.data());
+        CHECK(std::equal(out.begin(), out.end(), in.begin() + 100));
+        for(const auto isa : {chrono_date::simd_isa::generic, chrono_date::simd_isa::avx2})
+        {
+            column.decode(isa, 517, 300, out.data());
+            CHECK(std::equal(out.begin(), out.end(), in.begin() + 517));
+        }
+    }
+    SECTION("stored columns")
+    {
+        CHECK(chrono_date::timestamp_column<seconds>{}.size() == 0);
+        const std::vector<sys_seconds> in{sys_days{1970_y / jan / 1}, sys_days{1970_y / jan / 2}};
+        const auto words = chrono_date::encode_timestamps(in.data(), in.size()).words();
+        CHECK(chrono_date::timestamp_column<seconds>{words}[1] == in[1]);
+        CHECK_THROWS_AS(chrono_date::timestamp_column<milliseconds>{words}, std::runtime_error);
+        CHECK_THROWS_AS(chrono_date::timestamp_column<seconds>({words.begin(), words.end() - 1}), std::runtime_error);
+        // a count whose number of blocks overflows when rounded up
+        CHECK_THROWS_AS(chrono_date::timestamp_column<seconds>({~std::uint64_t{0}, 1, 1, 0}), std::runtime_error);
+        auto wide = words;
+        wide[wide[3] + 2] = 65;
+        CHECK_THROWS_AS(chrono_date::timestamp_column<seconds>{wide}, std::runtime_error);
+    }
+}
+
+TEST_CASE("tzdb image compiled in parallel")
+{
+    const auto from = sys_seconds{sys_days{1850_y / jan / 1}};
+    const auto to   = sys_seconds{sys_days{2100_y / jan / 1}};
+    const auto read = [](const std::string& path)
+    {
+        std::ifstream in{path, std::ios::binary};
+        const std::string bytes{std::istreambuf_iterator<char>{in}, std::istreambuf_iterator<char>{}};
+        std::remove(path.c_str());
+        return bytes;
+    };
+
+    chrono_date::write_tzdb_image(get_tzdb(), "chrono_date_playground_sequential.tzdb", from, to);
+    std::vector<chrono_date::zone_compile_trace> traces;
+    chrono_date::tzdb_image_options options;
+    options.threads = 4;
+    options.trace = [&](const chrono_date::zone_compile_trace& t) { traces.push_back(t); };
+    chrono_date::write_tzdb_image(get_tzdb(), "chrono_date_playground_parallel.tzdb", from, to, options);
+
+    const auto sequential = read("chrono_date_playground_sequential.tzdb");
+    CHECK(!sequential.empty());
+    CHECK(read("chrono_date_playground_parallel.tzdb") == sequential);
+
+    REQUIRE(traces.size() == get_tzdb().zones.size());
+    std::size_t wrong = 0;
+    for(std::size_t i = 0; i < traces.size(); ++i)
+        wrong += traces[i].zone != get_tzdb().zones[i].name() || traces[i].infos == 0 || traces[i].worker >= 4;
+    CHECK(wrong == 0);
+}
+
+// every batch conversion from From to To against the scalar one
+template<class To, class From>
+static std::size_t batch_conversion_mismatches(const std::vector<From>& in)
+{
+    std::vector<To> cast(in.size());
+    std::vector<To> floored(in.size());
+    std::vector<To> ceiled(in.size());
+    std::vector<To> rounded(in.size());
+    std::size_t wrong = 0;
+    for(const auto isa : {chrono_date::simd_isa::generic, chrono_date::simd_isa::avx2})
+    {
+        chrono_date::duration_cast_batch(isa, in.data(), in.size(), cast.data());
+        chrono_date::floor_batch(isa, in.data(), in.size(), floored.data());
+        chrono_date::ceil_batch(isa, in.data(), in.size(), ceiled.data());
+        chrono_date::round_batch(isa, in.data(), in.size(), rounded.data());
+        for(std::size_t i = 0; i < in.size(); ++i)
+            wrong += cast[i] != duration_cast<To>(in[i]) || floored[i] != floor<To>(in[i]) ||
+                     ceiled[i] != ceil<To>(in[i]) || rounded[i] != round<To>(in[i]);
+    }
+    return wrong;
+}
+
+template<class Duration>
+static std::size_t batch_split_mismatches(const std::vector<Duration>& in)
+{
+    using precision = typename date::hh_mm_ss<Duration>::precision;
+    std::vector<std::uint8_t> negative(in.size());
+    std::vector<hours::rep> h(in.size());
+    std::vector<std::uint8_t> m(in.size());
+    std::vector<std::uint8_t> s(in.size());
+    std::vector<typename precision::rep> sub(in.size());
+    chrono_date::split_batch(in.data(), in.size(), {negative.data(), h.data(), m.data(), s.data(), sub.data()});
+    std::size_t wrong = 0;
+    for(std::size_t i = 0; i < in.size(); ++i)
+    {
+        const auto hms = make_time(in[i]);
+        wrong += hms.is_negative() != (negative[i] != 0) || hms.hours().count() != h[i] ||
+                 hms.minutes().count() != m[i] || hms.seconds().count() != s[i] ||
+                 hms.subseconds().count() != sub[i];
+    }
+    return wrong;
+}
+
+template<class Duration>
+static std::vector<Duration> batch_inputs(typename Duration::rep range)
+{
+    std::mt19937_64 gen{7};
+    std::vector<Duration> v;
+    for(typename Duration::rep r = -1000; r <= 1000; ++r)
+        v.push_back(Duration{r});
+    for(int i = 0; i < 10000; ++i)
+        v.push_back(Duration{static_cast<typename Duration::rep>(gen() % (2 * static_cast<std::uint64_t>(range))) - range});
+    return v;
+}
+
+TEST_CASE("batch duration conversions")
+{
+    using Tick = duration<int, ratio<1, 4>>;
+    using Third = duration<std::int64_t, ratio<1, 3>>;
+
+    SECTION("the rounding table")
+    {
+        const std::vector<milliseconds> in{750ms, 250ms, -750ms, -250ms, 500ms, -500ms, 1500ms, -1500ms};
+        std::vector<seconds> out(in.size());
+        chrono_date::round_batch(in.data(), in.size(), out.data());
+        CHECK(out == (std::vector<seconds>{1s, 0s, -1s, 0s, 0s, 0s, 2s, -2s}));
+        chrono_date::floor_batch(in.data(), in.size(), out.data());
+        CHECK(out == (std::vector<seconds>{0s, 0s, -1s, -1s, 0s, -1s, 1s, -2s}));
+        chrono_date::ceil_batch(in.data(), in.size(), out.data());
+        CHECK(out == (std::vector<seconds>{1s, 1s, 0s, 0s, 1s, 0s, 2s, -1s}));
+        chrono_date::duration_cast_batch(in.data(), in.size(), out.data());
+        CHECK(out == (std::vector<seconds>{0s, 0s, 0s, 0s, 0s, 0s, 1s, -1s}));
+    }
+    SECTION("identical to the scalar conversions")
+    {
+        const auto ms = batch_inputs<milliseconds>(std::int64_t{1} << 50);
+        CHECK(batch_conversion_mismatches<seconds>(ms) == 0);
+        CHECK(batch_conversion_mismatches<hours>(ms) == 0);
+        CHECK(batch_conversion_mismatches<Tick>(batch_inputs<milliseconds>(1 << 28)) == 0);
+        CHECK(batch_conversion_mismatches<Third>(ms) == 0);
+        CHECK(batch_conversion_mismatches<nanoseconds>(batch_inputs<milliseconds>(std::int64_t{1} << 40)) == 0);
+
+        const auto ticks = batch_inputs<Tick>(1 << 30);
+        CHECK(batch_conversion_mismatches<milliseconds>(ticks) == 0);
+        CHECK(batch_conversion_mismatches<duration<int, std::centi>>(ticks) == 0);
+        CHECK(batch_conversion_mismatches<seconds>(ticks) == 0);
+        CHECK(batch_conversion_mismatches<Third>(ticks) == 0);
+        CHECK(batch_conversion_mismatches<Tick>(batch_inputs<duration<int, std::centi>>(1 << 30)) == 0);
+        CHECK(batch_conversion_mismatches<seconds>(batch_inputs<nanoseconds>(std::numeric_limits<std::int64_t>::max())) == 0);
+    }
+    SECTION("hh_mm_ss fields")
+    {
+        CHECK(batch_split_mismatches(batch_inputs<milliseconds>(std::int64_t{1} << 50)) == 0);
+        CHECK(batch_split_mismatches(batch_inputs<nanoseconds>(std::numeric_limits<std::int64_t>::max())) == 0);
+        CHECK(batch_split_mismatches(batch_inputs<Tick>(1 << 30)) == 0);
+        CHECK(batch_split_mismatches(batch_inputs<Third>(std::int64_t{1} << 50)) == 0);
+        CHECK(batch_split_mismatches(batch_inputs<minutes>(1 << 30)) == 0);
+        CHECK(batch_split_mismatches(batch_inputs<duration<int, std::centi>>(1 << 30)) == 0);
+    }
+}
+
+TEST_CASE("packed zoned times")
+{
+    using packed = chrono_date::packed_zoned_time<>;
+    static_assert(sizeof(packed) == 8, "a zone id and seconds in a word");
+
+    const auto berlin = chrono_date::intern_zone("Europe/Berlin");
+    const auto new_york = chrono_date::intern_zone("America/New_York");
+    const auto tp = sys_days{2016_y / oct / 30} + 1h + 30min;
+
+    SECTION("round trip through zoned_time")
+    {
+        const auto zt = make_zoned("Europe/Berlin", tp);
+        const auto p = packed{zt};
+        CHECK(p.zone() == berlin);
+        CHECK(p.get_sys_time() == tp);
+        CHECK(p.get_time_zone() == locate_zone("Europe/Berlin"));
+        CHECK(p.get_local_time() == zt.get_local_time());
+        CHECK(p.get_info().abbrev == zt.get_info().abbrev);
+        CHECK(p.to_zoned().get_sys_time() == tp);
+        CHECK(p.to_zoned().get_time_zone() == zt.get_time_zone());
+        CHECK(packed::from_raw(p.raw()) == p);
+        CHECK_FALSE(packed{}.zone());
+    }
+    SECTION("no zone")
+    {
+        const packed none;
+        CHECK(none.get_sys_time() == sys_seconds{});
+        CHECK_THROWS_AS(none.get_time_zone(), std::runtime_error);
+        CHECK_THROWS_AS(none.get_local_time(), std::runtime_error);
+        CHECK_THROWS_AS(none.get_info(), std::runtime_error);
+        CHECK_THROWS_AS(none.to_zoned(), std::runtime_error);
+        // an id past the zones of the registry
+        const auto unknown = packed{chrono_date::zone_handle{0xfffe}, tp};
+        CHECK_THROWS_AS(unknown.get_info(), std::runtime_error);
+    }
+    SECTION("ordered by sys time, then by zone")
+    {
+        CHECK(packed{berlin, tp} < packed{berlin, tp + 1s});
+        CHECK(packed{new_york, tp - 1s} < packed{berlin, tp});
+        CHECK(packed{new_york, packed::min_time()} < packed{berlin, sys_seconds{}});
+        CHECK((packed{berlin, tp} < packed{new_york, tp}) == (berlin < new_york));
+        CHECK(packed{berlin, tp} != packed{new_york, tp});
+
+        std::mt19937_64 gen{11};
+        std::vector<packed> v;
+        std::vector<std::pair<sys_seconds, std::uint16_t>> expected;
+        for(int i = 0; i < 1000; ++i)
+        {
+            const auto zone = chrono_date::zone_handle{static_cast<std::uint16_t>(gen() % 400)};
+            const auto t = sys_seconds{seconds{static_cast<std::int64_t>(gen() % 4000000000) - 2000000000}};
+            v.emplace_back(zone, t);
+            expected.emplace_back(t, zone.id());
+        }
+        std::sort(v.begin(), v.end());
+        std::sort(expected.begin(), expected.end());
+        std::size_t wrong = 0;
+        for(std::size_t i = 0; i < v.size(); ++i)
+            wrong += v[i].get_sys_time() != expected[i].first || v[i].zone().id() != expected[i].second;
+        CHECK(wrong == 0);
+    }
+    SECTION("other layouts")
+    {
+        using milli_packed = chrono_date::packed_zoned_time<milliseconds, 12>;
+        const auto ms = tp + 123ms;
+        CHECK(milli_packed{berlin, ms}.get_sys_time() == ms);
+        CHECK(milli_packed{berlin, ms}.zone() == berlin);
+        CHECK(milli_packed{berlin, milli_packed::max_time()}.get_sys_time() == milli_packed::max_time());
+        CHECK(milli_packed::max_time() > sys_days{9999_y / dec / 31});
+        CHECK_THROWS_AS((milli_packed{berlin, milli_packed::max_time() + 1ms}), std::runtime_error);
+        CHECK_THROWS_AS((milli_packed{berlin, milli_packed::min_time() - 1ms}), std::runtime_error);
+        CHECK_THROWS_AS((chrono_date::packed_zoned_time<seconds, 4>{berlin, tp}), std::runtime_error);
+        CHECK_THROWS_AS((packed{chrono_date::zone_handle{}, tp}), std::runtime_error);
+    }
+    SECTION("vectors of zoned times")
+    {
+        std::vector<zoned_time<seconds>> zts;
+        for(int i = 0; i < 10; ++i)
+            zts.push_back(make_zoned(i < 5 ? "Europe/Berlin" : "America/New_York", tp + hours{i}));
+        std::vector<packed> v(zts.size());
+        chrono_date::pack_zoned_times(zts.data(), zts.size(), v.data());
+        std::size_t wrong = 0;
+        for(std::size_t i = 0; i < v.size(); ++i)
+            wrong += v[i].to_zoned().get_sys_time() != zts[i].get_sys_time() ||
+                     v[i].to_zoned().get_time_zone() != zts[i].get_time_zone();
+        CHECK(wrong == 0);
+    }
+}
+
+// the dates of a recurrence every n months on day of the month, by hand
+static std::vector<sys_days> months_by_hand(year_month_day first, sys_days until, int n, chrono_date::month_overflow o)
+{
+    std::vector<sys_days> v;
+    for(auto ym = first.year() / first.month(); sys_days{ym / 1} <= until; ym += months{n})
+    {
+        auto ymd = ym / first.day();
+        if(!ymd.ok())
+        {
+            if(o == chrono_date::month_overflow::skip)
+                continue;
+            if(o == chrono_date::month_overflow::clamp)
+                ymd = ym / last;
+        }
+        if(sys_days{ymd} > until)
+            break;
+        v.push_back(sys_days{ymd});
+    }
+    return v;
+}
+
+static std::vector<sys_days> weekdays_by_hand(year_month_weekday first, sys_days until, int n,
+                                              chrono_date::month_overflow o)
+{
+    std::vector<sys_days> v;
+    for(auto ym = first.year() / first.month(); sys_days{ym / 1} <= until; ym += months{n})
+    {
+        const auto ymwd = ym / first.weekday_indexed();
+        auto d = sys_days{ymwd};
+        if(!ymwd.ok())
+        {
+            if(o == chrono_date::month_overflow::skip)
+                continue;
+            if(o == chrono_date::month_overflow::clamp)
+                d -= weeks{1};
+        }
+        if(d > until)
+            break;
+        v.push_back(d);
+    }
+    return v;
+}
+
+static std::vector<sys_days> collect(const chrono_date::recurrence& r)
+{
+    return std::vector<sys_days>(r.begin(), r.end());
+}
+
+TEST_CASE("recurrence rules")
+{
+    using chrono_date::month_overflow;
+    using chrono_date::recurrence;
+    const auto until = sys_days{2031_y / jan / 10};
+    const month_overflow overflows[] = {month_overflow::clamp, month_overflow::carry, month_overflow::skip};
+
+    SECTION("every n days and weeks")
+    {
+        const auto r = recurrence::weeks(sys_days{2016_y / jan / 1}, sys_days{2016_y / feb / 1}, 2);
+        CHECK(collect(r) == (std::vector<sys_days>{2016_y / jan / 1, 2016_y / jan / 15, 2016_y / jan / 29}));
+        CHECK(collect(recurrence::days(sys_days{2016_y / jan / 2}, sys_days{2016_y / jan / 1})).empty());
+        CHECK(collect(recurrence::days(sys_days{2016_y / jan / 1}, sys_days{2016_y / jan / 1})).size() == 1);
+    }
+    SECTION("the adding months table")
+    {
+        const auto first = 2000_y / jan / 30;
+        const auto april = sys_days{2000_y / apr / 15};
+        CHECK(collect(recurrence::months(first, april, 1, month_overflow::clamp)) ==
+              (std::vector<sys_days>{2000_y / jan / 30, 2000_y / feb / 29, 2000_y / mar / 30}));
+        CHECK(collect(recurrence::months(first, april, 1, month_overflow::carry)) ==
+              (std::vector<sys_days>{2000_y / jan / 30, 2000_y / mar / 1, 2000_y / mar / 30}));
+        CHECK(collect(recurrence::months(first, april, 1, month_overflow::skip)) ==
+              (std::vector<sys_days>{2000_y / jan / 30, 2000_y / mar / 30}));
+    }
+    SECTION("days of the month like by hand")
+    {
+        std::size_t wrong = 0;
+        for(const auto o : overflows)
+            for(unsigned d = 1; d <= 31; ++d)
+                for(int n : {1, 2, 3, 5, 12, 13, 25})
+                {
+                    const auto first = 1999_y / nov / day{d};
+                    wrong += collect(recurrence::months(first, until, static_cast<unsigned>(n), o)) !=
+                             months_by_hand(first, until, n, o);
+                }
+        CHECK(wrong == 0);
+        CHECK(collect(recurrence::years(2000_y / feb / 29, sys_days{2009_y / jan / 1}, 1, month_overflow::skip)) ==
+              (std::vector<sys_days>{2000_y / feb / 29, 2004_y / feb / 29, 2008_y / feb / 29}));
+        CHECK(collect(recurrence::years(2000_y / feb / 29, sys_days{2002_y / jan / 1}, 1, month_overflow::carry)) ==
+              (std::vector<sys_days>{2000_y / feb / 29, 2001_y / mar / 1}));
+    }
+    SECTION("last days and weekdays like by hand")
+    {
+        std::size_t wrong = 0;
+        for(int n : {1, 2, 7, 12, 24})
+        {
+            std::vector<sys_days> by_hand;
+            for(auto ym = 1999_y / dec; sys_days{ym / last} <= until; ym += months{n})
+                by_hand.push_back(sys_days{ym / last});
+            wrong += collect(recurrence::months(1999_y / dec / last, until, static_cast<unsigned>(n))) != by_hand;
+
+            for(const auto wd : {sun, mon, tue, wed, thu, fri, sat})
+            {
+                by_hand.clear();
+                for(auto ym = 1999_y / dec; sys_days{ym / wd[last]} <= until; ym += months{n})
+                    by_hand.push_back(sys_days{ym / wd[last]});
+                wrong += collect(recurrence::months(1999_y / dec / wd[last], until, static_cast<unsigned>(n))) != by_hand;
+
+                for(const auto o : overflows)
+                    for(unsigned index = 1; index <= 5; ++index)
+                    {
+                        const auto first = 1999_y / dec / wd[index];
+                        wrong += collect(recurrence::months(first, until, static_cast<unsigned>(n), o)) !=
+                                 weekdays_by_hand(first, until, n, o);
+                    }
+            }
+        }
+        CHECK(wrong == 0);
+    }
+    SECTION("fill in pieces")
+    {
+        const recurrence rules[] = {
+            recurrence::days(sys_days{2000_y / jan / 1}, until, 3),
+            recurrence::months(2000_y / jan / 31, until, 1, month_overflow::skip),
+            recurrence::months(2000_y / jan / fri[last], until)};
+        for(const auto& r : rules)
+        {
+            std::vector<sys_days> filled(4000);
+            auto i = r.begin();
+            std::size_t size = 0;
+            for(std::size_t n; (n = i.fill(filled.data() + size, 7)) != 0;)
+                size += n;
+            filled.resize(size);
+            CHECK(filled == collect(r));
+            CHECK(i == r.end());
+            CHECK(r.fill(filled.data(), 5) == 5);
+        }
+    }
+}
+
+TEST_CASE("library metrics")
+{
+    using chrono_date::metric_counter;
+    const auto& registry = chrono_date::get_zone_registry();
+    const auto berlin = locate_zone("Europe/Berlin");
+    const auto before = chrono_date::get_metrics_snapshot();
+
+    registry.find("Europe/Berlin");
+    registry.find("Europe/Berlinn");
+    std::thread{[&] { registry.find("Asia/Tehran"); }}.join();
+
+    const local_seconds in[] = {
+        local_days{2016_y / jan / 10} + 12h,
+        local_days{2016_y / jan / 11} + 12h,
+        local_days{2016_y / mar / 27} + 2h + 30min,
+        local_days{2016_y / oct / 30} + 2h + 30min};
+    sys_seconds out[4];
+    chrono_date::bulk_to_sys(berlin, in, 4, out, choose::earliest);
+    CHECK_THROWS_AS(chrono_date::make_zoned(chrono_date::intern_zone("Europe/Berlin"), in[2]), nonexistent_local_time);
+    chrono_date::make_zoned(chrono_date::intern_zone("Europe/Berlin"), sys_days{2016_y / jan / 10});
+    chrono_date::static_zones::europe_berlin.get_info(sys_days{2016_y / jan / 10});
+
+    const auto after = chrono_date::get_metrics_snapshot();
+    const auto delta = [&](metric_counter c) { return after[c] - before[c]; };
+    if(chrono_date::metrics_enabled)
+    {
+        CHECK(delta(metric_counter::zone_lookups) >= 3);
+        CHECK(delta(metric_counter::zone_lookup_failures) == 1);
+        CHECK(delta(metric_counter::local_to_sys_hits) == 1);
+        CHECK(delta(metric_counter::local_to_sys_searches) == 3);
+        CHECK(delta(metric_counter::nonexistent_local_times) == 1);
+        CHECK(delta(metric_counter::ambiguous_local_times) == 1);
+        CHECK(delta(metric_counter::local_time_exceptions) == 1);
+        CHECK(delta(metric_counter::zoned_times) == 2);
+        CHECK(delta(metric_counter::zone_info_lookups) >= 1);
+        // once per process, the registry was used before the snapshot
+        CHECK(after[chrono_date::metric_histogram::tzdb_load].count == 1);
+        CHECK(after[chrono_date::metric_histogram::zone_registry_build].count >= 1);
+    }
+    else
+    {
+        std::uint64_t total = 0;
+        for(const auto c : after.counters)
+            total += c;
+        CHECK(total == 0);
+    }
+
+    const auto text = chrono_date::to_string(after);
+    CHECK(text.find("zone_lookups " + std::to_string(after[metric_counter::zone_lookups]) + "\n") != std::string::npos);
+    const auto json = chrono_date::to_json(after);
+    CHECK(json.find("\"zone_lookup_failures\": " + std::to_string(after[metric_counter::zone_lookup_failures])) !=
+          std::string::npos);
+    CHECK(json.find("\"tzdb_image_zone_load_ns\": {\"count\": ") != std::string::npos);
+    CHECK(json.find("\"tzdb_load_ns\": {\"count\": ") != std::string::npos);
+    CHECK(std::string{chrono_date::to_string(metric_counter::tzdb_publishes)} == "tzdb_publishes");
+}
+
+static sys_days add_business_days_by_hand(const chrono_date::business_calendar& c, sys_days d, int n)
+{
+    for(; n > 0; --n)
+        do
+            d += days{1};
+        while(!c.is_business_day(d));
+    for(; n < 0; ++n)
+        do
+            d -= days{1};
+        while(!c.is_business_day(d));
+    return d;
+}
+
+TEST_CASE("business day calendar")
+{
+    const auto first = sys_days{2019_y / dec / 1};
+    const auto until = sys_days{2021_y / feb / 1};
+    const std::vector<sys_days> holidays = {
+        sys_days{2019_y / dec / 25}, sys_days{2019_y / dec / 26}, sys_days{2020_y / jan / 1},
+        sys_days{2020_y / apr / 10}, sys_days{2020_y / apr / 13}, sys_days{2020_y / dec / 25},
+        sys_days{2021_y / jan / 1}, sys_days{2021_y / mar / 1}};
+    const chrono_date::business_calendar c{first, until, holidays};
+    CHECK(c.first() == first);
+    CHECK(c.last() == until);
+
+    std::int64_t before = 0;
+    for(auto d = first; d < until; d += days{1})
+    {
+        const auto wd = weekday{d};
+        const bool business = wd != sat && wd != sun && std::find(holidays.begin(), holidays.end(), d) == holidays.end();
+        CHECK(c.is_business_day(d) == business);
+        CHECK(c.count(first, d) == before);
+        CHECK(c.count(d, until) == c.count(first, until) - before);
+        before += business;
+    }
+    CHECK(c.count(first, until) == before);
+    CHECK(c.count(until, first) == -before);
+
+    CHECK(c.add(sys_days{2019_y / dec / 24}, 1) == sys_days{2019_y / dec / 27});
+    CHECK(c.add(sys_days{2019_y / dec / 28}, 1) == sys_days{2019_y / dec / 30});
+    CHECK(c.add(sys_days{2020_y / apr / 14}, -1) == sys_days{2020_y / apr / 9});
+    CHECK(c.add(sys_days{2020_y / apr / 11}, 0) == sys_days{2020_y / apr / 11});
+    CHECK(c.next_or_same(sys_days{2020_y / apr / 10}) == sys_days{2020_y / apr / 14});
+    CHECK(c.next_or_same(sys_days{2020_y / apr / 14}) == sys_days{2020_y / apr / 14});
+    CHECK(c.previous_or_same(sys_days{2020_y / apr / 13}) == sys_days{2020_y / apr / 9});
+    for(auto d = first + days{10}; d < until - days{40}; d += days{3})
+        for(const auto n : {1, 2, 5, 19, -1, -7})
+            CHECK(c.add(d, n) == add_business_days_by_hand(c, d, n));
+    CHECK(c.add(first, 250) == add_business_days_by_hand(c, first, 250));
+    CHECK(c.add(until - days{1}, -250) == add_business_days_by_hand(c, until - days{1}, -250));
+    CHECK(c.add(until, -1) == sys_days{2021_y / jan / 29});
+
+    CHECK_THROWS_AS(c.is_business_day(until), std::runtime_error);
+    CHECK_THROWS_AS(c.count(first - days{1}, until), std::runtime_error);
+    CHECK_THROWS_AS(c.add(sys_days{2021_y / jan / 29}, 1), std::runtime_error);
+    CHECK_THROWS_AS(c.add(first, -1), std::runtime_error);
+
+    const auto path = std::string{"chrono_date_playground.calendar"};
+    {
+        std::ofstream out(path);
+        out << "# a six day week\n"
+               "range 2020-01-01 2020-02-01\n"
+               "weekend Sun\n"
+               "2020-01-01 new year\n"
+               "\n"
+               "2020-01-06   # epiphany\n";
+    }
+    const chrono_date::business_calendar loaded{path};
+    CHECK(loaded.first() == sys_days{2020_y / jan / 1});
+    CHECK(loaded.last() == sys_days{2020_y / feb / 1});
+    CHECK(loaded.is_business_day(sys_days{2020_y / jan / 4}));
+    CHECK(!loaded.is_business_day(sys_days{2020_y / jan / 5}));
+    CHECK(!loaded.is_business_day(sys_days{2020_y / jan / 6}));
+    CHECK(loaded.count(loaded.first(), loaded.last()) == 31 - 4 - 2);
+    {
+        std::ofstream out(path);
+        out << "range 2020-01-01 2020-02-01\n"
+               "2020-13-01\n";
+    }
+    CHECK_THROWS_AS(chrono_date::business_calendar{path}, std::runtime_error);
+    std::remove(path.c_str());
+    CHECK_THROWS_AS(chrono_date::business_calendar{path}, std::runtime_error);
+}
+
+// days from the anniversary of from after whole months, its day clamped
+// to the end of the month
+static days days_since_anniversary(const year_month_day& to, const year_month_day& from, months whole)
+{
+    const auto ym = from.year() / from.month() + whole;
+    const auto last_day = (ym / last).day();
+    return sys_days{to} - sys_days{ym / (from.day() < last_day ? from.day() : last_day)};
+}
+
+TEST_CASE("calendar differences")
+{
+    std::mt19937_64 gen{20150820};
+    std::uniform_int_distribution<int> dist{-200 * 366, 200 * 366};
+    std::vector<year_month_day> from;
+    std::vector<year_month_day> to;
+    const auto push = [&](year_month_day f, year_month_day t)
+    {
+        from.push_back(f);
+        to.push_back(t);
+    };
+    push(2010_y / aug / 21, 2015_y / aug / 20);
+    push(2010_y / aug / 21, 2015_y / aug / 21);
+    push(2000_y / feb / 29, 2001_y / feb / 28);
+    push(2000_y / feb / 29, 2001_y / mar / 1);
+    push(2000_y / feb / 29, 2004_y / feb / 29);
+    push(2000_y / jan / 31, 2000_y / mar / 1);
+    push(2015_y / aug / 20, 2010_y / aug / 21);
+    push(year::min() / jan / 1, year::max() / dec / 31);
+    push(year::max() / dec / 31, year::min() / jan / 1);
+    for(int i = 0; i < 3000; ++i)
+    {
+        const auto f = sys_days{2000_y / jan / 1} + days{dist(gen)};
+        push(year_month_day{f}, year_month_day{f + days{dist(gen)}});
+        // leap day birthdays
+        const auto leap = year{1600 + 4 * (i % 200)} / feb / 29;
+        push(leap.ok() ? leap : year_month_day{f}, year_month_day{f});
+    }
+    const auto n = from.size();
+    std::vector<std::int16_t> fy, ty;
+    std::vector<std::uint8_t> fm, fd, tm, td;
+    for(std::size_t i = 0; i < n; ++i)
+    {
+        fy.push_back(static_cast<std::int16_t>(static_cast<int>(from[i].year())));
+        fm.push_back(static_cast<std::uint8_t>(static_cast<unsigned>(from[i].month())));
+        fd.push_back(static_cast<std::uint8_t>(static_cast<unsigned>(from[i].day())));
+        ty.push_back(static_cast<std::int16_t>(static_cast<int>(to[i].year())));
+        tm.push_back(static_cast<std::uint8_t>(static_cast<unsigned>(to[i].month())));
+        td.push_back(static_cast<std::uint8_t>(static_cast<unsigned>(to[i].day())));
+    }
+    const chrono_date::const_ymd_columns f{fy.data(), fm.data(), fd.data()};
+    const chrono_date::const_ymd_columns t{ty.data(), tm.data(), td.data()};
+
+    for(const auto isa : {chrono_date::simd_isa::generic,
+                          chrono_date::simd_isa::sse4_1,
+                          chrono_date::simd_isa::avx2,
+                          chrono_date::simd_isa::avx512})
+    {
+        if(!chrono_date::is_supported(isa))
+            continue;
+        INFO(chrono_date::to_string(isa));
+        std::vector<std::int32_t> y(n, -1), m(n, -1), d(n, -1);
+
+        std::size_t wrong = 0;
+        chrono_date::calendar_difference(isa, f, t, n, chrono_date::difference_unit::years, {y.data(), m.data(), d.data()});
+        for(std::size_t i = 0; i < n; ++i)
+        {
+            const auto age = calc_age<years>(to[i], from[i]);
+            wrong += y[i] != age.count() || m[i] != -1 || d[i] != days_since_anniversary(to[i], from[i], age).count();
+        }
+        CHECK(wrong == 0);
+
+        wrong = 0;
+        std::fill(y.begin(), y.end(), -1);
+        chrono_date::calendar_difference(isa, f, t, n, chrono_date::difference_unit::months, {y.data(), m.data(), d.data()});
+        for(std::size_t i = 0; i < n; ++i)
+        {
+            const auto age = calc_age<months>(to[i], from[i]);
+            wrong += y[i] != -1 || m[i] != age.count() || d[i] != days_since_anniversary(to[i], from[i], age).count();
+        }
+        CHECK(wrong == 0);
+
+        wrong = 0;
+        chrono_date::calendar_difference(isa, f, t, n, chrono_date::difference_unit::years_months, {y.data(), m.data(), nullptr});
+        for(std::size_t i = 0; i < n; ++i)
+        {
+            const auto age = calc_age<months>(to[i], from[i]);
+            wrong += y[i] != calc_age<years>(to[i], from[i]).count() || m[i] != age.count() - 12 * y[i] || m[i] < 0 ||
+                     m[i] > 11;
+        }
+        CHECK(wrong == 0);
+    }
+
+    std::int32_t y, m, d;
+    chrono_date::calendar_difference(f, t, 1, chrono_date::difference_unit::years_months, {&y, &m, &d});
+    CHECK(y == 4);
+    CHECK(m == 11);
+    CHECK(d == 30);
+
+    SECTION("parallel")
+    {
+        const std::size_t big = (1 << 18) + 5;
+        std::vector<std::int16_t> by(big), bty(big);
+        std::vector<std::uint8_t> bm(big), bd(big), btm(big), btd(big);
+        for(std::size_t i = 0; i < big; ++i)
+        {
+            by[i] = fy[i % n];
+            bm[i] = fm[i % n];
+            bd[i] = fd[i % n];
+            bty[i] = ty[i % n];
+            btm[i] = tm[i % n];
+            btd[i] = td[i % n];
+        }
+        const chrono_date::const_ymd_columns bf{by.data(), bm.data(), bd.data()};
+        const chrono_date::const_ymd_columns bt{bty.data(), btm.data(), btd.data()};
+        std::vector<std::int32_t> sequential(big), parallel(big), days_left(big);
+        chrono_date::calendar_difference(bf, bt, big, chrono_date::difference_unit::months,
+                                         {nullptr, sequential.data(), nullptr});
+        for(const unsigned threads : {3u, 0u})
+        {
+            std::fill(parallel.begin(), parallel.end(), 0);
+            chrono_date::parallel_calendar_difference(bf, bt, big, chrono_date::difference_unit::months,
+                                                      {nullptr, parallel.data(), days_left.data()}, threads);
+            CHECK(parallel == sequential);
+            CHECK(days_left[big - 1] == days_since_anniversary(to[(big - 1) % n], from[(big - 1) % n],
+                                                               months{sequential[big - 1]}).count());
+        }
+    }
+    SECTION("parallel parts of whole blocks")
+    {
+        // n / threads is a multiple of the block, the remainder goes to
+        // the last part
+        const std::size_t big = 3 * (1 << 16) + 2;
+        std::vector<std::int16_t> by(big, 2000), bty(big, 2020);
+        std::vector<std::uint8_t> bm(big, 2), bd(big, 29), btm(big, 2), btd(big, 28);
+        std::vector<std::int32_t> y(big, -1);
+        chrono_date::parallel_calendar_difference({by.data(), bm.data(), bd.data()}, {bty.data(), btm.data(), btd.data()},
+                                                  big, chrono_date::difference_unit::years, {y.data(), nullptr, nullptr}, 3);
+        CHECK(std::count(y.begin(), y.end(), 19) == static_cast<std::ptrdiff_t>(big));
+    }
+}
+
+TEST_CASE("zone registry after a tzdb reload")
+{
+    const auto& before = chrono_date::get_zone_registry();
+    CHECK(&before.tzdb() == &get_tzdb());
+    CHECK(chrono_date::intern_zone("Europe/Berlin").get() == locate_zone("Europe/Berlin"));
+    const auto tehran = chrono_date::intern_zone("Asia/Tehran");
+    const chrono_date::packed_zoned_time<> stored{tehran, sys_days{2016_y / jul / 4} + 12h};
+
+    const auto& db = reload_tzdb();
+    const auto& after = chrono_date::get_zone_registry();
+    CHECK(&after.tzdb() == &db);
+    CHECK(&chrono_date::get_zone_registry() == &after);
+    CHECK(chrono_date::intern_zone("Europe/Berlin").get() == db.locate_zone("Europe/Berlin"));
+    CHECK(after.intern(db.locate_zone("Asia/Tehran")).get() == db.locate_zone("Asia/Tehran"));
+    if(&db != &before.tzdb())
+    {
+        // the old registry stays valid for the old database
+        CHECK(&before.tzdb() != &db);
+        CHECK(!after.intern(before.tzdb().locate_zone("Asia/Tehran")));
+        CHECK(before.zone(before.find("Asia/Tehran")) == before.tzdb().locate_zone("Asia/Tehran"));
+    }
+
+    // ids stay those of the zone names, whatever the new database
+    // added or removed in front of them
+    CHECK(tehran.get() == db.locate_zone("Asia/Tehran"));
+    CHECK(stored.get_time_zone()->name() == "Asia/Tehran");
+    std::size_t moved = 0;
+    for(const auto& tz : db.zones)
+    {
+        const auto old_id = before.find(tz.name());
+        moved += old_id && after.find(tz.name()) != old_id;
+    }
+    CHECK(moved == 0);
+    const chrono_date::zone_registry again{db, &after};
+    CHECK(again.size() == after.size());
+    CHECK(again.find("Asia/Tehran") == tehran);
+
+    const auto zt = make_zoned(db.locate_zone("America/New_York"), sys_days{2016_y / jul / 4} + 12h);
+    const chrono_date::packed_zoned_time<> packed{zt};
+    CHECK(packed.get_time_zone() == zt.get_time_zone());
+    CHECK(packed.get_local_time() == zt.get_local_time());
+}
+
+// "YYYY-MM-DD hh:mm:ss"
+static std::string timestamp_text(sys_seconds t)
+{
+    char buffer[32];
+    const auto r = chrono_date::to_chars(buffer, buffer + sizeof buffer, t);
+    return std::string(buffer, r.ptr);
+}
+
+// the log rewritten by rezone_log_chunk in one piece
+static std::string rezone_text(const chrono_date::log_converter& c, std::string log)
+{
+    chrono_date::rezone_log_chunk(c, chrono_date::detect_simd_isa(), &log[0], &log[0] + log.size());
+    return log;
+}
+
+TEST_CASE("log re-zoning")
+{
+    const auto first = sys_days{1970_y / jan / 1};
+    const auto last = sys_days{2100_y / jan / 1};
+    const chrono_date::log_converter to_berlin{locate_zone("UTC"), locate_zone("Europe/Berlin"), first, last};
+
+    SECTION("timestamps at the begin of lines")
+    {
+        CHECK(rezone_text(to_berlin, "2016-07-04 12:00:00 up\n") == "2016-07-04 14:00:00 up\n");
+        CHECK(rezone_text(to_berlin, "2016-01-31T23:30:00 T stays\n") == "2016-02-01T00:30:00 T stays\n");
+        CHECK(rezone_text(to_berlin, "2016-07-04 12:00:00.123456 fraction\n") == "2016-07-04 14:00:00.123456 fraction\n");
+        CHECK(rezone_text(to_berlin, "2016-07-04 12:00:00") == "2016-07-04 14:00:00");
+    }
+    SECTION("lines without timestamp")
+    {
+        const std::string log = "no time\n\n2016-07-04 12:00\n 2016-07-04 12:00:00\n2016-13-04 12:00:00\n";
+        CHECK(rezone_text(to_berlin, log) == log);
+
+        std::string mixed = "start\n2016-07-04 12:00:00 a\nmiddle\n2016-12-04 12:00:00 b";
+        const auto counts = chrono_date::rezone_log_chunk(to_berlin, chrono_date::detect_simd_isa(),
+                                                          &mixed[0], &mixed[0] + mixed.size());
+        CHECK(mixed == "start\n2016-07-04 14:00:00 a\nmiddle\n2016-12-04 13:00:00 b");
+        CHECK(counts.lines == 4);
+        CHECK(counts.converted == 2);
+    }
+    SECTION("nonexistent and ambiguous local times like choose::earliest")
+    {
+        const auto berlin = locate_zone("Europe/Berlin");
+        const chrono_date::log_converter to_utc{berlin, locate_zone("UTC"), first, last};
+        const auto expected = [&](local_seconds lt)
+        {
+            return timestamp_text(berlin->to_sys(lt, choose::earliest)) + " x\n";
+        };
+        CHECK(rezone_text(to_utc, "2016-03-27 02:30:00 x\n") == expected(local_days{2016_y / mar / 27} + 2h + 30min));
+        CHECK(rezone_text(to_utc, "2016-10-30 02:30:00 x\n") == expected(local_days{2016_y / oct / 30} + 2h + 30min));
+        CHECK(rezone_text(to_utc, "2016-10-30 02:30:00 x\n") == "2016-10-30 00:30:00 x\n");
+    }
+    SECTION("years outside of 0 to 9999 are left as they are")
+    {
+        const chrono_date::log_converter to_tokyo{locate_zone("UTC"), locate_zone("Asia/Tokyo"), first, last};
+        CHECK(rezone_text(to_tokyo, "9999-12-31 23:30:00 end\n") == "9999-12-31 23:30:00 end\n");
+        const chrono_date::log_converter to_new_york{locate_zone("UTC"), locate_zone("America/New_York"), first, last};
+        CHECK(rezone_text(to_new_york, "0000-01-01 01:00:00 begin\n") == "0000-01-01 01:00:00 begin\n");
+    }
+    SECTION("chunks end at line ends")
+    {
+        std::string log;
+        std::mt19937_64 gen{2016};
+        for(int i = 0; i < 2000; ++i)
+        {
+            const auto t = sys_seconds{sys_days{2016_y / jan / 1}} + seconds{gen() % (366 * 86400)};
+            log += timestamp_text(t) + std::string(gen() % 40, 'x') + '\n';
+        }
+        log += "2016-07-04 12:00:00 last line";
+
+        const auto cuts = chrono_date::cut_log_chunks(log.data(), log.size(), 37, 64);
+        REQUIRE(cuts.size() > 2);
+        CHECK(cuts.front() == 0);
+        CHECK(cuts.back() == log.size());
+        std::size_t wrong = 0;
+        for(std::size_t i = 1; i + 1 < cuts.size(); ++i)
+            wrong += cuts[i] <= cuts[i - 1] || log[cuts[i] - 1] != '\n';
+        CHECK(wrong == 0);
+
+        std::string out(log.size(), '\0');
+        const auto counts = chrono_date::rezone_log(to_berlin, log.data(), &out[0], log.size(), 3);
+        CHECK(out == rezone_text(to_berlin, log));
+        CHECK(counts.lines == 2001);
+        CHECK(counts.converted == 2001);
+    }
+}
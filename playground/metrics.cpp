@@ -0,0 +1,155 @@
+#include "metrics.h"
+#include <sstream>
+
+namespace chrono_date
+{
+
+namespace detail
+{
+
+namespace
+{
+
+std::atomic<metric_block*> metric_blocks{nullptr};
+
+struct metric_block_owner
+{
+    metric_block* block = nullptr;
+
+    ~metric_block_owner()
+    {
+        if(block != nullptr)
+            block->in_use.store(false, std::memory_order_release);
+    }
+};
+
+thread_local metric_block_owner owner;
+
+}
+
+metric_block& register_metric_block()
+{
+    if(owner.block != nullptr)
+        return *owner.block;
+    for(auto b = metric_blocks.load(std::memory_order_acquire); b != nullptr; b = b->next)
+    {
+        bool used = false;
+        if(!b->in_use.load(std::memory_order_relaxed) && b->in_use.compare_exchange_strong(used, true, std::memory_order_acquire))
+        {
+            owner.block = b;
+            return *b;
+        }
+    }
+    auto b = new metric_block;
+    b->in_use.store(true, std::memory_order_relaxed);
+    b->next = metric_blocks.load(std::memory_order_relaxed);
+    while(!metric_blocks.compare_exchange_weak(b->next, b, std::memory_order_release, std::memory_order_relaxed))
+    {
+    }
+    owner.block = b;
+    return *b;
+}
+
+}
+
+namespace
+{
+
+const char* const counter_names[] = {
+    "zone_lookups",
+    "zone_lookup_failures",
+    "intern_cache_hits",
+    "intern_cache_misses",
+    "local_to_sys_hits",
+    "local_to_sys_searches",
+    "zone_pair_fallbacks",
+    "nonexistent_local_times",
+    "ambiguous_local_times",
+    "local_time_exceptions",
+    "zone_info_lookups",
+    "zoned_times",
+    "tzdb_image_zone_loads",
+    "tzdb_publishes",
+    "current_zone_hits",
+    "current_zone_resolutions"};
+
+const char* const histogram_names[] = {
+    "tzdb_load_ns",
+    "zone_registry_build_ns",
+    "tzdb_image_open_ns",
+    "tzdb_image_write_ns",
+    "tzdb_image_zone_load_ns"};
+
+static_assert(sizeof counter_names / sizeof counter_names[0] == metric_counter_count, "a name for every counter");
+static_assert(sizeof histogram_names / sizeof histogram_names[0] == metric_histogram_count, "a name for every histogram");
+
+}
+
+metrics_snapshot get_metrics_snapshot()
+{
+    metrics_snapshot s{};
+    for(auto b = detail::metric_blocks.load(std::memory_order_acquire); b != nullptr; b = b->next)
+    {
+        for(std::size_t c = 0; c < metric_counter_count; ++c)
+            s.counters[c] += b->counters[c].load(std::memory_order_relaxed);
+        for(std::size_t h = 0; h < metric_histogram_count; ++h)
+        {
+            const auto& from = b->histograms[h];
+            auto& to = s.histograms[h];
+            to.count += from.count.load(std::memory_order_relaxed);
+            to.sum += from.sum.load(std::memory_order_relaxed);
+            for(std::size_t i = 0; i < metric_buckets; ++i)
+                to.buckets[i] += from.buckets[i].load(std::memory_order_relaxed);
+        }
+    }
+    return s;
+}
+
+const char* to_string(metric_counter c) noexcept
+{
+    return c < metric_counter::count ? counter_names[static_cast<std::size_t>(c)] : "unknown";
+}
+
+const char* to_string(metric_histogram h) noexcept
+{
+    return h < metric_histogram::count ? histogram_names[static_cast<std::size_t>(h)] : "unknown";
+}
+
+std::string to_string(const metrics_snapshot& s)
+{
+    std::ostringstream os;
+    for(std::size_t c = 0; c < metric_counter_count; ++c)
+        os << counter_names[c] << ' ' << s.counters[c] << '\n';
+    for(std::size_t h = 0; h < metric_histogram_count; ++h)
+    {
+        const auto& hist = s.histograms[h];
+        os << histogram_names[h] << ' ' << hist.count << ' ' << hist.sum << ' '
+           << (hist.count != 0 ? hist.sum / hist.count : 0) << '\n';
+    }
+    return os.str();
+}
+
+std::string to_json(const metrics_snapshot& s)
+{
+    std::ostringstream os;
+    os << "{\"counters\": {";
+    for(std::size_t c = 0; c < metric_counter_count; ++c)
+        os << (c != 0 ? ", " : "") << '"' << counter_names[c] << "\": " << s.counters[c];
+    os << "}, \"histograms\": {";
+    for(std::size_t h = 0; h < metric_histogram_count; ++h)
+    {
+        const auto& hist = s.histograms[h];
+        os << (h != 0 ? ", " : "") << '"' << histogram_names[h] << "\": {\"count\": " << hist.count
+           << ", \"sum\": " << hist.sum << ", \"buckets\": [";
+        auto used = metric_buckets;
+        while(used > 0 && hist.buckets[used - 1] == 0)
+            --used;
+        for(std::size_t i = 0; i < used; ++i)
+            os << (i != 0 ? ", " : "") << hist.buckets[i];
+        os << "]}";
+    }
+    os << "}}";
+    return os.str();
+}
+
+}
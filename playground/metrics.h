@@ -0,0 +1,230 @@
+#ifndef CHRONO_DATE_METRICS_H
+#define CHRONO_DATE_METRICS_H
+
+// Counters and histograms of what the library does.
+//
+// With CHRONO_DATE_METRICS defined to 1 (the CMake option of that name,
+// or define=CHRONO_DATE_METRICS=1 for b2) the name lookups, conversions,
+// nonexistent and ambiguous local times, cache hits and the time spent
+// loading the tzdb and tzdb images are counted. Every thread counts into a block of
+// its own, with plain relaxed loads and stores, so counting takes neither
+// a lock nor an atomic read-modify-write. get_metrics_snapshot adds up
+// the blocks of all threads, including those that exited.
+//
+// Without it, which is the default, count_metric, record_metric and
+// metric_timer are empty inline functions and the snapshot is all zero.
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#ifndef CHRONO_DATE_METRICS
+#define CHRONO_DATE_METRICS 0
+#endif
+
+namespace chrono_date
+{
+
+constexpr bool metrics_enabled = CHRONO_DATE_METRICS != 0;
+
+enum class metric_counter
+{
+    // names resolved by zone_registry, and those that are no zone
+    zone_lookups,
+    zone_lookup_failures,
+    // intern_zone calls answered by the per thread cache or not
+    intern_cache_hits,
+    intern_cache_misses,
+    // local_to_sys_cursor conversions within the cached interval, and
+    // those that called get_info
+    local_to_sys_hits,
+    local_to_sys_searches,
+    // zone_pair_converter conversions outside of its segments
+    zone_pair_fallbacks,
+    // reported by local_to_sys_cursor and zone_pair_converter
+    nonexistent_local_times,
+    ambiguous_local_times,
+    // nonexistent_local_time and ambiguous_local_time thrown by
+    // zone_pair_converter and make_zoned on a zone_handle
+    local_time_exceptions,
+    // get_info calls on the tables of compiled and static zones; their
+    // to_sys and to_local are not counted, they are constant expressions
+    zone_info_lookups,
+    // zoned_times made by make_zoned on a zone_handle
+    zoned_times,
+    // zones of tzdb_images compiled on first use
+    tzdb_image_zone_loads,
+    // databases published to an rcu_tzdb
+    tzdb_publishes,
+    // cached_current_zone calls that did or did not find the zone cached
+    current_zone_hits,
+    current_zone_resolutions,
+    count
+};
+
+// all in nanoseconds
+enum class metric_histogram
+{
+    // the first date::get_tzdb() of get_zone_registry, which parses the
+    // text database unless that was used before, and the registries built
+    // for every tzdb
+    tzdb_load,
+    zone_registry_build,
+    tzdb_image_open,
+    tzdb_image_write,
+    tzdb_image_zone_load,
+    count
+};
+
+constexpr std::size_t metric_counter_count = static_cast<std::size_t>(metric_counter::count);
+constexpr std::size_t metric_histogram_count = static_cast<std::size_t>(metric_histogram::count);
+
+// bucket b counts the values of b significant bits, [2^(b-1), 2^b)
+constexpr std::size_t metric_buckets = 65;
+
+struct metric_histogram_snapshot
+{
+    std::uint64_t count;
+    std::uint64_t sum;
+    std::array<std::uint64_t, metric_buckets> buckets;
+};
+
+struct metrics_snapshot
+{
+    std::array<std::uint64_t, metric_counter_count> counters;
+    std::array<metric_histogram_snapshot, metric_histogram_count> histograms;
+
+    std::uint64_t operator[](metric_counter c) const noexcept
+    {
+        return counters[static_cast<std::size_t>(c)];
+    }
+
+    const metric_histogram_snapshot& operator[](metric_histogram h) const noexcept
+    {
+        return histograms[static_cast<std::size_t>(h)];
+    }
+};
+
+namespace detail
+{
+
+struct metric_block_histogram
+{
+    std::atomic<std::uint64_t> count{0};
+    std::atomic<std::uint64_t> sum{0};
+    std::array<std::atomic<std::uint64_t>, metric_buckets> buckets{};
+};
+
+// the counts of one thread; blocks are never freed, the block of an
+// exited thread is taken over by the next new thread
+struct metric_block
+{
+    std::array<std::atomic<std::uint64_t>, metric_counter_count> counters{};
+    std::array<metric_block_histogram, metric_histogram_count> histograms;
+    std::atomic<bool> in_use{false};
+    metric_block* next = nullptr;
+};
+
+// block of the calling thread, released again when the thread exits
+metric_block& register_metric_block();
+
+inline metric_block& this_metric_block()
+{
+    static thread_local metric_block* block = nullptr;
+    if(block == nullptr)
+        block = &register_metric_block();
+    return *block;
+}
+
+// only the owning thread writes
+inline void bump(std::atomic<std::uint64_t>& a, std::uint64_t n) noexcept
+{
+    a.store(a.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+inline std::size_t metric_bucket(std::uint64_t v) noexcept
+{
+    std::size_t b = 0;
+    for(; v != 0; v >>= 1)
+        ++b;
+    return b;
+}
+
+}
+
+inline void count_metric(metric_counter c, std::uint64_t n = 1) noexcept
+{
+#if CHRONO_DATE_METRICS
+    detail::bump(detail::this_metric_block().counters[static_cast<std::size_t>(c)], n);
+#else
+    static_cast<void>(c);
+    static_cast<void>(n);
+#endif
+}
+
+inline void record_metric(metric_histogram h, std::uint64_t value) noexcept
+{
+#if CHRONO_DATE_METRICS
+    auto& hist = detail::this_metric_block().histograms[static_cast<std::size_t>(h)];
+    detail::bump(hist.count, 1);
+    detail::bump(hist.sum, value);
+    detail::bump(hist.buckets[detail::metric_bucket(value)], 1);
+#else
+    static_cast<void>(h);
+    static_cast<void>(value);
+#endif
+}
+
+// records the nanoseconds of its lifetime
+class metric_timer
+{
+public:
+    explicit metric_timer(metric_histogram h) noexcept
+#if CHRONO_DATE_METRICS
+        : histogram_{h}
+        , start_{std::chrono::steady_clock::now()}
+#endif
+    {
+        static_cast<void>(h);
+    }
+
+    metric_timer(const metric_timer&) = delete;
+    metric_timer& operator=(const metric_timer&) = delete;
+
+    ~metric_timer()
+    {
+#if CHRONO_DATE_METRICS
+        const auto elapsed = std::chrono::steady_clock::now() - start_;
+        record_metric(histogram_, static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+#endif
+    }
+
+private:
+#if CHRONO_DATE_METRICS
+    metric_histogram histogram_;
+    std::chrono::steady_clock::time_point start_;
+#endif
+};
+
+// the counts of all threads so far
+metrics_snapshot get_metrics_snapshot();
+
+const char* to_string(metric_counter c) noexcept;
+const char* to_string(metric_histogram h) noexcept;
+
+// one "name value" line per counter and one "name count sum mean" line
+// per histogram
+std::string to_string(const metrics_snapshot& s);
+
+// {"counters": {name: value, ...},
+//  "histograms": {name: {"count": n, "sum": n, "buckets": [...]}, ...}}
+// where buckets lists the counts up to the last non zero one
+std::string to_json(const metrics_snapshot& s);
+
+}
+
+#endif
@@ -0,0 +1,220 @@
+#ifndef CHRONO_DATE_PACKED_ZONED_TIME_H
+#define CHRONO_DATE_PACKED_ZONED_TIME_H
+
+// A zoned time in 64 bits.
+//
+// date::zoned_time is a time_zone pointer and a time point, 16 bytes.
+// packed_zoned_time keeps the interned id of the zone (see zone_registry)
+// in the low ZoneBits bits of a word and the ticks of the sys time, offset
+// to be unsigned, in the bits above. The default of 16 bits for the zone
+// leaves 48 for the time, which for seconds covers more than a million
+// years either side of the epoch and for milliseconds about 4400.
+//
+// Comparing the words orders by sys time first and by zone id second, so
+// comparisons and sorting never unpack anything. Two packed times are
+// equal if they are the same instant in the same zone.
+//
+// get_local_time and get_info look the zone up in get_zone_registry().
+// Zone ids stay the same across date::reload_tzdb(), so stored packed
+// times keep their zone. Like get_time_zone and to_zoned they throw
+// std::runtime_error for a default constructed packed time, which has no
+// zone, and for a zone a reload removed.
+
+#include "zone_registry.h"
+#include <date/date.h>
+#include <date/tz.h>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+
+namespace chrono_date
+{
+
+template<class Duration = std::chrono::seconds, unsigned ZoneBits = 16>
+class packed_zoned_time
+{
+public:
+    static_assert(std::is_integral<typename Duration::rep>::value && sizeof(typename Duration::rep) == 8,
+                  "packed_zoned_time needs a Duration of 64 bit integers");
+    static_assert(ZoneBits >= 1 && ZoneBits <= 16, "zone ids are at most 16 bits");
+
+    using duration = Duration;
+    using sys_time = date::sys_time<Duration>;
+
+    static constexpr unsigned zone_bits = ZoneBits;
+    static constexpr unsigned time_bits = 64 - ZoneBits;
+
+    // the epoch in an invalid zone; only the time and the comparisons
+    // work, everything that needs the zone throws
+    constexpr packed_zoned_time() noexcept
+        : raw_{bias << ZoneBits | zone_mask}
+    {
+    }
+
+    // throws std::runtime_error if zone is invalid, its id does not fit
+    // ZoneBits or tp is outside of [min_time(), max_time()]
+    packed_zoned_time(zone_handle zone, sys_time tp)
+        : raw_{pack(zone, tp)}
+    {
+    }
+
+    // the same for the zone of zt, which has to be one of get_tzdb()
+    explicit packed_zoned_time(const date::zoned_time<Duration>& zt)
+        : packed_zoned_time{intern(zt.get_time_zone()), zt.get_sys_time()}
+    {
+    }
+
+    // a packed time from raw(), unchecked
+    static constexpr packed_zoned_time from_raw(std::uint64_t raw) noexcept
+    {
+        return packed_zoned_time{raw, 0};
+    }
+
+    constexpr std::uint64_t raw() const noexcept
+    {
+        return raw_;
+    }
+
+    static constexpr sys_time min_time() noexcept
+    {
+        return sys_time{Duration{-static_cast<std::int64_t>(bias)}};
+    }
+
+    static constexpr sys_time max_time() noexcept
+    {
+        return sys_time{Duration{static_cast<std::int64_t>(bias - 1)}};
+    }
+
+    constexpr zone_handle zone() const noexcept
+    {
+        // all ones is the invalid id, also for fewer than 16 bits
+        return (raw_ & zone_mask) == zone_mask
+            ? zone_handle{}
+            : zone_handle{static_cast<std::uint16_t>(raw_ & zone_mask)};
+    }
+
+    const date::time_zone* get_time_zone() const
+    {
+        return zone().get();
+    }
+
+    constexpr sys_time get_sys_time() const noexcept
+    {
+        return sys_time{Duration{static_cast<std::int64_t>((raw_ >> ZoneBits) - bias)}};
+    }
+
+    date::local_time<Duration> get_local_time() const
+    {
+        return get_time_zone()->to_local(get_sys_time());
+    }
+
+    date::sys_info get_info() const
+    {
+        return get_time_zone()->get_info(get_sys_time());
+    }
+
+    date::zoned_time<Duration> to_zoned() const
+    {
+        return date::zoned_time<Duration>{get_time_zone(), get_sys_time()};
+    }
+
+    friend constexpr bool operator==(packed_zoned_time a, packed_zoned_time b) noexcept
+    {
+        return a.raw_ == b.raw_;
+    }
+
+    friend constexpr bool operator!=(packed_zoned_time a, packed_zoned_time b) noexcept
+    {
+        return a.raw_ != b.raw_;
+    }
+
+    friend constexpr bool operator<(packed_zoned_time a, packed_zoned_time b) noexcept
+    {
+        return a.raw_ < b.raw_;
+    }
+
+    friend constexpr bool operator>(packed_zoned_time a, packed_zoned_time b) noexcept
+    {
+        return a.raw_ > b.raw_;
+    }
+
+    friend constexpr bool operator<=(packed_zoned_time a, packed_zoned_time b) noexcept
+    {
+        return a.raw_ <= b.raw_;
+    }
+
+    friend constexpr bool operator>=(packed_zoned_time a, packed_zoned_time b) noexcept
+    {
+        return a.raw_ >= b.raw_;
+    }
+
+private:
+    static constexpr std::uint64_t zone_mask = (std::uint64_t{1} << ZoneBits) - 1;
+    static constexpr std::uint64_t bias = std::uint64_t{1} << (time_bits - 1);
+
+    constexpr packed_zoned_time(std::uint64_t raw, int) noexcept
+        : raw_{raw}
+    {
+    }
+
+    static zone_handle intern(const date::time_zone* zone)
+    {
+        const auto h = get_zone_registry().intern(zone);
+        if(!h)
+            throw std::runtime_error("time zone is not one of the current tzdb");
+        return h;
+    }
+
+    static std::uint64_t pack(zone_handle zone, sys_time tp)
+    {
+        if(!zone || zone.id() >= zone_mask)
+            throw std::runtime_error("time zone id does not fit a packed_zoned_time");
+        if(tp < min_time() || tp > max_time())
+            throw std::runtime_error("time point does not fit a packed_zoned_time");
+        const auto ticks = static_cast<std::int64_t>(tp.time_since_epoch().count());
+        return (static_cast<std::uint64_t>(ticks) + bias) << ZoneBits | zone.id();
+    }
+
+    std::uint64_t raw_;
+};
+
+template<class Duration, unsigned ZoneBits>
+constexpr unsigned packed_zoned_time<Duration, ZoneBits>::zone_bits;
+
+template<class Duration, unsigned ZoneBits>
+constexpr unsigned packed_zoned_time<Duration, ZoneBits>::time_bits;
+
+template<class Duration, unsigned ZoneBits>
+constexpr std::uint64_t packed_zoned_time<Duration, ZoneBits>::zone_mask;
+
+template<class Duration, unsigned ZoneBits>
+constexpr std::uint64_t packed_zoned_time<Duration, ZoneBits>::bias;
+
+// out[i] = packed_zoned_time<Duration, ZoneBits>{in[i]} for i in [0, n),
+// interning each run of the same zone once
+template<class Duration, unsigned ZoneBits>
+void pack_zoned_times(const date::zoned_time<Duration>* in, std::size_t n,
+                      packed_zoned_time<Duration, ZoneBits>* out)
+{
+    const auto& registry = get_zone_registry();
+    const date::time_zone* last = nullptr;
+    zone_handle zone;
+    for(std::size_t i = 0; i < n; ++i)
+    {
+        const auto tz = in[i].get_time_zone();
+        if(tz != last)
+        {
+            zone = registry.intern(tz);
+            if(!zone)
+                throw std::runtime_error("time zone is not one of the current tzdb");
+            last = tz;
+        }
+        out[i] = packed_zoned_time<Duration, ZoneBits>{zone, in[i].get_sys_time()};
+    }
+}
+
+}
+
+#endif
@@ -0,0 +1,390 @@
+#ifndef CHRONO_DATE_RECURRENCE_H
+#define CHRONO_DATE_RECURRENCE_H
+
+// Lazy ranges of the dates of recurrence rules.
+//
+// A recurrence is every n days or weeks from a date, or every n months or
+// years on a day of the month, the last day of the month, the nth weekday
+// or the last weekday of the month, up to and including a last date. Its
+// iterators compute one date at a time without allocating: they keep the
+// first day of the current month as sys_days and step it by the lengths
+// of the months, so no date is converted from or to year_month_day after
+// the first one. fill writes a run of dates into a buffer, for days and
+// weeks as a plain arithmetic sequence.
+//
+// Days of the month that do not exist in a month, like the 31st of April
+// or the fifth Friday of most months, are clamped to the last one that
+// does, carried over into the next month like sys_days{2000_y/feb/30}, or
+// skipped, depending on month_overflow.
+
+#include <date/date.h>
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+
+namespace chrono_date
+{
+
+enum class month_overflow
+{
+    clamp,
+    carry,
+    skip
+};
+
+namespace detail
+{
+
+enum class recurrence_kind : std::uint8_t
+{
+    days,
+    day_of_month,
+    last_day,
+    nth_weekday,
+    last_weekday
+};
+
+constexpr bool is_leap(int y) noexcept
+{
+    return y % 4 == 0 && (y % 100 != 0 || y % 400 == 0);
+}
+
+constexpr unsigned days_in_month(int y, unsigned m) noexcept
+{
+    // 31 for odd months up to july and even ones from august
+    return m != 2 ? 30 + ((m + (m >> 3)) & 1) : 28 + is_leap(y);
+}
+
+// 0 for sunday
+inline unsigned weekday_of(date::sys_days d) noexcept
+{
+    return static_cast<unsigned>((date::weekday{d} - date::sun).count());
+}
+
+}
+
+class recurrence
+{
+public:
+    class iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = date::sys_days;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const date::sys_days*;
+        using reference = const date::sys_days&;
+
+        // the end of every recurrence
+        iterator() = default;
+
+        reference operator*() const noexcept
+        {
+            return current_;
+        }
+
+        pointer operator->() const noexcept
+        {
+            return &current_;
+        }
+
+        iterator& operator++() noexcept
+        {
+            if(rule_.kind == detail::recurrence_kind::days)
+                step_days();
+            else
+            {
+                next_month();
+                settle();
+            }
+            return *this;
+        }
+
+        iterator operator++(int) noexcept
+        {
+            auto i = *this;
+            ++*this;
+            return i;
+        }
+
+        // writes the next at most n dates to out and steps past them,
+        // returns how many were written
+        std::size_t fill(date::sys_days* out, std::size_t n) noexcept
+        {
+            if(done_)
+                return 0;
+            if(rule_.kind == detail::recurrence_kind::days)
+            {
+                const auto step = static_cast<std::size_t>(rule_.step);
+                const auto left = static_cast<std::size_t>((rule_.last - current_).count()) / step + 1;
+                const auto count = std::min(n, left);
+                const auto first = current_.time_since_epoch().count();
+                for(std::size_t i = 0; i < count; ++i)
+                    out[i] = date::sys_days{date::days{first + static_cast<date::days::rep>(i * step)}};
+                current_ += date::days{static_cast<date::days::rep>(count * step)};
+                done_ = current_ > rule_.last;
+                return count;
+            }
+            switch(rule_.kind)
+            {
+            case detail::recurrence_kind::day_of_month: return fill_months<detail::recurrence_kind::day_of_month>(out, n);
+            case detail::recurrence_kind::nth_weekday:  return fill_months<detail::recurrence_kind::nth_weekday>(out, n);
+            case detail::recurrence_kind::last_weekday: return fill_months<detail::recurrence_kind::last_weekday>(out, n);
+            default:                                    return fill_months<detail::recurrence_kind::last_day>(out, n);
+            }
+        }
+
+        friend bool operator==(const iterator& a, const iterator& b) noexcept
+        {
+            return a.done_ == b.done_ && (a.done_ || a.current_ == b.current_);
+        }
+
+        friend bool operator!=(const iterator& a, const iterator& b) noexcept
+        {
+            return !(a == b);
+        }
+
+    private:
+        friend class recurrence;
+
+        struct rule
+        {
+            detail::recurrence_kind kind;
+            month_overflow overflow;
+            // days or months
+            unsigned step;
+            // day of the month or index of the weekday
+            unsigned day;
+            // 0 for sunday
+            unsigned weekday;
+            date::sys_days last;
+        };
+
+        explicit iterator(const recurrence& r) noexcept
+            : rule_(r.rule_)
+            , done_{false}
+        {
+            if(rule_.kind == detail::recurrence_kind::days)
+            {
+                current_ = r.first_;
+                done_ = current_ > rule_.last;
+                return;
+            }
+            year_ = static_cast<int>(r.year_);
+            month_ = static_cast<unsigned>(r.month_);
+            month_begin_ = date::sys_days{r.year_ / r.month_ / 1};
+            settle();
+        }
+
+        void step_days() noexcept
+        {
+            current_ += date::days{rule_.step};
+            done_ = current_ > rule_.last;
+        }
+
+        void next_month() noexcept
+        {
+            auto left = rule_.step;
+            for(; left >= 12; left -= 12)
+            {
+                // the february in the next 12 months
+                const auto length = 365u + detail::is_leap(month_ <= 2 ? year_ : year_ + 1);
+                month_begin_ += date::days{length};
+                ++year_;
+            }
+            for(; left > 0; --left)
+            {
+                const auto length = detail::days_in_month(year_, month_);
+                month_begin_ += date::days{length};
+                if(++month_ > 12)
+                {
+                    month_ = 1;
+                    ++year_;
+                }
+            }
+        }
+
+        // the rule is known in the loop, not looked up for every date,
+        // and the cursor is a local that the stores to out cannot alias
+        template<detail::recurrence_kind Kind>
+        std::size_t fill_months(date::sys_days* out, std::size_t n) noexcept
+        {
+            auto cursor = *this;
+            std::size_t i = 0;
+            for(; i < n && !cursor.done_; ++i)
+            {
+                out[i] = cursor.current_;
+                cursor.next_month();
+                cursor.template settle<Kind>();
+            }
+            *this = cursor;
+            return i;
+        }
+
+        void settle() noexcept
+        {
+            switch(rule_.kind)
+            {
+            case detail::recurrence_kind::day_of_month: return settle<detail::recurrence_kind::day_of_month>();
+            case detail::recurrence_kind::nth_weekday:  return settle<detail::recurrence_kind::nth_weekday>();
+            case detail::recurrence_kind::last_weekday: return settle<detail::recurrence_kind::last_weekday>();
+            default:                                    return settle<detail::recurrence_kind::last_day>();
+            }
+        }
+
+        // the occurrence in the current month or the next month that has
+        // one, or done
+        template<detail::recurrence_kind Kind>
+        void settle() noexcept
+        {
+            for(; month_begin_ <= rule_.last; next_month())
+            {
+                const auto length = detail::days_in_month(year_, month_);
+                unsigned offset;
+                switch(Kind)
+                {
+                case detail::recurrence_kind::day_of_month:
+                    offset = rule_.day - 1;
+                    if(rule_.day > length)
+                    {
+                        if(rule_.overflow == month_overflow::skip)
+                            continue;
+                        if(rule_.overflow == month_overflow::clamp)
+                            offset = length - 1;
+                    }
+                    break;
+                case detail::recurrence_kind::nth_weekday:
+                    offset = (rule_.weekday + 7 - detail::weekday_of(month_begin_)) % 7 + 7 * (rule_.day - 1);
+                    if(offset >= length)
+                    {
+                        if(rule_.overflow == month_overflow::skip)
+                            continue;
+                        if(rule_.overflow == month_overflow::clamp)
+                            offset -= 7;
+                    }
+                    break;
+                case detail::recurrence_kind::last_weekday:
+                    offset = length - 1 -
+                             (detail::weekday_of(month_begin_ + date::days{length - 1}) + 7 - rule_.weekday) % 7;
+                    break;
+                default:
+                    offset = length - 1;
+                    break;
+                }
+                current_ = month_begin_ + date::days{offset};
+                done_ = current_ > rule_.last;
+                return;
+            }
+            done_ = true;
+        }
+
+        rule rule_{};
+        date::sys_days current_{};
+        bool done_ = true;
+        int year_ = 0;
+        unsigned month_ = 1;
+        date::sys_days month_begin_{};
+    };
+
+    // every n days from first
+    static recurrence days(date::sys_days first, date::sys_days last, unsigned n = 1) noexcept
+    {
+        return recurrence{detail::recurrence_kind::days, month_overflow::clamp, n, 0, 0, first, last};
+    }
+
+    // every n weeks from first
+    static recurrence weeks(date::sys_days first, date::sys_days last, unsigned n = 1) noexcept
+    {
+        return recurrence{detail::recurrence_kind::days, month_overflow::clamp, 7 * n, 0, 0, first, last};
+    }
+
+    // every n months on the day of first, which does not have to exist
+    // in the month of first
+    static recurrence months(date::year_month_day first, date::sys_days last, unsigned n = 1,
+                             month_overflow overflow = month_overflow::clamp) noexcept
+    {
+        return recurrence{detail::recurrence_kind::day_of_month, overflow, n, static_cast<unsigned>(first.day()), 0,
+                          first.year(), first.month(), last};
+    }
+
+    // every n months on the last day
+    static recurrence months(date::year_month_day_last first, date::sys_days last, unsigned n = 1) noexcept
+    {
+        return recurrence{detail::recurrence_kind::last_day, month_overflow::clamp, n, 0, 0,
+                          first.year(), first.month(), last};
+    }
+
+    // every n months on the nth weekday of first
+    static recurrence months(date::year_month_weekday first, date::sys_days last, unsigned n = 1,
+                             month_overflow overflow = month_overflow::clamp) noexcept
+    {
+        return recurrence{detail::recurrence_kind::nth_weekday, overflow, n, first.index(),
+                          static_cast<unsigned>((first.weekday() - date::sun).count()),
+                          first.year(), first.month(), last};
+    }
+
+    // every n months on the last weekday of first
+    static recurrence months(date::year_month_weekday_last first, date::sys_days last, unsigned n = 1) noexcept
+    {
+        return recurrence{detail::recurrence_kind::last_weekday, month_overflow::clamp, n, 0,
+                          static_cast<unsigned>((first.weekday() - date::sun).count()),
+                          first.year(), first.month(), last};
+    }
+
+    // the same every n years
+    template<class YearMonthDay>
+    static recurrence years(YearMonthDay first, date::sys_days last, unsigned n = 1) noexcept
+    {
+        return months(first, last, 12 * n);
+    }
+
+    template<class YearMonthDay>
+    static recurrence years(YearMonthDay first, date::sys_days last, unsigned n, month_overflow overflow) noexcept
+    {
+        return months(first, last, 12 * n, overflow);
+    }
+
+    iterator begin() const noexcept
+    {
+        return iterator{*this};
+    }
+
+    iterator end() const noexcept
+    {
+        return iterator{};
+    }
+
+    // writes the first at most n dates to out, returns how many were
+    // written; iterator::fill continues from any date
+    std::size_t fill(date::sys_days* out, std::size_t n) const noexcept
+    {
+        return begin().fill(out, n);
+    }
+
+private:
+    recurrence(detail::recurrence_kind kind, month_overflow overflow, unsigned step, unsigned day, unsigned weekday,
+               date::sys_days first, date::sys_days last) noexcept
+        : rule_{kind, overflow, std::max(step, 1u), day, weekday, last}
+        , first_{first}
+    {
+    }
+
+    recurrence(detail::recurrence_kind kind, month_overflow overflow, unsigned step, unsigned day, unsigned weekday,
+               date::year y, date::month m, date::sys_days last) noexcept
+        : rule_{kind, overflow, std::max(step, 1u), day, weekday, last}
+        , year_{y}
+        , month_{m}
+    {
+    }
+
+    iterator::rule rule_;
+    date::sys_days first_{};
+    date::year year_{};
+    date::month month_{1};
+};
+
+}
+
+#endif
@@ -0,0 +1,101 @@
+#include "rezone_log.h"
+#include "timestamp_from_chars.h"
+#include "timestamp_to_chars.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <thread>
+
+namespace chrono_date
+{
+
+namespace
+{
+
+// "YYYY-MM-DD hh:mm:ss"
+constexpr std::size_t timestamp_chars = 19;
+
+}
+
+log_rezone_counts rezone_log_chunk(const log_converter& c, simd_isa isa, char* first, char* last)
+{
+    log_rezone_counts counts;
+    while(first != last)
+    {
+        auto* const eol = static_cast<char*>(std::memchr(first, '\n', static_cast<std::size_t>(last - first)));
+        auto* const end = eol != nullptr ? eol : last;
+        ++counts.lines;
+        date::sys_seconds s;
+        if(static_cast<std::size_t>(end - first) >= timestamp_chars &&
+           from_chars(isa, first, first + timestamp_chars, s).ec == std::errc{})
+        {
+            local_result r;
+            const auto lt = c.to_local(date::local_seconds{s.time_since_epoch()}, date::choose::earliest, r);
+            // years outside of [0, 9999] would change the length, they
+            // are left as they are
+            char buffer[timestamp_chars + 1];
+            const auto w = to_chars(buffer, buffer + sizeof buffer, date::sys_seconds{lt.time_since_epoch()});
+            if(w.ec == std::errc{} && w.ptr == buffer + timestamp_chars)
+            {
+                buffer[10] = first[10];
+                std::memcpy(first, buffer, timestamp_chars);
+                ++counts.converted;
+            }
+        }
+        first = eol != nullptr ? eol + 1 : last;
+    }
+    return counts;
+}
+
+std::vector<std::size_t> cut_log_chunks(const char* data, std::size_t size, std::size_t chunks, std::size_t min_chunk)
+{
+    std::vector<std::size_t> cuts{0};
+    const auto step = std::max<std::size_t>({min_chunk, size / std::max<std::size_t>(chunks, 1), 1});
+    for(auto at = step; at < size;)
+    {
+        const auto* const eol = static_cast<const char*>(std::memchr(data + at, '\n', size - at));
+        if(eol == nullptr)
+            break;
+        cuts.push_back(static_cast<std::size_t>(eol + 1 - data));
+        at = cuts.back() + step;
+    }
+    if(cuts.back() != size)
+        cuts.push_back(size);
+    return cuts;
+}
+
+log_rezone_counts rezone_log(const log_converter& c, const char* in, char* out, std::size_t size, unsigned threads)
+{
+    // enough chunks per thread that lines of uneven cost still balance
+    constexpr std::size_t chunks_per_thread = 8;
+    const auto isa = detect_simd_isa();
+    const auto cuts = cut_log_chunks(in, size, threads * chunks_per_thread);
+    const auto chunks = cuts.size() - 1;
+    std::vector<log_rezone_counts> counts(chunks);
+    std::atomic<std::size_t> next{0};
+    auto work = [&]
+    {
+        for(std::size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < chunks;)
+        {
+            if(in != out)
+                std::memcpy(out + cuts[i], in + cuts[i], cuts[i + 1] - cuts[i]);
+            counts[i] = rezone_log_chunk(c, isa, out + cuts[i], out + cuts[i + 1]);
+        }
+    };
+    std::vector<std::thread> workers;
+    for(unsigned t = 1; t < std::min<std::size_t>(threads, chunks); ++t)
+        workers.emplace_back(work);
+    work();
+    for(auto& w : workers)
+        w.join();
+
+    log_rezone_counts total;
+    for(const auto& n : counts)
+    {
+        total.lines += n.lines;
+        total.converted += n.converted;
+    }
+    return total;
+}
+
+}
@@ -0,0 +1,54 @@
+#ifndef CHRONO_DATE_REZONE_LOG_H
+#define CHRONO_DATE_REZONE_LOG_H
+
+// Re-zoning of the timestamps of a log in place, the work of log_rezone.
+//
+// Every line that begins with "YYYY-MM-DD hh:mm:ss" (or a 'T' between the
+// date and the time) is taken as a local time of the from zone of a
+// zone_pair_converter and rewritten as the same instant in local time of
+// its to zone. Fractions of a second and the rest of the line are kept as
+// they are, so every line keeps its length. Nonexistent and ambiguous
+// local times are converted like choose::earliest, lines without
+// timestamp and those whose conversion leaves the years [0, 9999] are
+// left as they are.
+//
+// A log is cut into chunks at line ends, which rezone_log converts on a
+// number of threads.
+
+#include "simd_dispatch.h"
+#include "zone_pair_converter.h"
+#include <date/tz.h>
+#include <cstddef>
+#include <vector>
+
+namespace chrono_date
+{
+
+using log_converter = zone_pair_converter<const date::time_zone*>;
+
+struct log_rezone_counts
+{
+    std::size_t lines = 0;
+    std::size_t converted = 0;
+};
+
+// at least this many bytes per chunk by default
+constexpr std::size_t log_min_chunk = 1 << 20;
+
+// rewrites the timestamps at the begin of the lines of [first, last),
+// which ends at the end of a line or of the log
+log_rezone_counts rezone_log_chunk(const log_converter& c, simd_isa isa, char* first, char* last);
+
+// the offset of every chunk and the end of the last one; chunks are about
+// size / chunks bytes, at least min_chunk, and end after a '\n' or with
+// the log
+std::vector<std::size_t> cut_log_chunks(const char* data, std::size_t size, std::size_t chunks,
+                                        std::size_t min_chunk = log_min_chunk);
+
+// converts the log in into out, which may be the same, on threads
+// threads; each chunk is copied by the thread that converts it
+log_rezone_counts rezone_log(const log_converter& c, const char* in, char* out, std::size_t size, unsigned threads);
+
+}
+
+#endif
@@ -0,0 +1,45 @@
+#include "simd_dispatch.h"
+
+namespace chrono_date
+{
+
+static simd_isa detect() noexcept
+{
+#if CHRONO_DATE_HAS_X86_DISPATCH
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx512f") &&
+       __builtin_cpu_supports("avx512bw") &&
+       __builtin_cpu_supports("avx512vl"))
+        return simd_isa::avx512;
+    if(__builtin_cpu_supports("avx2"))
+        return simd_isa::avx2;
+    if(__builtin_cpu_supports("sse4.1"))
+        return simd_isa::sse4_1;
+#endif
+    return simd_isa::generic;
+}
+
+simd_isa detect_simd_isa() noexcept
+{
+    static const auto isa = detect();
+    return isa;
+}
+
+bool is_supported(simd_isa isa) noexcept
+{
+    return static_cast<int>(isa) <= static_cast<int>(detect_simd_isa());
+}
+
+const char* to_string(simd_isa isa) noexcept
+{
+    switch(isa)
+    {
+    case simd_isa::generic: return "generic";
+    case simd_isa::sse4_1:  return "sse4.1";
+    case simd_isa::avx2:    return "avx2";
+    case simd_isa::avx512:  return "avx512";
+    }
+    return "unknown";
+}
+
+}
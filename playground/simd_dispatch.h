@@ -0,0 +1,50 @@
+#ifndef CHRONO_DATE_SIMD_DISPATCH_H
+#define CHRONO_DATE_SIMD_DISPATCH_H
+
+// Runtime selection between kernels compiled for different instruction sets.
+//
+// A kernel is written once as a plain loop over a fixed size block and
+// instantiated for every isa with CHRONO_DATE_TARGET. The compiler
+// vectorizes each instantiation for its isa; detect_simd_isa picks the
+// widest one the running cpu supports. All instantiations compute the
+// same integer arithmetic, so they produce identical results.
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CHRONO_DATE_HAS_X86_DISPATCH 1
+#define CHRONO_DATE_TARGET(isa) __attribute__((target(isa)))
+#define CHRONO_DATE_TARGET_SSE4_1 CHRONO_DATE_TARGET("sse4.1")
+#define CHRONO_DATE_TARGET_AVX2 CHRONO_DATE_TARGET("avx2")
+#define CHRONO_DATE_TARGET_AVX512 CHRONO_DATE_TARGET("avx512f,avx512bw,avx512vl")
+#else
+#define CHRONO_DATE_HAS_X86_DISPATCH 0
+#endif
+
+#if defined(__GNUC__)
+#define CHRONO_DATE_ALWAYS_INLINE inline __attribute__((always_inline))
+#define CHRONO_DATE_RESTRICT __restrict
+#else
+#define CHRONO_DATE_ALWAYS_INLINE inline
+#define CHRONO_DATE_RESTRICT
+#endif
+
+namespace chrono_date
+{
+
+enum class simd_isa
+{
+    generic,
+    sse4_1,
+    avx2,
+    avx512
+};
+
+// widest isa supported by this cpu, determined once
+simd_isa detect_simd_isa() noexcept;
+
+bool is_supported(simd_isa isa) noexcept;
+
+const char* to_string(simd_isa isa) noexcept;
+
+}
+
+#endif
@@ -0,0 +1,125 @@
+#ifndef CHRONO_DATE_STATIC_ZONE_H
+#define CHRONO_DATE_STATIC_ZONE_H
+
+// Time zones whose rules are compiled into the program.
+//
+// static_zones_compile writes a header with one constexpr static_zone per
+// configured zone, see static_zones.h in the build directory. Their
+// to_sys, to_local and find_info are constant expressions, so conversions
+// of constants happen at compile time and all others are a binary search
+// over a small table the compiler can see. Nothing is read from a tzdb
+// at run time.
+//
+// Like a tzdb_image, the table covers the years it was generated for,
+// [static_zones::range_begin(), static_zones::range_end()), extended to
+// the intervals these fall into; table_begin() and table_end() of a zone
+// return its exact range. Times outside of it throw std::runtime_error,
+// and in a constant expression do not compile.
+
+#include "zone_base.h"
+#include <date/date.h>
+#include <date/tz.h>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace chrono_date
+{
+
+// one interval of a static_zone, the generated tables are arrays of these
+struct static_zone_info
+{
+    std::int64_t begin;
+    std::int64_t end;
+    std::int32_t offset;
+    std::int32_t save;
+    const char* abbrev;
+};
+
+class static_zone : public zone_base<static_zone>
+{
+public:
+    template<std::size_t N>
+    constexpr static_zone(const char* name, const static_zone_info (&infos)[N]) noexcept
+        : name_{name}
+        , infos_{infos}
+        , count_{N}
+    {
+    }
+
+    constexpr const char* name() const noexcept
+    {
+        return name_;
+    }
+
+    constexpr std::size_t info_count() const noexcept
+    {
+        return count_;
+    }
+
+    constexpr std::size_t find_info(std::int64_t sys_secs) const noexcept
+    {
+        // first info beginning after sys_secs, the one before contains it
+        std::size_t lo = 1;
+        std::size_t hi = count_;
+        while(lo < hi)
+        {
+            const auto mid = lo + (hi - lo) / 2;
+            if(infos_[mid].begin <= sys_secs)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        return lo - 1;
+    }
+
+    constexpr std::int64_t info_begin(std::size_t i) const noexcept
+    {
+        return infos_[i].begin;
+    }
+
+    constexpr std::int64_t info_end(std::size_t i) const noexcept
+    {
+        return infos_[i].end;
+    }
+
+    constexpr std::int32_t info_offset(std::size_t i) const noexcept
+    {
+        return infos_[i].offset;
+    }
+
+    date::sys_info info(std::size_t i) const
+    {
+        date::sys_info si;
+        si.begin = date::sys_seconds{std::chrono::seconds{infos_[i].begin}};
+        si.end = date::sys_seconds{std::chrono::seconds{infos_[i].end}};
+        si.offset = std::chrono::seconds{infos_[i].offset};
+        si.save = std::chrono::minutes{infos_[i].save};
+        si.abbrev = infos_[i].abbrev;
+        return si;
+    }
+
+private:
+    const char* name_;
+    const static_zone_info* infos_;
+    std::size_t count_;
+};
+
+namespace detail
+{
+
+constexpr bool equal_names(const char* a, const char* b) noexcept
+{
+    while(*a != '\0' && *a == *b)
+    {
+        ++a;
+        ++b;
+    }
+    return *a == *b;
+}
+
+}
+
+}
+
+#endif
@@ -0,0 +1,176 @@
+// Generates constexpr rule tables of some zones of the time zone database
+// date loads, see static_zone.h.
+//
+// usage: static_zones_compile <header> <first year> <last year> <zone>...
+//
+// The tables cover the years [first year, last year), which
+// static_zones::range_begin() and range_end() return. Every zone becomes a
+// chrono_date::static_zones::<name> with all characters of its name but
+// letters and digits replaced by '_', e.g. europe_berlin for
+// Europe/Berlin, and the signs of offsets spelled out, e.g. etc_gmt_plus_1
+// for Etc/GMT+1 and etc_gmt_minus_1 for Etc/GMT-1. static_zones::find
+// looks them up by name. Zones which would get the same name, e.g. a zone
+// listed twice, are rejected.
+
+#include <date/date.h>
+#include <date/tz.h>
+#include <cctype>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+std::string identifier(const std::string& name)
+{
+    std::string id;
+    for(std::size_t i = 0; i < name.size(); ++i)
+    {
+        const auto c = static_cast<unsigned char>(name[i]);
+        const bool sign = i + 1 < name.size() && std::isdigit(static_cast<unsigned char>(name[i + 1]));
+        if(std::isalnum(c))
+            id += static_cast<char>(std::tolower(c));
+        else if(c == '+')
+            id += "_plus_";
+        else if(c == '-' && sign)
+            id += "_minus_";
+        else
+            id += '_';
+    }
+    if(id.empty() || std::isdigit(static_cast<unsigned char>(id.front())))
+        id.insert(0, "zone_");
+    return id;
+}
+
+std::string seconds_literal(date::sys_seconds s)
+{
+    const auto c = static_cast<std::int64_t>(s.time_since_epoch().count());
+    if(c == std::numeric_limits<std::int64_t>::min())
+        return "INT64_MIN";
+    if(c == std::numeric_limits<std::int64_t>::max())
+        return "INT64_MAX";
+    return std::to_string(c);
+}
+
+void write_table(std::ostream& out, const date::time_zone& tz, const std::string& id,
+                 date::sys_seconds first, date::sys_seconds last)
+{
+    out << "constexpr static_zone_info " << id << "[] = {\n";
+    for(auto info = tz.get_info(first);; info = tz.get_info(info.end))
+    {
+        out << "    {" << seconds_literal(info.begin)
+            << ", " << seconds_literal(info.end)
+            << ", " << info.offset.count()
+            << ", " << info.save.count()
+            << ", \"" << info.abbrev << "\"},\n";
+        if(info.end >= last)
+            break;
+    }
+    out << "};\n\n";
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    using namespace date;
+
+    if(argc < 5)
+    {
+        std::cerr << "usage: " << argv[0] << " <header> <first year> <last year> <zone>...\n";
+        return EXIT_FAILURE;
+    }
+    const auto first = year{std::atoi(argv[2])};
+    const auto last  = year{std::atoi(argv[3])};
+    if(!first.ok() || !last.ok() || first >= last)
+    {
+        std::cerr << "invalid range of years\n";
+        return EXIT_FAILURE;
+    }
+
+    try
+    {
+        const auto& db = get_tzdb();
+        const auto from = sys_seconds{sys_days{first / jan / 1}};
+        const auto to   = sys_seconds{sys_days{last / jan / 1}};
+        std::vector<std::string> names(argv + 4, argv + argc);
+        std::vector<const time_zone*> zones;
+        std::map<std::string, std::string> identifiers;
+        for(const auto& name : names)
+        {
+            zones.push_back(db.locate_zone(name));
+            const auto inserted = identifiers.emplace(identifier(name), name);
+            if(!inserted.second)
+            {
+                if(name == inserted.first->second)
+                    std::cerr << name << " is listed twice\n";
+                else
+                    std::cerr << name << " and " << inserted.first->second
+                              << " both become static_zones::" << inserted.first->first << '\n';
+                return EXIT_FAILURE;
+            }
+        }
+
+        std::ofstream out{argv[1]};
+        out << "// Generated by static_zones_compile from tzdata " << db.version << ", do not edit.\n"
+            << "//\n"
+            << "// Rules of";
+        for(const auto& name : names)
+            out << ' ' << name;
+        out << " for the years [" << static_cast<int>(first) << ", " << static_cast<int>(last) << ").\n\n"
+            << "#ifndef CHRONO_DATE_STATIC_ZONES_H\n"
+            << "#define CHRONO_DATE_STATIC_ZONES_H\n\n"
+            << "#include \"static_zone.h\"\n"
+            << "#include <date/date.h>\n"
+            << "#include <chrono>\n"
+            << "#include <cstdint>\n\n"
+            << "namespace chrono_date\n{\n\nnamespace static_zones\n{\n\n"
+            << "constexpr const char tzdata_version[] = \"" << db.version << "\";\n\n"
+            << "// every table covers at least [range_begin(), range_end()), see its\n"
+            << "// table_begin() and table_end() for all it covers\n"
+            << "constexpr date::sys_seconds range_begin() noexcept\n{\n"
+            << "    return date::sys_seconds{std::chrono::seconds{" << seconds_literal(from) << "}};\n}\n\n"
+            << "constexpr date::sys_seconds range_end() noexcept\n{\n"
+            << "    return date::sys_seconds{std::chrono::seconds{" << seconds_literal(to) << "}};\n}\n\n"
+            << "namespace tables\n{\n\n";
+        for(std::size_t i = 0; i < zones.size(); ++i)
+            write_table(out, *zones[i], identifier(names[i]), from, to);
+        out << "}\n\n";
+        for(std::size_t i = 0; i < zones.size(); ++i)
+        {
+            const auto id = identifier(names[i]);
+            out << "constexpr static_zone " << id << "{\"" << zones[i]->name() << "\", tables::" << id << "};\n";
+        }
+        out << "\n// zone or link name to zone, nullptr if it is none of the above\n"
+            << "constexpr const static_zone* find(const char* name) noexcept\n{\n";
+        for(std::size_t i = 0; i < zones.size(); ++i)
+        {
+            const auto id = identifier(names[i]);
+            out << "    if(detail::equal_names(name, \"" << names[i] << "\"))\n"
+                << "        return &" << id << ";\n";
+            if(zones[i]->name() != names[i])
+                out << "    if(detail::equal_names(name, \"" << zones[i]->name() << "\"))\n"
+                    << "        return &" << id << ";\n";
+        }
+        out << "    return nullptr;\n}\n\n}\n\n}\n\n#endif\n";
+        if(!out)
+        {
+            std::cerr << "can not write " << argv[1] << '\n';
+            return EXIT_FAILURE;
+        }
+        std::cout << "tzdata " << db.version << ": " << zones.size() << " static zones\n";
+    }
+    catch(const std::exception& e)
+    {
+        std::cerr << e.what() << '\n';
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,197 @@
+#include "timestamp_codec.h"
+#include <stdexcept>
+
+namespace chrono_date
+{
+
+namespace
+{
+
+// a block is the tick before the first one, the first difference, the
+// width and codec_block packed values of that width; all arithmetic wraps
+// around, so that any ticks round trip
+constexpr std::size_t block_header = 3;
+
+std::uint64_t zigzag(std::uint64_t v)
+{
+    return v << 1 ^ (0 - (v >> 63));
+}
+
+CHRONO_DATE_ALWAYS_INLINE
+std::uint64_t unzigzag(std::uint64_t z)
+{
+    return z >> 1 ^ (0 - (z & 1));
+}
+
+unsigned width_of(std::uint64_t v)
+{
+    unsigned w = 0;
+    for(; v != 0; v >>= 1)
+        ++w;
+    return w;
+}
+
+// value j takes the bits [j * Width, (j + 1) * Width) of in; reads up to
+// one word past the last value, which is never out of the column. With
+// the width known to the compiler every word and shift is a constant.
+template<unsigned Width>
+CHRONO_DATE_ALWAYS_INLINE
+void unpack(const std::uint64_t* CHRONO_DATE_RESTRICT in, std::uint64_t* CHRONO_DATE_RESTRICT out)
+{
+    constexpr auto mask = ~std::uint64_t{0} >> (64 - Width);
+    for(std::size_t j = 0; j < detail::codec_block; ++j)
+    {
+        const auto bit = j * Width;
+        const auto word = bit / 64;
+        const auto shift = bit % 64;
+        // in[word + 1] << 64 - shift, or nothing if shift is 0
+        const auto v = (in[word] >> shift | in[word + 1] << 1 << (63 - shift)) & mask;
+        out[j] = unzigzag(v);
+    }
+}
+
+// unpack<width> for a width in [First, Last], by bisection; inlined as a
+// whole into each kernel, so that every width is compiled for its isa
+template<unsigned First, unsigned Last>
+struct unpacker
+{
+    CHRONO_DATE_ALWAYS_INLINE
+    static void unpack(unsigned width, const std::uint64_t* in, std::uint64_t* out)
+    {
+        constexpr auto middle = (First + Last) / 2;
+        if(width <= middle)
+            unpacker<First, middle>::unpack(width, in, out);
+        else
+            unpacker<middle + 1, Last>::unpack(width, in, out);
+    }
+};
+
+template<unsigned Width>
+struct unpacker<Width, Width>
+{
+    CHRONO_DATE_ALWAYS_INLINE
+    static void unpack(unsigned, const std::uint64_t* in, std::uint64_t* out)
+    {
+        chrono_date::unpack<Width>(in, out);
+    }
+};
+
+CHRONO_DATE_ALWAYS_INLINE
+void decode_block_loop(const std::uint64_t* block, std::size_t n, std::int64_t* ticks)
+{
+    auto tick = block[0];
+    auto delta = block[1];
+    const auto width = static_cast<unsigned>(block[2]);
+    if(width == 0)
+    {
+        // all differences equal, no dependency between the ticks
+        for(std::size_t j = 0; j < n; ++j)
+            ticks[j] = static_cast<std::int64_t>(tick + (j + 1) * delta);
+        return;
+    }
+    std::uint64_t dod[detail::codec_block];
+    unpacker<1, 64>::unpack(width, block + block_header, dod);
+    for(std::size_t j = 0; j < n; ++j)
+    {
+        delta += dod[j];
+        tick += delta;
+        ticks[j] = static_cast<std::int64_t>(tick);
+    }
+}
+
+#define CHRONO_DATE_CODEC_KERNELS(suffix, target)                                        \
+    target void decode_block_##suffix(const std::uint64_t* block, std::size_t n,        \
+                                      std::int64_t* ticks)                              \
+    {                                                                                   \
+        decode_block_loop(block, n, ticks);                                             \
+    }
+
+CHRONO_DATE_CODEC_KERNELS(generic, )
+#if CHRONO_DATE_HAS_X86_DISPATCH
+CHRONO_DATE_CODEC_KERNELS(sse4_1, CHRONO_DATE_TARGET_SSE4_1)
+CHRONO_DATE_CODEC_KERNELS(avx2, CHRONO_DATE_TARGET_AVX2)
+CHRONO_DATE_CODEC_KERNELS(avx512, CHRONO_DATE_TARGET_AVX512)
+#endif
+
+#undef CHRONO_DATE_CODEC_KERNELS
+
+}
+
+namespace detail
+{
+
+void encode_block(const std::int64_t* ticks, std::size_t n, std::vector<std::uint64_t>& words)
+{
+    const auto first = static_cast<std::uint64_t>(ticks[0]);
+    const auto delta = n > 1 ? static_cast<std::uint64_t>(ticks[1]) - first : 0;
+
+    std::uint64_t dod[codec_block] = {};
+    std::uint64_t largest = 0;
+    auto tick = first - delta;
+    auto previous = delta;
+    for(std::size_t j = 0; j < n; ++j)
+    {
+        const auto next = static_cast<std::uint64_t>(ticks[j]);
+        dod[j] = zigzag(next - tick - previous);
+        largest |= dod[j];
+        previous = next - tick;
+        tick = next;
+    }
+    const auto width = width_of(largest);
+
+    words.push_back(first - delta);
+    words.push_back(delta);
+    words.push_back(width);
+    const auto at = words.size();
+    words.resize(at + codec_block * width / 64);
+    for(std::size_t j = 0; j < codec_block && width != 0; ++j)
+    {
+        const auto bit = j * width;
+        const auto word = at + bit / 64;
+        const auto shift = bit % 64;
+        words[word] |= dod[j] << shift;
+        if(shift + width > 64)
+            words[word + 1] |= dod[j] >> (64 - shift);
+    }
+}
+
+void decode_block(simd_isa isa, const std::uint64_t* block, std::size_t n, std::int64_t* ticks)
+{
+    switch(is_supported(isa) ? isa : detect_simd_isa())
+    {
+#if CHRONO_DATE_HAS_X86_DISPATCH
+    case simd_isa::avx512: return decode_block_avx512(block, n, ticks);
+    case simd_isa::avx2:   return decode_block_avx2(block, n, ticks);
+    case simd_isa::sse4_1: return decode_block_sse4_1(block, n, ticks);
+#endif
+    default:               return decode_block_generic(block, n, ticks);
+    }
+}
+
+void check_codec_words(const std::vector<std::uint64_t>& words, std::intmax_t num, std::intmax_t den)
+{
+    if(words.size() < codec_header + 1)
+        throw std::runtime_error("timestamp column is truncated");
+    if(words[1] != static_cast<std::uint64_t>(num) || words[2] != static_cast<std::uint64_t>(den))
+        throw std::runtime_error("timestamp column has a different period");
+    // not rounded up by adding, which overflows for a corrupt count
+    const auto blocks = words[0] / codec_block + (words[0] % codec_block != 0);
+    // the directory and the word after the last block
+    if(blocks > words.size() - codec_header - 1)
+        throw std::runtime_error("timestamp column is truncated");
+    const auto end = words.size() - 1;
+    for(std::size_t b = 0; b < blocks; ++b)
+    {
+        const auto at = words[codec_header + b];
+        if(at < codec_header + blocks || at > end || end - at < block_header)
+            throw std::runtime_error("timestamp column is truncated");
+        // encode_block writes widths of [0, 64] only
+        const auto width = words[at + 2];
+        if(width > 64 || end - at - block_header < codec_block * width / 64)
+            throw std::runtime_error("timestamp column is truncated");
+    }
+}
+
+}
+
+}
@@ -0,0 +1,243 @@
+#ifndef CHRONO_DATE_TIMESTAMP_CODEC_H
+#define CHRONO_DATE_TIMESTAMP_CODEC_H
+
+// Compressed columns of time points.
+//
+// Ticks are stored as differences of successive differences, zigzag
+// encoded and bit packed, like the time stamps of Gorilla. Instead of a
+// variable length code per value, each block of 128 ticks packs its
+// values with the same width, the width of the largest one. That keeps
+// the unpacking free of branches and vectorizable, and a directory of
+// block offsets gives random access to any tick by decoding at most the
+// block it is in. Sorted columns with regular intervals pack into a few
+// bits per tick, arbitrary ticks into at most 64.
+//
+// decode_fields writes the fields of year_month_day and hh_mm_ss of the
+// time points into columns, without building either.
+//
+// The encoded words are self describing: they hold the number of ticks
+// and the period of Duration, which is checked when a column is read
+// back from them.
+
+#include "civil_batch.h"
+#include "simd_dispatch.h"
+#include <date/date.h>
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ratio>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace chrono_date
+{
+
+namespace detail
+{
+
+// ticks per block
+constexpr std::size_t codec_block = 128;
+
+// number of ticks, numerator and denominator of the period
+constexpr std::size_t codec_header = 3;
+
+// appends a block of the n <= codec_block ticks to words
+void encode_block(const std::int64_t* ticks, std::size_t n, std::vector<std::uint64_t>& words);
+
+// decodes the first n ticks of the block at block
+void decode_block(simd_isa isa, const std::uint64_t* block, std::size_t n, std::int64_t* ticks);
+
+// throws std::runtime_error unless words are a column of ticks of the period
+void check_codec_words(const std::vector<std::uint64_t>& words, std::intmax_t num, std::intmax_t den);
+
+}
+
+// structure of arrays of hh_mm_ss<Duration> fields; subseconds counts
+// Duration, for Duration of seconds it is 0
+template<class Duration>
+struct hms_columns
+{
+    std::uint8_t* hours;
+    std::uint8_t* minutes;
+    std::uint8_t* seconds;
+    typename Duration::rep* subseconds;
+};
+
+template<class Duration>
+class timestamp_column
+{
+public:
+    using time_point = date::sys_time<Duration>;
+
+    timestamp_column()
+        : timestamp_column(nullptr, 0)
+    {
+    }
+
+    timestamp_column(const time_point* in, std::size_t n)
+    {
+        const auto blocks = (n + detail::codec_block - 1) / detail::codec_block;
+        words_.reserve(detail::codec_header + blocks * 4 + 1);
+        words_.push_back(n);
+        words_.push_back(static_cast<std::uint64_t>(period::num));
+        words_.push_back(static_cast<std::uint64_t>(period::den));
+        words_.resize(detail::codec_header + blocks);
+        std::int64_t ticks[detail::codec_block];
+        for(std::size_t b = 0; b < blocks; ++b)
+        {
+            const auto first = b * detail::codec_block;
+            const auto count = std::min(detail::codec_block, n - first);
+            for(std::size_t i = 0; i < count; ++i)
+                ticks[i] = static_cast<std::int64_t>(in[first + i].time_since_epoch().count());
+            words_[detail::codec_header + b] = words_.size();
+            detail::encode_block(ticks, count, words_);
+        }
+        // the unpacking reads one word past the last block
+        words_.push_back(0);
+    }
+
+    // a column from the words of another, throws std::runtime_error if
+    // they are not a column of time points of Duration
+    explicit timestamp_column(std::vector<std::uint64_t> words)
+        : words_(std::move(words))
+    {
+        detail::check_codec_words(words_, period::num, period::den);
+    }
+
+    std::size_t size() const noexcept
+    {
+        return static_cast<std::size_t>(words_[0]);
+    }
+
+    // the encoded column, to be stored and read back as is
+    const std::vector<std::uint64_t>& words() const noexcept
+    {
+        return words_;
+    }
+
+    // decodes the block up to i
+    time_point operator[](std::size_t i) const
+    {
+        std::int64_t ticks[detail::codec_block];
+        const auto k = i % detail::codec_block;
+        detail::decode_block(default_isa(), block(i / detail::codec_block), k + 1, ticks);
+        return time_point{Duration{ticks[k]}};
+    }
+
+    // out[i] = (*this)[first + i] for i in [0, n)
+    void decode(std::size_t first, std::size_t n, time_point* out) const
+    {
+        decode(detect_simd_isa(), first, n, out);
+    }
+
+    void decode(simd_isa isa, std::size_t first, std::size_t n, time_point* out) const
+    {
+        for_each_block(isa, first, n, [=](const std::int64_t* ticks, std::size_t at, std::size_t count)
+        {
+            for(std::size_t i = 0; i < count; ++i)
+                out[at + i] = time_point{Duration{ticks[i]}};
+        });
+    }
+
+    // ymd.year[i] / ymd.month[i] / ymd.day[i] and the fields of hms at i
+    // are the date and time of day of (*this)[first + i] for i in [0, n)
+    void decode_fields(std::size_t first, std::size_t n, ymd_columns ymd, hms_columns<Duration> hms) const
+    {
+        decode_fields(detect_simd_isa(), first, n, ymd, hms);
+    }
+
+    void decode_fields(simd_isa isa, std::size_t first, std::size_t n, ymd_columns ymd,
+                       hms_columns<Duration> hms) const
+    {
+        using day_ticks = std::ratio_divide<date::days::period, period>;
+        using second_ticks = std::ratio_divide<std::ratio<1>, period>;
+        static_assert(day_ticks::den == 1 && second_ticks::den == 1,
+                      "decode_fields needs a Duration that divides a second");
+        // time of day in 32 bits where it fits, which vectorizes better
+        using tod_rep = typename std::conditional<day_ticks::num <= 0xffffffff, std::uint32_t, std::uint64_t>::type;
+        for_each_block(isa, first, n, [=](const std::int64_t* ticks, std::size_t at, std::size_t count)
+        {
+            constexpr auto per_day = static_cast<std::int64_t>(day_ticks::num);
+            constexpr auto per_second = static_cast<tod_rep>(second_ticks::num);
+            // most ticks are on the day of the one before, which saves
+            // the division by the ticks of a day
+            date::sys_days days[detail::codec_block];
+            tod_rep tods[detail::codec_block];
+            std::int64_t day = 0;
+            std::int64_t begin = 0;
+            for(std::size_t i = 0; i < count; ++i)
+            {
+                auto tod = ticks[i] - begin;
+                if(tod < 0 || tod >= per_day)
+                {
+                    const auto q = ticks[i] / per_day;
+                    day = q - (q * per_day > ticks[i]);
+                    begin = day * per_day;
+                    tod = ticks[i] - begin;
+                }
+                days[i] = date::sys_days{date::days{day}};
+                tods[i] = static_cast<tod_rep>(tod);
+            }
+            // the columns are written through locals, the uint8_t stores
+            // could alias everything else
+            auto* const CHRONO_DATE_RESTRICT hours = hms.hours + at;
+            auto* const CHRONO_DATE_RESTRICT minutes = hms.minutes + at;
+            auto* const CHRONO_DATE_RESTRICT seconds = hms.seconds + at;
+            auto* const CHRONO_DATE_RESTRICT subseconds = hms.subseconds + at;
+            for(std::size_t i = 0; i < count; ++i)
+            {
+                const auto s = static_cast<std::uint32_t>(tods[i] / per_second);
+                hours[i] = static_cast<std::uint8_t>(s / 3600);
+                minutes[i] = static_cast<std::uint8_t>(s / 60 % 60);
+                seconds[i] = static_cast<std::uint8_t>(s % 60);
+                subseconds[i] = static_cast<typename Duration::rep>(tods[i] - s * per_second);
+            }
+            to_ymd(isa, days, count, {ymd.year + at, ymd.month + at, ymd.day + at});
+        });
+    }
+
+private:
+    using period = typename Duration::period;
+
+    static simd_isa default_isa()
+    {
+        static const auto isa = detect_simd_isa();
+        return isa;
+    }
+
+    const std::uint64_t* block(std::size_t b) const
+    {
+        return words_.data() + words_[detail::codec_header + b];
+    }
+
+    // f(ticks, index into the output, count) for the decoded part of
+    // every block that overlaps [first, first + n)
+    template<class F>
+    void for_each_block(simd_isa isa, std::size_t first, std::size_t n, F f) const
+    {
+        std::int64_t ticks[detail::codec_block];
+        for(std::size_t at = 0; at < n;)
+        {
+            const auto i = first + at;
+            const auto k = i % detail::codec_block;
+            const auto count = std::min(detail::codec_block - k, n - at);
+            detail::decode_block(isa, block(i / detail::codec_block), k + count, ticks);
+            f(ticks + k, at, count);
+            at += count;
+        }
+    }
+
+    std::vector<std::uint64_t> words_;
+};
+
+template<class Duration>
+timestamp_column<Duration> encode_timestamps(const date::sys_time<Duration>* in, std::size_t n)
+{
+    return timestamp_column<Duration>{in, n};
+}
+
+}
+
+#endif
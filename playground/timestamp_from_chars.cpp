@@ -0,0 +1,183 @@
+#include "timestamp_from_chars.h"
+
+#if CHRONO_DATE_HAS_X86_DISPATCH
+#include <immintrin.h>
+#endif
+
+namespace chrono_date
+{
+
+namespace
+{
+
+struct civil_time
+{
+    unsigned year;
+    unsigned month;
+    unsigned day;
+    unsigned hour;
+    unsigned minute;
+    unsigned second;
+};
+
+bool is_digit(char c) noexcept
+{
+    return static_cast<unsigned char>(c - '0') <= 9;
+}
+
+bool is_time_separator(char c) noexcept
+{
+    return c == 'T' || c == 't' || c == ' ';
+}
+
+// two digits at p, false if any of them is not one
+bool read_2(const char* p, unsigned& v) noexcept
+{
+    if(!is_digit(p[0]) || !is_digit(p[1]))
+        return false;
+    v = 10 * static_cast<unsigned>(p[0] - '0') + static_cast<unsigned>(p[1] - '0');
+    return true;
+}
+
+// "YYYY-MM-DD" at p, which has at least 10 readable characters
+bool parse_date(const char* p, civil_time& t) noexcept
+{
+    unsigned hi, lo;
+    if(!read_2(p, hi) || !read_2(p + 2, lo) || p[4] != '-' || !read_2(p + 5, t.month) || p[7] != '-' || !read_2(p + 8, t.day))
+        return false;
+    t.year = 100 * hi + lo;
+    return true;
+}
+
+// "hh:mm:ss" at p, which has at least 8 readable characters
+bool parse_time(const char* p, civil_time& t) noexcept
+{
+    return read_2(p, t.hour) && p[2] == ':' && read_2(p + 3, t.minute) && p[5] == ':' && read_2(p + 6, t.second);
+}
+
+// "YYYY-MM-DDThh:mm" at p, which has at least 16 readable characters,
+// with any character between date and time
+bool parse_prefix_generic(const char* p, civil_time& t) noexcept
+{
+    return parse_date(p, t) && read_2(p + 11, t.hour) && p[13] == ':' && read_2(p + 14, t.minute);
+}
+
+#if CHRONO_DATE_HAS_X86_DISPATCH
+CHRONO_DATE_TARGET_SSE4_1
+bool parse_prefix_sse4_1(const char* p, civil_time& t) noexcept
+{
+    // bytes 0-3, 5-6, 8-9, 11-12 and 14-15 are digits, 4 and 7 '-', 13 ':'
+    constexpr int digit_bytes = 0xdb6f;
+    constexpr int separator_bytes = 0x2090;
+    const auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    const auto d = _mm_sub_epi8(v, _mm_set1_epi8('0'));
+    const auto digit = _mm_cmpeq_epi8(_mm_min_epu8(d, _mm_set1_epi8(9)), d);
+    const auto separator = _mm_cmpeq_epi8(v, _mm_setr_epi8(0, 0, 0, 0, '-', 0, 0, '-', 0, 0, 0, 0, 0, ':', 0, 0));
+    if((_mm_movemask_epi8(digit) & digit_bytes) != digit_bytes ||
+       (_mm_movemask_epi8(separator) & separator_bytes) != separator_bytes)
+        return false;
+
+    // gather the digit pairs and combine each into 10 * first + second
+    const auto pairs = _mm_shuffle_epi8(d, _mm_setr_epi8(0, 1, 2, 3, 5, 6, 8, 9, 11, 12, 14, 15, -1, -1, -1, -1));
+    const auto values = _mm_maddubs_epi16(pairs, _mm_setr_epi8(10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 0, 0, 0, 0));
+    t.year = 100 * static_cast<unsigned>(_mm_extract_epi16(values, 0)) + static_cast<unsigned>(_mm_extract_epi16(values, 1));
+    t.month = static_cast<unsigned>(_mm_extract_epi16(values, 2));
+    t.day = static_cast<unsigned>(_mm_extract_epi16(values, 3));
+    t.hour = static_cast<unsigned>(_mm_extract_epi16(values, 4));
+    t.minute = static_cast<unsigned>(_mm_extract_epi16(values, 5));
+    return true;
+}
+#endif
+
+bool parse_prefix(simd_isa isa, const char* p, civil_time& t) noexcept
+{
+#if CHRONO_DATE_HAS_X86_DISPATCH
+    // wider isas have nothing to add for a single timestamp
+    if(isa != simd_isa::generic)
+        return parse_prefix_sse4_1(p, t);
+#endif
+    static_cast<void>(isa);
+    return parse_prefix_generic(p, t);
+}
+
+}
+
+namespace detail
+{
+
+from_chars_result parse_timestamp(simd_isa isa,
+                                  const char* first,
+                                  const char* last,
+                                  date::sys_seconds& s,
+                                  std::int64_t& atto) noexcept
+{
+    if(!is_supported(isa))
+        isa = detect_simd_isa();
+    const auto size = last - first;
+    const auto p = first;
+    civil_time t{0, 0, 0, 0, 0, 0};
+    const char* q;
+    bool has_time;
+    if(size >= 19 && is_time_separator(p[10]) && p[16] == ':' && read_2(p + 17, t.second) && parse_prefix(isa, p, t))
+    {
+        q = p + 19;
+        has_time = true;
+    }
+    else
+    {
+        if(size < 10 || !parse_date(p, t))
+            return {first, std::errc::invalid_argument};
+        // a blank not followed by a time ends a date only timestamp
+        has_time = size > 10 && (p[10] == 'T' || p[10] == 't' || (p[10] == ' ' && size > 11 && is_digit(p[11])));
+        if(has_time && (size < 19 || !parse_time(p + 11, t)))
+            return {first, std::errc::invalid_argument};
+        q = has_time ? p + 19 : p + 10;
+    }
+
+    std::int64_t fraction = 0;
+    std::int32_t offset = 0;
+    if(has_time)
+    {
+        if(q != last && *q == '.')
+        {
+            ++q;
+            if(q == last || !is_digit(*q))
+                return {first, std::errc::invalid_argument};
+            std::int64_t scale = 100000000000000000;
+            for(; q != last && is_digit(*q); ++q)
+            {
+                fraction += scale * (*q - '0');
+                scale /= 10;
+            }
+        }
+        if(q != last && (*q == 'Z' || *q == 'z'))
+        {
+            ++q;
+        }
+        else if(q != last && (*q == '+' || *q == '-'))
+        {
+            const auto sign = *q == '-' ? -1 : 1;
+            unsigned h, m;
+            if(last - q < 5 || !read_2(q + 1, h))
+                return {first, std::errc::invalid_argument};
+            const auto colon = q[3] == ':';
+            if((colon && last - q < 6) || !read_2(q + 3 + colon, m))
+                return {first, std::errc::invalid_argument};
+            if(h > 23 || m > 59)
+                return {first, std::errc::result_out_of_range};
+            offset = sign * static_cast<std::int32_t>(60 * (60 * h + m));
+            q += 5 + colon;
+        }
+    }
+
+    const auto ymd = date::year{static_cast<int>(t.year)} / date::month{t.month} / date::day{t.day};
+    if(!ymd.ok() || t.hour > 23 || t.minute > 59 || t.second > 59)
+        return {first, std::errc::result_out_of_range};
+    s = date::sys_days{ymd} + std::chrono::seconds{std::int64_t{3600 * t.hour + 60 * t.minute + t.second} - offset};
+    atto = fraction;
+    return {q, std::errc{}};
+}
+
+}
+
+}
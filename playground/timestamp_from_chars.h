@@ -0,0 +1,136 @@
+#ifndef CHRONO_DATE_TIMESTAMP_FROM_CHARS_H
+#define CHRONO_DATE_TIMESTAMP_FROM_CHARS_H
+
+// Parsing of fixed layout ISO 8601 / RFC 3339 timestamps.
+//
+//   YYYY-MM-DD
+//   YYYY-MM-DD[T|t| ]hh:mm:ss[.fraction][Z|z|+hh:mm|-hh:mm|+hhmm|-hhmm]
+//
+// A timestamp without offset is taken as UTC, so everything that to_chars
+// writes for a sys_time of a year in [0, 9999] parses back to the same
+// value. Fractions beyond 18 digits are ignored and the result is floored
+// to the precision of the target.
+//
+// Like std::from_chars nothing is allocated and ptr points behind the
+// parsed characters. errc::invalid_argument reports a malformed timestamp,
+// errc::result_out_of_range a field out of its range, like February 30th
+// or a minute of 60. On error the target is left unchanged.
+//
+// With sse4.1 the 16 bytes of "YYYY-MM-DDThh:mm" are validated and
+// converted in a handful of vector instructions.
+
+#include "simd_dispatch.h"
+#include <date/date.h>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ratio>
+#include <system_error>
+#include <type_traits>
+
+namespace chrono_date
+{
+
+struct from_chars_result
+{
+    const char* ptr;
+    std::errc ec;
+};
+
+namespace detail
+{
+
+// s + atto attoseconds is the parsed time point
+from_chars_result parse_timestamp(simd_isa isa,
+                                  const char* first,
+                                  const char* last,
+                                  date::sys_seconds& s,
+                                  std::int64_t& atto) noexcept;
+
+template<class Duration>
+date::sys_time<Duration> to_sys_time(date::sys_seconds s, std::int64_t atto, std::true_type)
+{
+    using attoseconds = std::chrono::duration<std::int64_t, std::atto>;
+    return date::floor<Duration>(s) + date::floor<Duration>(attoseconds{atto});
+}
+
+// the fraction can not matter for durations of a second and more
+template<class Duration>
+date::sys_time<Duration> to_sys_time(date::sys_seconds s, std::int64_t, std::false_type)
+{
+    return date::floor<Duration>(s);
+}
+
+template<class Duration>
+date::sys_time<Duration> to_sys_time(date::sys_seconds s, std::int64_t atto)
+{
+    return to_sys_time<Duration>(s, atto, std::ratio_less<typename Duration::period, std::ratio<1>>{});
+}
+
+}
+
+template<class Duration>
+from_chars_result from_chars(simd_isa isa, const char* first, const char* last, date::sys_time<Duration>& tp) noexcept
+{
+    date::sys_seconds s;
+    std::int64_t atto;
+    const auto r = detail::parse_timestamp(isa, first, last, s, atto);
+    if(r.ec == std::errc{})
+        tp = detail::to_sys_time<Duration>(s, atto);
+    return r;
+}
+
+template<class Duration>
+from_chars_result from_chars(const char* first, const char* last, date::sys_time<Duration>& tp) noexcept
+{
+    return from_chars(detect_simd_isa(), first, last, tp);
+}
+
+struct lines_from_chars_result
+{
+    // begin of the first line not parsed
+    const char* ptr;
+    // number of timestamps written
+    std::size_t count;
+    std::errc ec;
+};
+
+// Parses one timestamp per line of [first, last) into out, at most n.
+// Lines end with "\n" or "\r\n", the last one may be unterminated.
+// Stops at the first line that is not exactly one timestamp, with ptr at
+// its begin and the error in ec, so the caller can skip it and resume.
+template<class Duration>
+lines_from_chars_result
+lines_from_chars(simd_isa isa, const char* first, const char* last, date::sys_time<Duration>* out, std::size_t n) noexcept
+{
+    std::size_t count = 0;
+    while(first != last && count < n)
+    {
+        date::sys_seconds s;
+        std::int64_t atto;
+        auto r = detail::parse_timestamp(isa, first, last, s, atto);
+        if(r.ec == std::errc{})
+        {
+            if(r.ptr != last && *r.ptr == '\r')
+                ++r.ptr;
+            if(r.ptr != last && *r.ptr++ != '\n')
+                r.ec = std::errc::invalid_argument;
+        }
+        if(r.ec != std::errc{})
+            return {first, count, r.ec};
+        out[count++] = detail::to_sys_time<Duration>(s, atto);
+        first = r.ptr;
+    }
+    return {first, count, std::errc{}};
+}
+
+template<class Duration>
+lines_from_chars_result
+lines_from_chars(const char* first, const char* last, date::sys_time<Duration>* out, std::size_t n) noexcept
+{
+    return lines_from_chars(detect_simd_isa(), first, last, out, n);
+}
+
+}
+
+#endif
@@ -0,0 +1,110 @@
+#include "timestamp_to_chars.h"
+
+namespace chrono_date
+{
+
+namespace detail
+{
+
+namespace
+{
+
+const char two_digits[] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+char* write_2(char* p, unsigned v) noexcept
+{
+    std::memcpy(p, two_digits + 2 * v, 2);
+    return p + 2;
+}
+
+unsigned digit_count(std::uint64_t v) noexcept
+{
+    unsigned n = 1;
+    while(v >= 10)
+    {
+        v /= 10;
+        ++n;
+    }
+    return n;
+}
+
+// v with at least min_width digits, padded with zeros
+char* write_padded(char* p, std::uint64_t v, unsigned min_width) noexcept
+{
+    const auto digits = digit_count(v);
+    const auto width = digits < min_width ? min_width : digits;
+    auto end = p + width;
+    auto q = end;
+    while(v >= 100)
+    {
+        q -= 2;
+        write_2(q, static_cast<unsigned>(v % 100));
+        v /= 100;
+    }
+    if(v >= 10)
+    {
+        q -= 2;
+        write_2(q, static_cast<unsigned>(v));
+    }
+    else
+    {
+        *--q = static_cast<char>('0' + v);
+    }
+    while(q != p)
+        *--q = '0';
+    return end;
+}
+
+}
+
+char* write_ymd(char* p, const date::year_month_day& ymd) noexcept
+{
+    auto y = static_cast<int>(ymd.year());
+    if(y < 0)
+    {
+        *p++ = '-';
+        y = -y;
+    }
+    p = write_padded(p, static_cast<std::uint64_t>(y), 4);
+    *p++ = '-';
+    p = write_padded(p, static_cast<unsigned>(ymd.month()), 2);
+    *p++ = '-';
+    p = write_padded(p, static_cast<unsigned>(ymd.day()), 2);
+    if(!ymd.ok())
+    {
+        static const char invalid[] = " is not a valid date";
+        std::memcpy(p, invalid, sizeof invalid - 1);
+        p += sizeof invalid - 1;
+    }
+    return p;
+}
+
+char* write_hms(char* p, bool negative, std::uint64_t h, unsigned m, unsigned s) noexcept
+{
+    if(negative)
+        *p++ = '-';
+    p = write_padded(p, h, 2);
+    *p++ = ':';
+    p = write_2(p, m);
+    *p++ = ':';
+    return write_2(p, s);
+}
+
+char* write_fraction(char* p, std::uint64_t v, unsigned width) noexcept
+{
+    return write_padded(p, v, width);
+}
+
+}
+
+}
@@ -0,0 +1,124 @@
+#ifndef CHRONO_DATE_TIMESTAMP_TO_CHARS_H
+#define CHRONO_DATE_TIMESTAMP_TO_CHARS_H
+
+// Formatting of dates, times of day and time points into a char buffer.
+//
+// The output is byte for byte what operator<< of date writes into a
+// default constructed stream, e.g. "1986-09-30 19:53:02.457", but nothing
+// is allocated and no locale is involved. Like std::to_chars the functions
+// return the end of the written characters, or errc::value_too_large and
+// last if the buffer is too small, in which case its content is unspecified.
+
+#include <date/date.h>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <system_error>
+#include <type_traits>
+
+namespace chrono_date
+{
+
+struct to_chars_result
+{
+    char* ptr;
+    std::errc ec;
+};
+
+namespace detail
+{
+
+// room for any year_month_day, including " is not a valid date"
+constexpr std::size_t ymd_chars = 32;
+// room for any hh_mm_ss: sign, hours of a 64 bit rep, minutes,
+// seconds and up to 18 fractional digits
+constexpr std::size_t hms_chars = 1 + 20 + 6 + 1 + 18;
+
+char* write_ymd(char* p, const date::year_month_day& ymd) noexcept;
+char* write_hms(char* p, bool negative, std::uint64_t h, unsigned m, unsigned s) noexcept;
+char* write_fraction(char* p, std::uint64_t v, unsigned width) noexcept;
+
+template<class Rep>
+std::uint64_t magnitude(Rep r) noexcept
+{
+    return r < 0 ? 0 - static_cast<std::uint64_t>(r) : static_cast<std::uint64_t>(r);
+}
+
+template<class Duration>
+char* write_hh_mm_ss(char* p, const date::hh_mm_ss<Duration>& t) noexcept
+{
+    p = write_hms(p,
+                  t.is_negative(),
+                  magnitude(t.hours().count()),
+                  static_cast<unsigned>(t.minutes().count()),
+                  static_cast<unsigned>(t.seconds().count()));
+    constexpr unsigned width = date::hh_mm_ss<Duration>::fractional_width;
+    if(width > 0)
+    {
+        *p++ = '.';
+        p = write_fraction(p, magnitude(t.subseconds().count()), width);
+    }
+    return p;
+}
+
+// formats with write into [first, last) if it surely fits, into a
+// buffer of the maximum size otherwise
+template<std::size_t max_size, class Write>
+to_chars_result bounded_write(char* first, char* last, Write write) noexcept
+{
+    if(static_cast<std::size_t>(last - first) >= max_size)
+        return {write(first), std::errc{}};
+    char buffer[max_size];
+    const auto end = write(buffer);
+    const auto n = static_cast<std::size_t>(end - buffer);
+    if(n > static_cast<std::size_t>(last - first))
+        return {last, std::errc::value_too_large};
+    std::memcpy(first, buffer, n);
+    return {first + n, std::errc{}};
+}
+
+}
+
+// like os << ymd
+inline to_chars_result to_chars(char* first, char* last, const date::year_month_day& ymd) noexcept
+{
+    return detail::bounded_write<detail::ymd_chars>(first, last, [&](char* p)
+    {
+        return detail::write_ymd(p, ymd);
+    });
+}
+
+// like os << t, for any integral duration, including ratios like ratio<1, 4>
+template<class Duration>
+to_chars_result to_chars(char* first, char* last, const date::hh_mm_ss<Duration>& t) noexcept
+{
+    return detail::bounded_write<detail::hms_chars>(first, last, [&](char* p)
+    {
+        return detail::write_hh_mm_ss(p, t);
+    });
+}
+
+// like os << tp
+template<class Duration>
+to_chars_result to_chars(char* first, char* last, const date::sys_time<Duration>& tp) noexcept
+{
+    static_assert(!std::chrono::treat_as_floating_point<typename Duration::rep>::value,
+                  "only integral durations can be formatted");
+    const auto dp = date::floor<date::days>(tp);
+    const auto ymd = date::year_month_day{dp};
+    if(!std::ratio_less<typename Duration::period, date::days::period>::value)
+        return to_chars(first, last, ymd);
+
+    const auto t = date::make_time(tp - dp);
+    return detail::bounded_write<detail::ymd_chars + 1 + detail::hms_chars>(first, last, [&](char* p)
+    {
+        p = detail::write_ymd(p, ymd);
+        *p++ = ' ';
+        return detail::write_hh_mm_ss(p, t);
+    });
+}
+
+}
+
+#endif
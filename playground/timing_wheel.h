@@ -0,0 +1,447 @@
+#ifndef CHRONO_DATE_TIMING_WHEEL_H
+#define CHRONO_DATE_TIMING_WHEEL_H
+
+// Timeouts of any duration type on a hierarchical timing wheel.
+//
+// Time is counted in Ticks since the origin of the wheel. Four levels of
+// 256 slots cover 2^32 ticks, a level l slot holding the timers whose
+// deadline shares all bits above the lowest 8 * (l + 1) with the current
+// tick; timers further away wait in an overflow slot. A slot is an array
+// of deadline, timer_id and value, so inserting appends to it, and
+// cascading and expiring read it front to back. Cancelling bumps the
+// generation of the timer_id, O(1), and its entry is dropped when the
+// slot is next touched. advance jumps, with the help of a bitmap of
+// occupied slots per level, straight to the next tick at which a slot
+// either expires or is cascaded one level down, and hands the values of
+// a slot to the callback as one batch.
+//
+// Slots keep their capacity and timer_ids are reused, so a wheel in a
+// steady state allocates nothing per timer. Deadlines are rounded up to
+// the next tick, a timer never fires early.
+//
+// A wheel is not thread safe. T is movable.
+//
+// With coroutine support, sleep_for and sleep_until suspend a coroutine
+// on a timing_wheel<std::coroutine_handle<>> until resume_expired
+// reaches its deadline.
+
+#include <date/date.h>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#if defined(__has_include)
+#if __has_include(<coroutine>) && defined(__cpp_impl_coroutine)
+#include <coroutine>
+#define CHRONO_DATE_HAS_COROUTINES 1
+#endif
+#endif
+
+namespace chrono_date
+{
+
+// handle of a scheduled timer, stays invalid after it fired or was cancelled
+struct timer_id
+{
+    std::uint32_t index = 0;
+    std::uint32_t generation = 0;
+};
+
+template<class T, class Tick = std::chrono::milliseconds, class Clock = std::chrono::steady_clock>
+class timing_wheel
+{
+public:
+    using value_type = T;
+    using tick = Tick;
+    using clock = Clock;
+    using time_point = typename Clock::time_point;
+
+    explicit timing_wheel(time_point origin = Clock::now(), std::size_t capacity = 0)
+        : origin_{origin}
+    {
+        generations_.reserve(capacity);
+        free_.reserve(capacity);
+        for(auto& level : occupied_)
+            level.fill(0);
+    }
+
+    // number of pending timers
+    std::size_t size() const noexcept
+    {
+        return size_;
+    }
+
+    bool empty() const noexcept
+    {
+        return size_ == 0;
+    }
+
+    // time up to which the wheel has expired timers
+    time_point now() const noexcept
+    {
+        return origin_ + std::chrono::duration_cast<typename Clock::duration>(ticks{static_cast<std::int64_t>(now_)});
+    }
+
+    // value is handed to advance as soon as it passes deadline
+    template<class Duration>
+    timer_id schedule(std::chrono::time_point<Clock, Duration> deadline, T value)
+    {
+        const auto d = date::ceil<ticks>(deadline - origin_).count();
+        const auto at = d > static_cast<std::int64_t>(now_) ? static_cast<std::uint64_t>(d) : now_ + 1;
+        std::uint32_t index;
+        if(!free_.empty())
+        {
+            index = free_.back();
+            free_.pop_back();
+        }
+        else
+        {
+            index = static_cast<std::uint32_t>(generations_.size());
+            generations_.push_back(1);
+        }
+        const auto id = timer_id{index, generations_[index]};
+        insert(entry{at, id, std::move(value)});
+        ++size_;
+        return id;
+    }
+
+    // value is handed to advance timeout after Clock::now()
+    template<class Rep, class Period>
+    timer_id schedule_after(std::chrono::duration<Rep, Period> timeout, T value)
+    {
+        return schedule(Clock::now() + timeout, std::move(value));
+    }
+
+    // false if the timer already fired or was cancelled
+    bool cancel(timer_id id)
+    {
+        if(!pending(id))
+            return false;
+        release(id.index);
+        --size_;
+        // the entry stays in its slot until it expires or is cascaded,
+        // unless there are more of those than pending timers
+        if(++cancelled_ > size_ + slots && !expiring_)
+            compact();
+        return true;
+    }
+
+    // f(T&&) for every timer with a deadline up to until, earlier ticks
+    // first, returns the number of expired timers
+    // f may schedule and cancel timers, but not advance. If f throws, the
+    // exception leaves advance with the wheel at the tick of the throw;
+    // the other timers of that tick count as expired and their values
+    // are dropped, later ones stay pending.
+    template<class F>
+    std::size_t advance(time_point until, F f)
+    {
+        const auto d = date::floor<ticks>(until - origin_).count();
+        if(d <= static_cast<std::int64_t>(now_))
+            return 0;
+        const auto target = static_cast<std::uint64_t>(d);
+        std::size_t expired = 0;
+        while(now_ < target)
+        {
+            if(size_ == 0)
+            {
+                now_ = target;
+                break;
+            }
+            now_ = next_event(target);
+            cascade();
+            expired += expire(f);
+        }
+        return expired;
+    }
+
+    template<class F>
+    std::size_t advance(F f)
+    {
+        return advance(Clock::now(), std::move(f));
+    }
+
+private:
+    using ticks = std::chrono::duration<std::int64_t, typename Tick::period>;
+
+    static constexpr unsigned levels = 4;
+    static constexpr unsigned slot_bits = 8;
+    static constexpr unsigned slots = 1u << slot_bits;
+    static constexpr unsigned overflow = levels * slots;
+
+    struct entry
+    {
+        std::uint64_t deadline;
+        timer_id id;
+        T value;
+    };
+
+    bool pending(timer_id id) const noexcept
+    {
+        return id.index < generations_.size() && generations_[id.index] == id.generation;
+    }
+
+    void release(std::uint32_t index)
+    {
+        // generation 0 marks the entries of cancelled timers in expire
+        if(++generations_[index] == 0)
+            generations_[index] = 1;
+        free_.push_back(index);
+    }
+
+    // slot of a deadline as seen from the current tick
+    unsigned slot_of(std::uint64_t deadline) const noexcept
+    {
+        for(unsigned level = 0; level < levels; ++level)
+        {
+            const auto shift = slot_bits * (level + 1);
+            if((deadline >> shift) == (now_ >> shift))
+                return level * slots + static_cast<unsigned>((deadline >> (shift - slot_bits)) & (slots - 1));
+        }
+        return overflow;
+    }
+
+    void insert(entry&& e)
+    {
+        const auto slot = slot_of(e.deadline);
+        slots_[slot].push_back(std::move(e));
+        if(slot != overflow)
+            occupied_[slot / slots][(slot % slots) / 64] |= std::uint64_t{1} << (slot % 64);
+    }
+
+    void clear(unsigned slot) noexcept
+    {
+        slots_[slot].clear();
+        if(slot != overflow)
+            occupied_[slot / slots][(slot % slots) / 64] &= ~(std::uint64_t{1} << (slot % 64));
+    }
+
+    // first occupied slot of level after slot, slots if there is none
+    unsigned next_occupied(unsigned level, unsigned slot) const noexcept
+    {
+        for(auto s = slot + 1; s < slots;)
+        {
+            const auto word = occupied_[level][s / 64] >> (s % 64);
+            if(word != 0)
+                return s + count_trailing_zeros(word);
+            s = (s / 64 + 1) * 64;
+        }
+        return slots;
+    }
+
+    static unsigned count_trailing_zeros(std::uint64_t word) noexcept
+    {
+#if defined(__GNUC__)
+        return static_cast<unsigned>(__builtin_ctzll(word));
+#else
+        unsigned n = 0;
+        while((word & 1) == 0)
+        {
+            word >>= 1;
+            ++n;
+        }
+        return n;
+#endif
+    }
+
+    // the next tick after now_, but not after target, at which a slot
+    // expires or is cascaded
+    std::uint64_t next_event(std::uint64_t target) const noexcept
+    {
+        // nothing above level 0 happens before its next turn
+        const auto turn = ((now_ >> slot_bits) + 1) << slot_bits;
+        const auto slot = next_occupied(0, static_cast<unsigned>(now_ & (slots - 1)));
+        const auto first = slot < slots ? (turn - slots) + slot : turn;
+        if(first < turn || target < turn)
+            return first < target ? first : target;
+
+        auto next = target;
+        for(unsigned level = 1; level < levels; ++level)
+        {
+            const auto shift = slot_bits * level;
+            const auto s = next_occupied(level, static_cast<unsigned>((now_ >> shift) & (slots - 1)));
+            if(s < slots)
+            {
+                const auto above = (now_ >> (shift + slot_bits)) << (shift + slot_bits);
+                const auto at = above + (std::uint64_t{s} << shift);
+                if(at < next)
+                    next = at;
+            }
+        }
+        if(!slots_[overflow].empty())
+        {
+            const auto wrap = ((now_ >> (levels * slot_bits)) + 1) << (levels * slot_bits);
+            if(wrap < next)
+                next = wrap;
+        }
+        return next;
+    }
+
+    // moves the timers of the slots that begin at now_ one level down
+    void cascade()
+    {
+        if((now_ & ((std::uint64_t{1} << (levels * slot_bits)) - 1)) == 0)
+            reinsert(overflow);
+        for(auto level = levels - 1; level > 0; --level)
+        {
+            const auto shift = slot_bits * level;
+            if((now_ & ((std::uint64_t{1} << shift) - 1)) == 0)
+                reinsert(level * slots + static_cast<unsigned>((now_ >> shift) & (slots - 1)));
+        }
+    }
+
+    void reinsert(unsigned slot)
+    {
+        // entries of a level slot only go to lower levels, those of the
+        // overflow slot may stay in it
+        auto& entries = slot == overflow ? batch_ : slots_[slot];
+        if(slot == overflow)
+            batch_.swap(slots_[overflow]);
+        for(auto& e : entries)
+        {
+            if(pending(e.id))
+                insert(std::move(e));
+            else
+                --cancelled_;
+        }
+        if(slot == overflow)
+            batch_.clear();
+        else
+            clear(slot);
+    }
+
+    template<class F>
+    std::size_t expire(F& f)
+    {
+        // timers scheduled by f go to later ticks, never to this slot
+        const auto slot = static_cast<unsigned>(now_ & (slots - 1));
+        auto& entries = slots_[slot];
+        std::size_t expired = 0;
+        for(auto& e : entries)
+        {
+            if(pending(e.id))
+            {
+                release(e.id.index);
+                --size_;
+                ++expired;
+            }
+            else
+            {
+                --cancelled_;
+                e.id.generation = 0;
+            }
+        }
+        // all timers of the batch count as expired before the first f,
+        // and the batch is gone after the last, also if an f throws
+        struct batch_guard
+        {
+            ~batch_guard()
+            {
+                wheel.expiring_ = false;
+                wheel.clear(slot);
+            }
+
+            timing_wheel& wheel;
+            unsigned slot;
+        };
+        expiring_ = true;
+        const batch_guard guard{*this, slot};
+        for(auto& e : entries)
+            if(e.id.generation != 0)
+                f(std::move(e.value));
+        return expired;
+    }
+
+    // drops the entries of cancelled timers
+    void compact()
+    {
+        for(auto& slot : slots_)
+        {
+            const auto end = std::remove_if(slot.begin(), slot.end(), [this](const entry& e) { return !pending(e.id); });
+            cancelled_ -= static_cast<std::size_t>(slot.end() - end);
+            slot.erase(end, slot.end());
+        }
+    }
+
+    time_point origin_;
+    // last tick that expired
+    std::uint64_t now_ = 0;
+    std::size_t size_ = 0;
+    // cancelled timers whose entries are still in a slot
+    std::size_t cancelled_ = 0;
+    // generation of every timer_id index, and the indices not in use
+    std::vector<std::uint32_t> generations_;
+    std::vector<std::uint32_t> free_;
+    // levels * slots slots and the overflow slot
+    std::array<std::vector<entry>, levels * slots + 1> slots_;
+    std::array<std::array<std::uint64_t, slots / 64>, levels> occupied_;
+    // entries of the overflow slot while they are cascaded
+    std::vector<entry> batch_;
+    bool expiring_ = false;
+};
+
+#if defined(CHRONO_DATE_HAS_COROUTINES)
+
+template<class Tick, class Clock>
+using coroutine_wheel = timing_wheel<std::coroutine_handle<>, Tick, Clock>;
+
+template<class Tick, class Clock>
+class wheel_sleep
+{
+public:
+    wheel_sleep(coroutine_wheel<Tick, Clock>& wheel, typename Clock::time_point deadline)
+        : wheel_{wheel}
+        , deadline_{deadline}
+    {
+    }
+
+    bool await_ready() const noexcept
+    {
+        return deadline_ <= wheel_.now();
+    }
+
+    void await_suspend(std::coroutine_handle<> h)
+    {
+        wheel_.schedule(deadline_, h);
+    }
+
+    void await_resume() const noexcept
+    {
+    }
+
+private:
+    coroutine_wheel<Tick, Clock>& wheel_;
+    typename Clock::time_point deadline_;
+};
+
+// co_await sleep_until(wheel, deadline)
+template<class Tick, class Clock, class Duration>
+wheel_sleep<Tick, Clock> sleep_until(coroutine_wheel<Tick, Clock>& wheel,
+                                     std::chrono::time_point<Clock, Duration> deadline)
+{
+    return {wheel, std::chrono::time_point_cast<typename Clock::duration>(deadline)};
+}
+
+// co_await sleep_for(wheel, timeout), timeout after Clock::now()
+template<class Tick, class Clock, class Rep, class Period>
+wheel_sleep<Tick, Clock> sleep_for(coroutine_wheel<Tick, Clock>& wheel, std::chrono::duration<Rep, Period> timeout)
+{
+    return sleep_until(wheel, Clock::now() + timeout);
+}
+
+// resumes the coroutines whose sleep ended up to until; if one throws,
+// the wheel is left as by a throwing callback of advance
+template<class Tick, class Clock>
+std::size_t resume_expired(coroutine_wheel<Tick, Clock>& wheel, typename Clock::time_point until = Clock::now())
+{
+    return wheel.advance(until, [](std::coroutine_handle<> h) { h.resume(); });
+}
+
+#endif
+
+}
+
+#endif
@@ -0,0 +1,76 @@
+// Compiles the time zone database date loads into a tzdb_image.
+//
+// usage: tzdb_compile [-j threads] [--trace] <image> [first year] [last year]
+//
+// The image covers the years [first year, last year), 1850 to 2100 by default.
+// The zones are compiled on one thread per hardware thread unless -j says
+// otherwise; --trace prints what each zone took.
+
+#include "tzdb_image.h"
+#include <date/date.h>
+#include <date/tz.h>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <string>
+
+int main(int argc, char* argv[])
+{
+    using namespace date;
+
+    const auto usage = "usage: tzdb_compile [-j threads] [--trace] <image> [first year] [last year]\n";
+    chrono_date::tzdb_image_options options;
+    options.threads = 0;
+    int arg = 1;
+    for(; arg < argc && argv[arg][0] == '-'; ++arg)
+    {
+        if(std::strcmp(argv[arg], "-j") == 0 && arg + 1 < argc)
+            options.threads = static_cast<unsigned>(std::atoi(argv[++arg]));
+        else if(std::strcmp(argv[arg], "--trace") == 0)
+            options.trace = [](const chrono_date::zone_compile_trace& t)
+            {
+                std::cout << t.zone << ": " << t.infos << " intervals, "
+                          << std::chrono::duration_cast<std::chrono::microseconds>(t.elapsed).count()
+                          << " us on worker " << t.worker << '\n';
+            };
+        else
+        {
+            std::cerr << usage;
+            return EXIT_FAILURE;
+        }
+    }
+    argc -= arg - 1;
+    argv += arg - 1;
+
+    if(argc < 2 || argc > 4)
+    {
+        std::cerr << usage;
+        return EXIT_FAILURE;
+    }
+    const auto first = year{argc > 2 ? std::atoi(argv[2]) : 1850};
+    const auto last  = year{argc > 3 ? std::atoi(argv[3]) : 2100};
+    if(!first.ok() || !last.ok() || first >= last)
+    {
+        std::cerr << "invalid range of years\n";
+        return EXIT_FAILURE;
+    }
+
+    try
+    {
+        const auto& db = get_tzdb();
+        chrono_date::write_tzdb_image(db, argv[1], sys_days{first / jan / 1}, sys_days{last / jan / 1}, options);
+        const chrono_date::tzdb_image image{argv[1]};
+        std::cout << "tzdata " << image.version()
+                  << ": " << image.zone_count() << " zones"
+                  << ", " << db.links.size() << " links"
+                  << ", " << image.size_bytes() << " bytes\n";
+    }
+    catch(const std::exception& e)
+    {
+        std::cerr << e.what() << '\n';
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,486 @@
+#include "tzdb_image.h"
+#include "metrics.h"
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#if defined(_WIN32)
+#include <memory>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace chrono_date
+{
+
+namespace
+{
+
+constexpr char image_magic[8] = {'c', 'h', 'r', 'd', 't', 'z', 'd', 'b'};
+constexpr std::uint32_t image_byte_order = 0x01020304;
+
+std::uint64_t align8(std::uint64_t n)
+{
+    return (n + 7) & ~std::uint64_t{7};
+}
+
+class string_pool
+{
+public:
+    std::uint32_t add(const std::string& s)
+    {
+        const auto found = offsets_.find(s);
+        if(found != offsets_.end())
+            return found->second;
+        const auto at = static_cast<std::uint32_t>(chars_.size());
+        chars_.insert(chars_.end(), s.begin(), s.end());
+        chars_.push_back('\0');
+        offsets_.emplace(s, at);
+        return at;
+    }
+
+    const std::vector<char>& chars() const
+    {
+        return chars_;
+    }
+
+private:
+    std::vector<char> chars_;
+    std::map<std::string, std::uint32_t> offsets_;
+};
+
+template<class T>
+void write_section(std::ofstream& out, const std::vector<T>& v)
+{
+    out.write(reinterpret_cast<const char*>(v.data()),
+              static_cast<std::streamsize>(v.size() * sizeof(T)));
+    const auto bytes = v.size() * sizeof(T);
+    static const char zeros[8] = {};
+    out.write(zeros, static_cast<std::streamsize>(align8(bytes) - bytes));
+}
+
+// the intervals of a zone in [first, last), compiled independently of
+// the other zones
+struct zone_infos
+{
+    std::vector<date::sys_info> infos;
+    zone_compile_trace trace;
+    std::exception_ptr error;
+};
+
+void compile_zone(const date::time_zone& tz, date::sys_seconds first, date::sys_seconds last,
+                  unsigned worker, zone_infos& out)
+{
+    const auto start = std::chrono::steady_clock::now();
+    try
+    {
+        auto info = tz.get_info(first);
+        for(;;)
+        {
+            out.infos.push_back(info);
+            if(info.end >= last)
+                break;
+            info = tz.get_info(info.end);
+        }
+    }
+    catch(...)
+    {
+        out.error = std::current_exception();
+    }
+    out.trace = {tz.name(), out.infos.size(), std::chrono::steady_clock::now() - start, worker};
+}
+
+// every zone of db, on threads workers taking the next zone not yet taken
+std::vector<zone_infos> compile_zones(const date::tzdb& db, date::sys_seconds first, date::sys_seconds last,
+                                      unsigned threads)
+{
+    std::vector<zone_infos> zones(db.zones.size());
+    std::atomic<std::size_t> next{0};
+    const auto work = [&](unsigned worker)
+    {
+        for(auto i = next++; i < zones.size(); i = next++)
+            compile_zone(db.zones[i], first, last, worker, zones[i]);
+    };
+    if(threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = static_cast<unsigned>(std::min<std::size_t>(threads, std::max<std::size_t>(zones.size(), 1)));
+    std::vector<std::thread> pool;
+    pool.reserve(threads - 1);
+    for(unsigned w = 1; w < threads; ++w)
+        pool.emplace_back(work, w);
+    work(0);
+    for(auto& t : pool)
+        t.join();
+    return zones;
+}
+
+}
+
+void write_tzdb_image(const date::tzdb& db,
+                      const std::string& path,
+                      date::sys_seconds first,
+                      date::sys_seconds last)
+{
+    write_tzdb_image(db, path, first, last, tzdb_image_options{});
+}
+
+void write_tzdb_image(const date::tzdb& db,
+                      const std::string& path,
+                      date::sys_seconds first,
+                      date::sys_seconds last,
+                      const tzdb_image_options& options)
+{
+    const metric_timer timer{metric_histogram::tzdb_image_write};
+    const auto compiled = compile_zones(db, first, last, options.threads);
+    for(const auto& c : compiled)
+    {
+        if(options.trace)
+            options.trace(c.trace);
+        if(c.error)
+            std::rethrow_exception(c.error);
+    }
+
+    string_pool strings;
+    std::vector<image::zone_record> zones;
+    std::vector<image::name_record> names;
+    std::vector<image::type_record> types;
+    std::vector<std::int64_t> begins;
+    std::vector<std::uint16_t> type_index;
+    std::map<std::tuple<std::int32_t, std::int16_t, std::string>, std::uint16_t> type_ids;
+
+    // merged in the order of the zones, which fixes the ids of the types
+    // and the offsets of the strings
+    for(const auto& c : compiled)
+    {
+        image::zone_record z{};
+        z.name = strings.add(c.trace.zone);
+        z.first_info = static_cast<std::uint32_t>(type_index.size());
+        z.first_begin = static_cast<std::uint32_t>(begins.size());
+
+        for(const auto& info : c.infos)
+        {
+            const auto key = std::make_tuple(static_cast<std::int32_t>(info.offset.count()),
+                                             static_cast<std::int16_t>(info.save.count()),
+                                             info.abbrev);
+            auto id = type_ids.find(key);
+            if(id == type_ids.end())
+            {
+                if(types.size() > UINT16_MAX)
+                    throw std::runtime_error("too many distinct zone types for a tzdb image");
+                id = type_ids.emplace(key, static_cast<std::uint16_t>(types.size())).first;
+                types.push_back({std::get<0>(key), std::get<1>(key), 0});
+                const auto abbrev = strings.add(info.abbrev);
+                if(abbrev > UINT16_MAX)
+                    throw std::runtime_error("abbreviations do not fit into a tzdb image");
+                types.back().abbrev = static_cast<std::uint16_t>(abbrev);
+            }
+            begins.push_back(info.begin.time_since_epoch().count());
+            type_index.push_back(id->second);
+        }
+        begins.push_back(c.infos.back().end.time_since_epoch().count());
+        z.info_count = static_cast<std::uint32_t>(type_index.size()) - z.first_info;
+        names.push_back({z.name, static_cast<std::uint32_t>(zones.size())});
+        zones.push_back(z);
+    }
+
+    for(const auto& link : db.links)
+    {
+        const auto& target = db.locate_zone(link.target())->name();
+        const auto z = std::lower_bound(db.zones.begin(), db.zones.end(), target,
+                                        [](const date::time_zone& tz, const std::string& n)
+                                        {
+                                            return tz.name() < n;
+                                        });
+        names.push_back({strings.add(link.name()), static_cast<std::uint32_t>(z - db.zones.begin())});
+    }
+
+    const auto& chars = strings.chars();
+    std::sort(names.begin(), names.end(),
+              [&](const image::name_record& a, const image::name_record& b)
+              {
+                  return std::strcmp(&chars[a.name], &chars[b.name]) < 0;
+              });
+
+    image::header h{};
+    std::memcpy(h.magic, image_magic, sizeof h.magic);
+    h.format = tzdb_image_format;
+    h.byte_order = image_byte_order;
+    db.version.copy(h.version, sizeof h.version - 1);
+    h.first = first.time_since_epoch().count();
+    h.last = last.time_since_epoch().count();
+    h.zone_count = static_cast<std::uint32_t>(zones.size());
+    h.name_count = static_cast<std::uint32_t>(names.size());
+    h.type_count = static_cast<std::uint32_t>(types.size());
+    h.info_count = static_cast<std::uint32_t>(type_index.size());
+    h.begin_count = static_cast<std::uint32_t>(begins.size());
+    h.string_size = static_cast<std::uint32_t>(chars.size());
+    h.zones_at = align8(sizeof h);
+    h.names_at = h.zones_at + align8(zones.size() * sizeof(image::zone_record));
+    h.types_at = h.names_at + align8(names.size() * sizeof(image::name_record));
+    h.begins_at = h.types_at + align8(types.size() * sizeof(image::type_record));
+    h.type_index_at = h.begins_at + align8(begins.size() * sizeof(std::int64_t));
+    h.strings_at = h.type_index_at + align8(type_index.size() * sizeof(std::uint16_t));
+    h.size = h.strings_at + align8(chars.size());
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if(!out)
+        throw std::runtime_error("can not write tzdb image " + path);
+    write_section(out, std::vector<image::header>{h});
+    write_section(out, zones);
+    write_section(out, names);
+    write_section(out, types);
+    write_section(out, begins);
+    write_section(out, type_index);
+    write_section(out, chars);
+    if(!out.flush())
+        throw std::runtime_error("can not write tzdb image " + path);
+}
+
+compiled_zone::compiled_zone(const tzdb_image& image, const image::zone_record& record)
+    : name_(image.section<char>(image.header_->strings_at) + record.name)
+    , begins_(image.section<std::int64_t>(image.header_->begins_at) + record.first_begin)
+    , type_index_(image.section<std::uint16_t>(image.header_->type_index_at) + record.first_info)
+    , types_(image.section<image::type_record>(image.header_->types_at))
+    , strings_(image.section<char>(image.header_->strings_at))
+    , count_(record.info_count)
+{
+}
+
+std::size_t compiled_zone::find_info(std::int64_t sys_secs) const noexcept
+{
+    // begins_[count_] is the end of the last info
+    const auto i = std::upper_bound(begins_ + 1, begins_ + count_, sys_secs) - (begins_ + 1);
+    return static_cast<std::size_t>(i);
+}
+
+date::sys_info compiled_zone::info(std::size_t i) const
+{
+    const auto& type = types_[type_index_[i]];
+    date::sys_info r;
+    r.begin = date::sys_seconds{std::chrono::seconds{begins_[i]}};
+    r.end = date::sys_seconds{std::chrono::seconds{begins_[i + 1]}};
+    r.offset = std::chrono::seconds{type.offset};
+    r.save = std::chrono::minutes{type.save};
+    r.abbrev = strings_ + type.abbrev;
+    return r;
+}
+
+tzdb_image::tzdb_image(const std::string& path, tzdb_loading loading)
+{
+    const metric_timer timer{metric_histogram::tzdb_image_open};
+#if defined(_WIN32)
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if(!in)
+        throw std::runtime_error("can not open tzdb image " + path);
+    size_ = static_cast<std::size_t>(in.tellg());
+    std::unique_ptr<char[]> buffer(new char[size_]);
+    in.seekg(0);
+    if(!in.read(buffer.get(), static_cast<std::streamsize>(size_)))
+        throw std::runtime_error("can not read tzdb image " + path);
+    data_ = buffer.release();
+#else
+    const auto fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if(fd < 0)
+        throw std::runtime_error("can not open tzdb image " + path);
+    struct stat st;
+    if(::fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        ::close(fd);
+        throw std::runtime_error("can not open tzdb image " + path);
+    }
+    size_ = static_cast<std::size_t>(st.st_size);
+    void* p = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if(p == MAP_FAILED)
+        throw std::runtime_error("can not map tzdb image " + path);
+    data_ = static_cast<const char*>(p);
+    mapped_ = true;
+#endif
+    try
+    {
+        validate(loading);
+        header_ = section<image::header>(0);
+        zones_.reset(new std::atomic<const compiled_zone*>[header_->zone_count]());
+        if(loading == tzdb_loading::eager)
+            for(std::size_t i = 0; i < header_->zone_count; ++i)
+                load_zone(i);
+    }
+    catch(...)
+    {
+        release();
+        throw;
+    }
+}
+
+tzdb_image::~tzdb_image()
+{
+    release();
+}
+
+void tzdb_image::release() noexcept
+{
+    if(zones_ != nullptr)
+        for(std::size_t i = 0; i < header_->zone_count; ++i)
+            delete zones_[i].load(std::memory_order_relaxed);
+    zones_.reset();
+    if(data_ == nullptr)
+        return;
+#if defined(_WIN32)
+    delete[] data_;
+#else
+    if(mapped_)
+        ::munmap(const_cast<char*>(data_), size_);
+#endif
+    data_ = nullptr;
+}
+
+void tzdb_image::validate(tzdb_loading loading) const
+{
+    const auto fail = []
+    {
+        throw std::runtime_error("not a compatible tzdb image");
+    };
+    if(size_ < sizeof(image::header))
+        fail();
+    const auto h = section<image::header>(0);
+    if(std::memcmp(h->magic, image_magic, sizeof h->magic) != 0 ||
+       h->format != tzdb_image_format ||
+       h->byte_order != image_byte_order ||
+       h->size != size_)
+        fail();
+
+    const auto fits = [&](std::uint64_t at, std::uint64_t count, std::uint64_t size)
+    {
+        return at % 8 == 0 && at <= size_ && count <= (size_ - at) / size;
+    };
+    if(!fits(h->zones_at, h->zone_count, sizeof(image::zone_record)) ||
+       !fits(h->names_at, h->name_count, sizeof(image::name_record)) ||
+       !fits(h->types_at, h->type_count, sizeof(image::type_record)) ||
+       !fits(h->begins_at, h->begin_count, sizeof(std::int64_t)) ||
+       !fits(h->type_index_at, h->info_count, sizeof(std::uint16_t)) ||
+       !fits(h->strings_at, h->string_size, 1) ||
+       h->string_size == 0 ||
+       section<char>(h->strings_at)[h->string_size - 1] != '\0')
+        fail();
+
+    const auto zones = section<image::zone_record>(h->zones_at);
+    for(std::uint32_t i = 0; i < h->zone_count; ++i)
+    {
+        const auto& z = zones[i];
+        if(z.info_count == 0 ||
+           z.name >= h->string_size ||
+           std::uint64_t{z.first_info} + z.info_count > h->info_count ||
+           std::uint64_t{z.first_begin} + z.info_count + 1 > h->begin_count)
+            fail();
+    }
+    const auto names = section<image::name_record>(h->names_at);
+    for(std::uint32_t i = 0; i < h->name_count; ++i)
+        if(names[i].name >= h->string_size || names[i].zone >= h->zone_count)
+            fail();
+    const auto types = section<image::type_record>(h->types_at);
+    for(std::uint32_t i = 0; i < h->type_count; ++i)
+        if(types[i].abbrev >= h->string_size)
+            fail();
+    // the bulk of the image, lazily checked per zone
+    if(loading == tzdb_loading::eager)
+    {
+        const auto type_index = section<std::uint16_t>(h->type_index_at);
+        for(std::uint32_t i = 0; i < h->info_count; ++i)
+            if(type_index[i] >= h->type_count)
+                fail();
+    }
+}
+
+void tzdb_image::validate_zone(std::size_t i) const
+{
+    const auto& z = section<image::zone_record>(header_->zones_at)[i];
+    const auto type_index = section<std::uint16_t>(header_->type_index_at) + z.first_info;
+    for(std::uint32_t j = 0; j < z.info_count; ++j)
+        if(type_index[j] >= header_->type_count)
+            throw std::runtime_error("not a compatible tzdb image");
+}
+
+const compiled_zone& tzdb_image::load_zone(std::size_t i) const
+{
+    const metric_timer timer{metric_histogram::tzdb_image_zone_load};
+    validate_zone(i);
+    const auto& record = section<image::zone_record>(header_->zones_at)[i];
+    std::unique_ptr<const compiled_zone> z{new compiled_zone(*this, record)};
+    const compiled_zone* expected = nullptr;
+    if(!zones_[i].compare_exchange_strong(expected, z.get(), std::memory_order_acq_rel))
+        return *expected;
+
+    // the object, its name if not stored inline, and its part of the image
+    const auto object = reinterpret_cast<const char*>(z.get());
+    const auto name = z->name().data();
+    auto bytes = sizeof(compiled_zone) + record.info_count * (sizeof(std::int64_t) + sizeof(std::uint16_t)) + sizeof(std::int64_t);
+    if(name < object || name >= object + sizeof(compiled_zone))
+        bytes += z->name().capacity() + 1;
+    loaded_zones_.fetch_add(1, std::memory_order_relaxed);
+    count_metric(metric_counter::tzdb_image_zone_loads);
+    loaded_bytes_.fetch_add(bytes, std::memory_order_relaxed);
+    return *z.release();
+}
+
+tzdb_memory_stats tzdb_image::memory_stats() const noexcept
+{
+    tzdb_memory_stats stats;
+    stats.zones = header_->zone_count;
+    stats.loaded_zones = loaded_zones_.load(std::memory_order_relaxed);
+    stats.loaded_bytes = loaded_bytes_.load(std::memory_order_relaxed);
+    stats.index_bytes = sizeof(image::header) +
+                        header_->zone_count * (sizeof(std::atomic<const compiled_zone*>) + sizeof(image::zone_record)) +
+                        header_->name_count * sizeof(image::name_record) +
+                        header_->string_size;
+    return stats;
+}
+
+std::string tzdb_image::version() const
+{
+    const auto end = std::find(header_->version, header_->version + sizeof header_->version, '\0');
+    return std::string(header_->version, end);
+}
+
+date::sys_seconds tzdb_image::first() const noexcept
+{
+    return date::sys_seconds{std::chrono::seconds{header_->first}};
+}
+
+date::sys_seconds tzdb_image::last() const noexcept
+{
+    return date::sys_seconds{std::chrono::seconds{header_->last}};
+}
+
+const compiled_zone* tzdb_image::find_zone(const std::string& name) const
+{
+    const auto names = section<image::name_record>(header_->names_at);
+    const auto strings = section<char>(header_->strings_at);
+    const auto end = names + header_->name_count;
+    const auto found = std::lower_bound(names, end, name,
+                                        [&](const image::name_record& r, const std::string& n)
+                                        {
+                                            return std::strcmp(strings + r.name, n.c_str()) < 0;
+                                        });
+    if(found == end || name != strings + found->name)
+        return nullptr;
+    return &zone(found->zone);
+}
+
+const compiled_zone* tzdb_image::locate_zone(const std::string& name) const
+{
+    const auto zone = find_zone(name);
+    if(zone == nullptr)
+        throw std::runtime_error(name + " not found in timezone database");
+    return zone;
+}
+
+}
@@ -0,0 +1,266 @@
+#ifndef CHRONO_DATE_TZDB_IMAGE_H
+#define CHRONO_DATE_TZDB_IMAGE_H
+
+// Precompiled, memory mapped time zone database.
+//
+// write_tzdb_image turns a parsed date::tzdb into a binary image which
+// holds, for every zone, the sys_info intervals of a range of years.
+// tzdb_image maps such an image read only, so all processes using the
+// same file share its pages. No text is parsed, but opened eagerly, the
+// default, every zone is decoded and validated and its name copied into
+// a zone on the heap, which makes the whole image resident.
+//
+// Opened lazily, only the name index is set up and every zone is decoded
+// and validated on its first use, so only the pages of the zones a process
+// uses become resident.
+//
+// Image layout, all integers in host byte order, sections 8 byte aligned:
+//   image_header
+//   zone_record  [zone_count]        name, first info, number of infos
+//   name_record  [name_count]        zones and links, sorted by name
+//   type_record  [type_count]        distinct offset/save/abbrev triples
+//   std::int64_t [begin_count]       begin of each info, plus the end of
+//                                    the last info of every zone
+//   std::uint16_t[info_count]        type of each info
+//   char         [string_size]       0 terminated names and abbreviations
+
+#include "zone_base.h"
+#include <date/tz.h>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace chrono_date
+{
+
+// incremented on every incompatible change of the layout
+constexpr std::uint32_t tzdb_image_format = 1;
+
+namespace image
+{
+
+struct header
+{
+    char          magic[8];
+    std::uint32_t format;
+    std::uint32_t byte_order;
+    char          version[16];
+    std::int64_t  first;
+    std::int64_t  last;
+    std::uint32_t zone_count;
+    std::uint32_t name_count;
+    std::uint32_t type_count;
+    std::uint32_t info_count;
+    std::uint32_t begin_count;
+    std::uint32_t string_size;
+    std::uint64_t zones_at;
+    std::uint64_t names_at;
+    std::uint64_t types_at;
+    std::uint64_t begins_at;
+    std::uint64_t type_index_at;
+    std::uint64_t strings_at;
+    std::uint64_t size;
+};
+
+struct zone_record
+{
+    std::uint32_t name;
+    std::uint32_t first_info;
+    std::uint32_t info_count;
+    std::uint32_t first_begin;
+};
+
+struct name_record
+{
+    std::uint32_t name;
+    std::uint32_t zone;
+};
+
+struct type_record
+{
+    std::int32_t  offset;
+    std::int16_t  save;
+    std::uint16_t abbrev;
+};
+
+}
+
+// what compiling one zone into an image took
+struct zone_compile_trace
+{
+    std::string zone;
+    std::size_t infos;
+    std::chrono::nanoseconds elapsed;
+    // worker that compiled the zone, 0 is the calling thread
+    unsigned worker;
+};
+
+struct tzdb_image_options
+{
+    // zones compiled at the same time, 0 for one per hardware thread
+    unsigned threads = 1;
+    // called for every zone, in the order of db.zones, from the calling
+    // thread once all of them are compiled
+    std::function<void(const zone_compile_trace&)> trace;
+};
+
+// Compiles db into an image covering [first, last).
+// The zones cover the intervals of date that overlap that range, lookups
+// outside of them throw std::runtime_error.
+void write_tzdb_image(const date::tzdb& db,
+                      const std::string& path,
+                      date::sys_seconds first,
+                      date::sys_seconds last);
+
+// The same, compiling the zones on a pool of options.threads threads.
+// date builds the transitions of a zone on its first use, which is most
+// of the cost of a cold start; the zones are merged in the order of
+// db.zones, so the image is the same byte for byte for any number of
+// threads.
+void write_tzdb_image(const date::tzdb& db,
+                      const std::string& path,
+                      date::sys_seconds first,
+                      date::sys_seconds last,
+                      const tzdb_image_options& options);
+
+class tzdb_image;
+
+// a zone of a tzdb_image, usable like date::time_zone
+class compiled_zone : public zone_base<compiled_zone>
+{
+public:
+    const std::string& name() const noexcept
+    {
+        return name_;
+    }
+
+    std::size_t info_count() const noexcept
+    {
+        return count_;
+    }
+
+    std::size_t find_info(std::int64_t sys_secs) const noexcept;
+
+    std::int64_t info_begin(std::size_t i) const noexcept
+    {
+        return begins_[i];
+    }
+
+    std::int64_t info_end(std::size_t i) const noexcept
+    {
+        return begins_[i + 1];
+    }
+
+    std::int32_t info_offset(std::size_t i) const noexcept
+    {
+        return types_[type_index_[i]].offset;
+    }
+
+    date::sys_info info(std::size_t i) const;
+
+private:
+    friend class tzdb_image;
+
+    compiled_zone(const tzdb_image& image, const image::zone_record& record);
+
+    std::string name_;
+    const std::int64_t* begins_;
+    const std::uint16_t* type_index_;
+    const image::type_record* types_;
+    const char* strings_;
+    std::size_t count_;
+};
+
+enum class tzdb_loading
+{
+    // every zone when the image is opened
+    eager,
+    // every zone on its first use
+    lazy
+};
+
+struct tzdb_memory_stats
+{
+    std::size_t zones;
+    std::size_t loaded_zones;
+    // heap and image bytes of the loaded zones
+    std::size_t loaded_bytes;
+    // heap and image bytes of the name index
+    std::size_t index_bytes;
+};
+
+class tzdb_image
+{
+public:
+    // maps the image at path, throws std::runtime_error if it can not be
+    // opened or was not written by a compatible write_tzdb_image
+    explicit tzdb_image(const std::string& path, tzdb_loading loading = tzdb_loading::eager);
+    ~tzdb_image();
+
+    tzdb_image(const tzdb_image&) = delete;
+    tzdb_image& operator=(const tzdb_image&) = delete;
+
+    // tzdata version the image was compiled from
+    std::string version() const;
+
+    // covered range
+    date::sys_seconds first() const noexcept;
+    date::sys_seconds last() const noexcept;
+
+    std::size_t zone_count() const noexcept
+    {
+        return header_->zone_count;
+    }
+
+    // i-th zone in order of names, loaded if it is not yet
+    // throws std::runtime_error if its part of the image is corrupt
+    const compiled_zone& zone(std::size_t i) const
+    {
+        const auto z = zones_[i].load(std::memory_order_acquire);
+        return z != nullptr ? *z : load_zone(i);
+    }
+
+    // zone or link name to zone, nullptr if there is no such name
+    const compiled_zone* find_zone(const std::string& name) const;
+
+    // like find_zone, but throws std::runtime_error like date::locate_zone
+    const compiled_zone* locate_zone(const std::string& name) const;
+
+    std::size_t size_bytes() const noexcept
+    {
+        return size_;
+    }
+
+    tzdb_memory_stats memory_stats() const noexcept;
+
+private:
+    friend class compiled_zone;
+
+    template<class T>
+    const T* section(std::uint64_t at) const noexcept
+    {
+        return reinterpret_cast<const T*>(data_ + at);
+    }
+
+    void validate(tzdb_loading loading) const;
+    void validate_zone(std::size_t i) const;
+    const compiled_zone& load_zone(std::size_t i) const;
+    void release() noexcept;
+
+    const char* data_ = nullptr;
+    std::size_t size_ = 0;
+    bool mapped_ = false;
+    const image::header* header_ = nullptr;
+    // set once by the first thread using a zone
+    std::unique_ptr<std::atomic<const compiled_zone*>[]> zones_;
+    mutable std::atomic<std::size_t> loaded_zones_{0};
+    mutable std::atomic<std::size_t> loaded_bytes_{0};
+};
+
+}
+
+#endif
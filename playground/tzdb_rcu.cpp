@@ -0,0 +1,79 @@
+#include "tzdb_rcu.h"
+#include <limits>
+
+namespace chrono_date
+{
+
+namespace detail
+{
+
+// epoch 0 marks a thread that does not read
+std::atomic<std::uint64_t> rcu_epoch{1};
+
+namespace
+{
+
+// readers are only ever added; the slot of an exited thread is reused
+std::atomic<rcu_reader*> rcu_readers{nullptr};
+
+struct rcu_reader_owner
+{
+    rcu_reader* reader = nullptr;
+
+    ~rcu_reader_owner()
+    {
+        if(reader == nullptr)
+            return;
+        reader->epoch.store(0);
+        reader->in_use.store(false, std::memory_order_release);
+    }
+};
+
+thread_local rcu_reader_owner owner;
+
+}
+
+rcu_reader& register_rcu_reader()
+{
+    if(owner.reader != nullptr)
+        return *owner.reader;
+    for(auto r = rcu_readers.load(std::memory_order_acquire); r != nullptr; r = r->next)
+    {
+        bool used = false;
+        if(!r->in_use.load(std::memory_order_relaxed) && r->in_use.compare_exchange_strong(used, true, std::memory_order_acquire))
+        {
+            r->depth = 0;
+            owner.reader = r;
+            return *r;
+        }
+    }
+    auto r = new rcu_reader;
+    r->in_use.store(true, std::memory_order_relaxed);
+    r->next = rcu_readers.load(std::memory_order_relaxed);
+    while(!rcu_readers.compare_exchange_weak(r->next, r, std::memory_order_release, std::memory_order_relaxed))
+    {
+    }
+    owner.reader = r;
+    return *r;
+}
+
+std::uint64_t advance_rcu_epoch() noexcept
+{
+    return rcu_epoch.fetch_add(1) + 1;
+}
+
+std::uint64_t oldest_rcu_reader() noexcept
+{
+    auto oldest = std::numeric_limits<std::uint64_t>::max();
+    for(auto r = rcu_readers.load(std::memory_order_acquire); r != nullptr; r = r->next)
+    {
+        const auto e = r->epoch.load();
+        if(e != 0 && e < oldest)
+            oldest = e;
+    }
+    return oldest;
+}
+
+}
+
+}
@@ -0,0 +1,222 @@
+#ifndef CHRONO_DATE_TZDB_RCU_H
+#define CHRONO_DATE_TZDB_RCU_H
+
+// Replacing a time zone database while other threads read it.
+//
+// rcu_tzdb holds the current database behind an atomic pointer. A reader
+// takes a snapshot: it announces the epoch it reads in, in a slot only its
+// own thread writes, and loads the pointer. No lock is taken and no shared
+// cache line is written. publish swaps in a new database and advances the
+// epoch; the old one is freed as soon as no reader that might have loaded
+// it is left, by the writer or by the last such reader.
+//
+// Databases date itself loads stay in its tzdb_list for the lifetime of
+// the process, so the databases swapped here are ones owned by the
+// caller, typically a tzdb_image mapped from a freshly compiled file.
+
+#include "metrics.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace chrono_date
+{
+
+namespace detail
+{
+
+// the read side state of a thread, shared by all rcu_tzdb
+struct rcu_reader
+{
+    // epoch the thread reads in, 0 if it does not read
+    std::atomic<std::uint64_t> epoch{0};
+    std::atomic<bool> in_use{false};
+    rcu_reader* next = nullptr;
+    // snapshots the thread holds, only touched by the thread itself
+    std::size_t depth = 0;
+};
+
+extern std::atomic<std::uint64_t> rcu_epoch;
+
+// slot of the calling thread, released again when the thread exits
+rcu_reader& register_rcu_reader();
+
+inline rcu_reader& this_rcu_reader()
+{
+    static thread_local rcu_reader* reader = nullptr;
+    if(reader == nullptr)
+        reader = &register_rcu_reader();
+    return *reader;
+}
+
+inline void rcu_enter(rcu_reader& r) noexcept
+{
+    if(r.depth++ == 0)
+        r.epoch.store(rcu_epoch.load());
+}
+
+inline void rcu_leave(rcu_reader& r) noexcept
+{
+    if(--r.depth == 0)
+        r.epoch.store(0, std::memory_order_release);
+}
+
+// the new epoch
+std::uint64_t advance_rcu_epoch() noexcept;
+
+// smallest epoch any thread reads in, UINT64_MAX if none reads
+std::uint64_t oldest_rcu_reader() noexcept;
+
+}
+
+template<class Database>
+class rcu_tzdb
+{
+public:
+    // a database that stays alive while the snapshot does, even if
+    // another one is published meanwhile
+    class snapshot
+    {
+    public:
+        snapshot(snapshot&& other) noexcept
+            : owner_{other.owner_}
+            , reader_{other.reader_}
+            , db_{other.db_}
+        {
+            other.owner_ = nullptr;
+        }
+
+        snapshot(const snapshot&) = delete;
+        snapshot& operator=(const snapshot&) = delete;
+        snapshot& operator=(snapshot&&) = delete;
+
+        ~snapshot()
+        {
+            if(owner_ == nullptr)
+                return;
+            detail::rcu_leave(*reader_);
+            if(reader_->depth == 0 && owner_->retired_count_.load(std::memory_order_relaxed) != 0)
+                owner_->try_collect();
+        }
+
+        const Database& operator*() const noexcept
+        {
+            return *db_;
+        }
+
+        const Database* operator->() const noexcept
+        {
+            return db_;
+        }
+
+        const Database* get() const noexcept
+        {
+            return db_;
+        }
+
+    private:
+        friend class rcu_tzdb;
+
+        snapshot(const rcu_tzdb& owner, detail::rcu_reader& reader) noexcept
+            : owner_{&owner}
+            , reader_{&reader}
+        {
+            detail::rcu_enter(reader);
+            db_ = owner.current_.load();
+        }
+
+        const rcu_tzdb* owner_;
+        detail::rcu_reader* reader_;
+        const Database* db_;
+    };
+
+    explicit rcu_tzdb(std::unique_ptr<const Database> db)
+        : current_{db.release()}
+    {
+    }
+
+    // no snapshot may outlive the rcu_tzdb
+    ~rcu_tzdb()
+    {
+        delete current_.load();
+        for(const auto& r : retired_)
+            delete r.db;
+    }
+
+    rcu_tzdb(const rcu_tzdb&) = delete;
+    rcu_tzdb& operator=(const rcu_tzdb&) = delete;
+
+    snapshot get() const
+    {
+        return snapshot{*this, detail::this_rcu_reader()};
+    }
+
+    // makes db the database of all later snapshots
+    void publish(std::unique_ptr<const Database> db)
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        count_metric(metric_counter::tzdb_publishes);
+        const auto old = current_.exchange(db.release());
+        retired_.push_back({old, detail::advance_rcu_epoch()});
+        retired_count_.store(retired_.size(), std::memory_order_relaxed);
+        collect_locked();
+    }
+
+    // frees the replaced databases no snapshot refers to any more
+    // returns the number of those still alive
+    std::size_t collect()
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        return collect_locked();
+    }
+
+    // replaced databases that are not freed yet
+    std::size_t retired() const noexcept
+    {
+        return retired_count_.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct retired_db
+    {
+        const Database* db;
+        // readers in this epoch or later loaded its successor
+        std::uint64_t epoch;
+    };
+
+    void try_collect() const
+    {
+        std::unique_lock<std::mutex> lock{mutex_, std::try_to_lock};
+        if(lock)
+            const_cast<rcu_tzdb*>(this)->collect_locked();
+    }
+
+    std::size_t collect_locked()
+    {
+        const auto oldest = detail::oldest_rcu_reader();
+        auto kept = retired_.begin();
+        for(const auto& r : retired_)
+        {
+            if(r.epoch <= oldest)
+                delete r.db;
+            else
+                *kept++ = r;
+        }
+        retired_.erase(kept, retired_.end());
+        retired_count_.store(retired_.size(), std::memory_order_relaxed);
+        return retired_.size();
+    }
+
+    std::atomic<const Database*> current_;
+    mutable std::mutex mutex_;
+    std::vector<retired_db> retired_;
+    std::atomic<std::size_t> retired_count_{0};
+};
+
+}
+
+#endif
@@ -0,0 +1,201 @@
+#ifndef CHRONO_DATE_ZONE_BASE_H
+#define CHRONO_DATE_ZONE_BASE_H
+
+// The time_zone interface of date on top of a table of transitions.
+//
+// Zone derives from zone_base<Zone> and describes its table through
+//   std::size_t      info_count() const;
+//   std::size_t      find_info(std::int64_t sys_secs) const; // index of the info containing sys_secs
+//   std::int64_t     info_begin(std::size_t i) const;        // in seconds since epoch
+//   std::int64_t     info_end(std::size_t i) const;
+//   std::int32_t     info_offset(std::size_t i) const;       // in seconds
+//   date::sys_info   info(std::size_t i) const;
+// The infos have to be ordered and contiguous, and there has to be at least one.
+// The resulting type can be used as TimeZonePtr target of date::zoned_time
+// and behaves like date::time_zone, including its exceptions and choose.
+//
+// A table covers [table_begin(), table_end()), from the begin of its first
+// to the end of its last info. Times outside of it throw
+// std::runtime_error instead of continuing the first or last offset,
+// which would silently drop the transitions the table does not know.
+
+#include "metrics.h"
+#include <date/date.h>
+#include <date/tz.h>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+
+namespace chrono_date
+{
+
+template<class Zone>
+class zone_base
+{
+public:
+    constexpr date::sys_seconds table_begin() const
+    {
+        return date::sys_seconds{std::chrono::seconds{zone().info_begin(0)}};
+    }
+
+    constexpr date::sys_seconds table_end() const
+    {
+        return date::sys_seconds{std::chrono::seconds{zone().info_end(zone().info_count() - 1)}};
+    }
+
+    template<class Duration>
+    date::sys_info get_info(date::sys_time<Duration> st) const
+    {
+        count_metric(metric_counter::zone_info_lookups);
+        const auto s = date::floor<std::chrono::seconds>(st).time_since_epoch().count();
+        return zone().info(covered_info(s));
+    }
+
+    template<class Duration>
+    date::local_info get_info(date::local_time<Duration> tp) const
+    {
+        count_metric(metric_counter::zone_info_lookups);
+        return local_info_at(date::floor<std::chrono::seconds>(tp).time_since_epoch().count());
+    }
+
+    // to_sys and to_local only use the index based part of Zone, so they
+    // are constant expressions for a Zone whose table is one
+    template<class Duration>
+    constexpr date::sys_time<typename std::common_type<Duration, std::chrono::seconds>::type>
+    to_sys(date::local_time<Duration> tp) const
+    {
+        const auto t = date::floor<std::chrono::seconds>(tp).time_since_epoch().count();
+        const auto l = find_local(t);
+        if(l.result == date::local_info::nonexistent)
+            throw date::nonexistent_local_time(tp, local_info_at(t));
+        if(l.result == date::local_info::ambiguous)
+            throw date::ambiguous_local_time(tp, local_info_at(t));
+        return to_sys_impl(tp, std::chrono::seconds{zone().info_offset(l.first)});
+    }
+
+    template<class Duration>
+    constexpr date::sys_time<typename std::common_type<Duration, std::chrono::seconds>::type>
+    to_sys(date::local_time<Duration> tp, date::choose z) const
+    {
+        using CT = typename std::common_type<Duration, std::chrono::seconds>::type;
+        const auto l = find_local(date::floor<std::chrono::seconds>(tp).time_since_epoch().count());
+        if(l.result == date::local_info::nonexistent)
+            return date::sys_time<CT>{std::chrono::seconds{zone().info_end(l.first)}};
+        if(l.result == date::local_info::ambiguous && z == date::choose::latest)
+            return to_sys_impl(tp, std::chrono::seconds{zone().info_offset(l.second)});
+        return to_sys_impl(tp, std::chrono::seconds{zone().info_offset(l.first)});
+    }
+
+    template<class Duration>
+    constexpr date::local_time<typename std::common_type<Duration, std::chrono::seconds>::type>
+    to_local(date::sys_time<Duration> tp) const
+    {
+        using CT = typename std::common_type<Duration, std::chrono::seconds>::type;
+        const auto s = date::floor<std::chrono::seconds>(tp).time_since_epoch().count();
+        const auto offset = std::chrono::seconds{zone().info_offset(covered_info(s))};
+        return date::local_time<CT>{tp.time_since_epoch() + offset};
+    }
+
+protected:
+    ~zone_base() = default;
+
+    // index based part of get_info(local_time)
+    // first and second are indices into the table, second is only valid
+    // for nonexistent and ambiguous results
+    struct local_lookup
+    {
+        decltype(date::local_info::unique) result;
+        std::size_t first;
+        std::size_t second;
+    };
+
+    constexpr local_lookup find_local(std::int64_t t) const
+    {
+        // no offset is larger than 26 hours, so only infos ending after
+        // t - 26h or beginning before t + 26h can contain t
+        constexpr std::int64_t max_offset = 26 * 3600;
+        const auto& z = zone();
+        const auto k = z.find_info(t);
+        auto lo = k;
+        while(lo > 0 && z.info_end(lo - 1) > t - max_offset)
+            --lo;
+        auto hi = k;
+        while(hi + 1 < z.info_count() && z.info_begin(hi + 1) <= t + max_offset)
+            ++hi;
+
+        local_lookup r{date::local_info::nonexistent, k, k};
+        std::size_t found = 0;
+        for(auto i = lo; i <= hi; ++i)
+        {
+            const auto u = t - z.info_offset(i);
+            if(z.info_begin(i) <= u && u < z.info_end(i))
+            {
+                if(found++ == 0)
+                    r.first = i;
+                else
+                    r.second = i;
+            }
+        }
+        if(found == 1)
+            r.result = date::local_info::unique;
+        else if(found > 1)
+            r.result = date::local_info::ambiguous;
+        else
+        {
+            // t falls into the gap between the last info it is past and the next one
+            for(auto i = lo; i < hi; ++i)
+            {
+                if(t - z.info_offset(i) >= z.info_end(i) && t - z.info_offset(i + 1) < z.info_begin(i + 1))
+                {
+                    r.first = i;
+                    r.second = i + 1;
+                    return r;
+                }
+            }
+            // before the first or after the last info of the table
+            throw std::runtime_error("local time outside of the time zone table");
+        }
+        return r;
+    }
+
+    // find_info, throws if the table does not cover sys_secs
+    constexpr std::size_t covered_info(std::int64_t sys_secs) const
+    {
+        const auto& z = zone();
+        if(sys_secs < z.info_begin(0) || sys_secs >= z.info_end(z.info_count() - 1))
+            throw std::runtime_error("time outside of the time zone table");
+        return z.find_info(sys_secs);
+    }
+
+    date::local_info local_info_at(std::int64_t t) const
+    {
+        const auto& z = zone();
+        const auto l = find_local(t);
+        date::local_info i{};
+        i.result = l.result;
+        i.first = z.info(l.first);
+        if(l.result != date::local_info::unique)
+            i.second = z.info(l.second);
+        return i;
+    }
+
+private:
+    constexpr const Zone& zone() const
+    {
+        return static_cast<const Zone&>(*this);
+    }
+
+    template<class Duration>
+    static constexpr date::sys_time<typename std::common_type<Duration, std::chrono::seconds>::type>
+    to_sys_impl(date::local_time<Duration> tp, std::chrono::seconds offset)
+    {
+        using CT = typename std::common_type<Duration, std::chrono::seconds>::type;
+        return date::sys_time<CT>{tp.time_since_epoch() - offset};
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,199 @@
+#ifndef CHRONO_DATE_ZONE_PAIR_CONVERTER_H
+#define CHRONO_DATE_ZONE_PAIR_CONVERTER_H
+
+// Conversion of local times of one zone to local times of another.
+//
+// make_zoned(to, make_zoned(from, tp).get_sys_time()).get_local_time()
+// looks up both zones for every time point. zone_pair_converter merges
+// the transitions of both zones over a range of time once, into segments
+// of local time of from. Within a segment every local time is either
+// unique and shifted by the same amount, or in the same gap, or in the
+// same fold, so converting it is a branchless binary search over the
+// segments and one addition.
+//
+// Results are those of make_zoned, including the exceptions for
+// nonexistent and ambiguous local times, which the overload taking a
+// local_result reports instead. Local times outside of the range are
+// converted through the zones.
+
+#include <date/date.h>
+#include <date/tz.h>
+#include "local_to_sys.h"
+#include "metrics.h"
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace chrono_date
+{
+
+// TimeZonePtr is anything usable as the zone of a date::zoned_time
+template<class TimeZonePtr>
+class zone_pair_converter
+{
+public:
+    // local times of from that map to sys times in [first, last]
+    zone_pair_converter(TimeZonePtr from, TimeZonePtr to, date::sys_seconds first, date::sys_seconds last)
+        : from_(std::move(from))
+        , to_(std::move(to))
+    {
+        // a segment begins where the offset of from changes, in local time
+        // before and after the change, and where the offset of to changes
+        // at the sys time it changes; changes just outside of the range
+        // still cut the local times at its ends
+        const auto margin = std::chrono::hours{26};
+        const auto front = count(first) + from_->get_info(first).offset.count();
+        const auto back = count(last) + from_->get_info(last).offset.count() + 1;
+        std::vector<std::int64_t> edges{front, back};
+        for(auto i = from_->get_info(first - margin); i.end <= last + margin;)
+        {
+            const auto next = from_->get_info(i.end);
+            edges.push_back(count(i.end) + i.offset.count());
+            edges.push_back(count(i.end) + next.offset.count());
+            i = next;
+        }
+        for(auto i = to_->get_info(first - margin); i.end <= last + margin; i = to_->get_info(i.end))
+            edges.push_back(count(i.end) + from_->get_info(i.end).offset.count());
+        edges.erase(std::remove_if(edges.begin(), edges.end(), [=](std::int64_t e) { return e < front || e > back; }),
+                    edges.end());
+        std::sort(edges.begin(), edges.end());
+        edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+        edges_ = std::move(edges);
+        segments_.reserve(edges_.size() - 1);
+        for(std::size_t s = 0; s + 1 < edges_.size(); ++s)
+            segments_.push_back(make_segment(edges_[s]));
+    }
+
+    // make_zoned(to, make_zoned(from, tp)).get_local_time()
+    template<class Duration>
+    date::local_time<typename std::common_type<Duration, std::chrono::seconds>::type>
+    to_local(date::local_time<Duration> tp) const
+    {
+        local_result r;
+        const auto lt = to_local(tp, date::choose::earliest, r);
+        if(r != local_result::unique)
+            count_metric(metric_counter::local_time_exceptions);
+        if(r == local_result::nonexistent)
+            throw date::nonexistent_local_time(tp, from_->get_info(tp));
+        if(r == local_result::ambiguous)
+            throw date::ambiguous_local_time(tp, from_->get_info(tp));
+        return lt;
+    }
+
+    // make_zoned(to, make_zoned(from, tp, c)).get_local_time()
+    template<class Duration>
+    date::local_time<typename std::common_type<Duration, std::chrono::seconds>::type>
+    to_local(date::local_time<Duration> tp, date::choose c) const
+    {
+        local_result r;
+        return to_local(tp, c, r);
+    }
+
+    // the same, with the kind of local time of from in r
+    template<class Duration>
+    date::local_time<typename std::common_type<Duration, std::chrono::seconds>::type>
+    to_local(date::local_time<Duration> tp, date::choose c, local_result& r) const
+    {
+        using CT = typename std::common_type<Duration, std::chrono::seconds>::type;
+        const auto lt = date::floor<std::chrono::seconds>(tp).time_since_epoch().count();
+        if(lt < edges_.front() || lt >= edges_.back())
+        {
+            count_metric(metric_counter::zone_pair_fallbacks);
+            return convert(tp, c, r);
+        }
+        // branchless, random input would mispredict half of the steps
+        const std::int64_t* base = edges_.data();
+        auto n = edges_.size() - 1;
+        while(n > 1)
+        {
+            const auto half = n / 2;
+            base = base[half] <= lt ? base + half : base;
+            n -= half;
+        }
+        const auto& seg = segments_[static_cast<std::size_t>(base - edges_.data())];
+        r = seg.result;
+        count_metric(metric_counter::nonexistent_local_times, seg.result == local_result::nonexistent);
+        count_metric(metric_counter::ambiguous_local_times, seg.result == local_result::ambiguous);
+        const auto shift = std::chrono::seconds{c == date::choose::latest ? seg.latest : seg.earliest};
+        if(seg.result == local_result::nonexistent)
+            return date::local_time<CT>{shift};
+        return date::local_time<CT>{tp.time_since_epoch() + shift};
+    }
+
+    // number of segments the range was cut into
+    std::size_t size() const noexcept
+    {
+        return segments_.size();
+    }
+
+private:
+    // what to add to a local time of from for either choice, for
+    // nonexistent local times the local time of to itself
+    struct segment
+    {
+        std::int64_t earliest;
+        std::int64_t latest;
+        local_result result;
+    };
+
+    static std::int64_t count(date::sys_seconds s)
+    {
+        return s.time_since_epoch().count();
+    }
+
+    std::int64_t shift(const date::sys_info& from, std::int64_t local) const
+    {
+        const auto st = date::sys_seconds{std::chrono::seconds{local} - from.offset};
+        return to_->get_info(st).offset.count() - from.offset.count();
+    }
+
+    segment make_segment(std::int64_t local) const
+    {
+        const auto i = from_->get_info(date::local_seconds{std::chrono::seconds{local}});
+        if(i.result == date::local_info::nonexistent)
+        {
+            const auto at = count(i.first.end) + to_->get_info(i.first.end).offset.count();
+            return segment{at, at, local_result::nonexistent};
+        }
+        if(i.result == date::local_info::ambiguous)
+            return segment{shift(i.first, local), shift(i.second, local), local_result::ambiguous};
+        const auto s = shift(i.first, local);
+        return segment{s, s, local_result::unique};
+    }
+
+    template<class Duration>
+    date::local_time<typename std::common_type<Duration, std::chrono::seconds>::type>
+    convert(date::local_time<Duration> tp, date::choose c, local_result& r) const
+    {
+        const auto i = from_->get_info(tp);
+        r = i.result == date::local_info::nonexistent ? local_result::nonexistent
+          : i.result == date::local_info::ambiguous ? local_result::ambiguous
+          : local_result::unique;
+        count_metric(metric_counter::nonexistent_local_times, r == local_result::nonexistent);
+        count_metric(metric_counter::ambiguous_local_times, r == local_result::ambiguous);
+        const auto st = from_->to_sys(tp, c);
+        return to_->to_local(st);
+    }
+
+    TimeZonePtr from_;
+    TimeZonePtr to_;
+    // begin of every segment and the end of the last one, in local seconds of from
+    std::vector<std::int64_t> edges_;
+    std::vector<segment> segments_;
+};
+
+template<class TimeZonePtr>
+zone_pair_converter<TimeZonePtr>
+make_zone_pair_converter(TimeZonePtr from, TimeZonePtr to, date::sys_seconds first, date::sys_seconds last)
+{
+    return zone_pair_converter<TimeZonePtr>{std::move(from), std::move(to), first, last};
+}
+
+}
+
+#endif
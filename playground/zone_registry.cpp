@@ -0,0 +1,313 @@
+#include "zone_registry.h"
+#include "metrics.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace chrono_date
+{
+
+namespace
+{
+
+// 64 bit FNV-1a; the two halves seed the slot search of the perfect hash
+std::uint64_t hash_name(const char* s, std::size_t n) noexcept
+{
+    std::uint64_t h = 14695981039346656037ull;
+    for(std::size_t i = 0; i < n; ++i)
+    {
+        h ^= static_cast<unsigned char>(s[i]);
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+std::uint64_t hash_name(const std::string& s) noexcept
+{
+    return hash_name(s.data(), s.size());
+}
+
+std::size_t round_up_pow2(std::size_t n) noexcept
+{
+    std::size_t p = 1;
+    while(p < n)
+        p <<= 1;
+    return p;
+}
+
+// slot of a key in a table of mask + 1 slots for displacement d
+std::size_t probe(std::uint64_t hash, std::uint32_t d, std::size_t mask) noexcept
+{
+    const auto lo = static_cast<std::uint32_t>(hash);
+    const auto hi = static_cast<std::uint32_t>(hash >> 32) | 1;
+    return (lo + d * hi) & mask;
+}
+
+}
+
+// Hash and displace: keys are grouped into buckets by their hash, and the
+// buckets, largest first, each get the smallest displacement that moves all
+// of their keys to free slots. A lookup then needs the displacement of its
+// bucket and exactly one slot.
+zone_registry::zone_registry(const date::tzdb& db, const zone_registry* older)
+    : db_{&db}
+{
+    // every name that ever had an id, also those of zones older removed
+    std::unordered_map<std::string, std::uint16_t> known;
+    if(older != nullptr)
+    {
+        names_ = older->names_;
+        for(std::size_t id = 0; id < names_.size(); ++id)
+            known.emplace(*names_[id], static_cast<std::uint16_t>(id));
+    }
+    ids_.resize(db.zones.size());
+    for(std::size_t i = 0; i < db.zones.size(); ++i)
+    {
+        const auto& name = db.zones[i].name();
+        const auto k = known.find(name);
+        if(k != known.end())
+            ids_[i] = k->second;
+        else
+        {
+            if(names_.size() >= zone_handle::invalid_id)
+                throw std::runtime_error("too many zones to intern");
+            ids_[i] = static_cast<std::uint16_t>(names_.size());
+            names_.push_back(&name);
+        }
+    }
+    zones_.assign(names_.size(), nullptr);
+    for(std::size_t i = 0; i < db.zones.size(); ++i)
+        zones_[ids_[i]] = &db.zones[i];
+
+    struct key
+    {
+        const std::string* name;
+        std::uint16_t id;
+        std::uint64_t hash;
+    };
+    std::vector<key> keys;
+    for(std::size_t i = 0; i < db.zones.size(); ++i)
+    {
+        const auto& name = db.zones[i].name();
+        keys.push_back({&name, ids_[i], hash_name(name)});
+    }
+    for(const auto& link : db.links)
+    {
+        const auto id = intern(db.locate_zone(link.target()));
+        keys.push_back({&link.name(), id.id(), hash_name(link.name())});
+    }
+
+    const auto bucket_count = std::max<std::size_t>(1, keys.size() / 4);
+    for(auto table_size = round_up_pow2(keys.size() + keys.size() / 4);; table_size *= 2)
+    {
+        std::vector<std::vector<const key*>> buckets(bucket_count);
+        for(const auto& k : keys)
+            buckets[(k.hash >> 32) % bucket_count].push_back(&k);
+        std::vector<std::size_t> order(bucket_count);
+        for(std::size_t i = 0; i < bucket_count; ++i)
+            order[i] = i;
+        std::stable_sort(order.begin(), order.end(),
+                         [&](std::size_t a, std::size_t b)
+                         {
+                             return buckets[a].size() > buckets[b].size();
+                         });
+
+        displacements_.assign(bucket_count, 0);
+        slots_.assign(table_size, slot{nullptr, zone_handle::invalid_id});
+        const auto mask = table_size - 1;
+        bool placed_all = true;
+        for(const auto b : order)
+        {
+            const auto& bucket = buckets[b];
+            bool placed = false;
+            for(std::uint32_t d = 0; d < table_size * 4 && !placed; ++d)
+            {
+                std::vector<std::size_t> taken;
+                placed = true;
+                for(const auto k : bucket)
+                {
+                    const auto s = probe(k->hash, d, mask);
+                    if(slots_[s].name != nullptr || std::find(taken.begin(), taken.end(), s) != taken.end())
+                    {
+                        placed = false;
+                        break;
+                    }
+                    taken.push_back(s);
+                }
+                if(placed)
+                {
+                    displacements_[b] = d;
+                    for(std::size_t i = 0; i < bucket.size(); ++i)
+                        slots_[taken[i]] = slot{bucket[i]->name, bucket[i]->id};
+                }
+            }
+            if(!placed)
+            {
+                placed_all = false;
+                break;
+            }
+        }
+        if(placed_all)
+            break;
+    }
+}
+
+std::size_t zone_registry::slot_of(std::uint64_t hash) const noexcept
+{
+    const auto d = displacements_[(hash >> 32) % displacements_.size()];
+    return probe(hash, d, slots_.size() - 1);
+}
+
+zone_handle zone_registry::find(const std::string& name) const noexcept
+{
+    count_metric(metric_counter::zone_lookups);
+    const auto& s = slots_[slot_of(hash_name(name))];
+    if(s.name == nullptr || *s.name != name)
+    {
+        count_metric(metric_counter::zone_lookup_failures);
+        return zone_handle{};
+    }
+    return zone_handle{s.id};
+}
+
+zone_handle zone_registry::intern(const std::string& name) const
+{
+    const auto h = find(name);
+    if(!h)
+        throw std::runtime_error(name + " not found in timezone database");
+    return h;
+}
+
+zone_handle zone_registry::intern(const date::time_zone* zone) const noexcept
+{
+    const auto first = db_->zones.data();
+    if(zone < first || zone >= first + db_->zones.size())
+        return zone_handle{};
+    return zone_handle{ids_[static_cast<std::size_t>(zone - first)]};
+}
+
+namespace
+{
+
+// registries of every tzdb that was current, newest first; like the
+// tzdb_list they are never freed, so references to them stay valid
+struct registry_node
+{
+    explicit registry_node(const date::tzdb& db, const registry_node* older)
+        : registry{db, older != nullptr ? &older->registry : nullptr}
+        , next{older}
+    {
+    }
+
+    const zone_registry registry;
+    const registry_node* const next;
+};
+
+std::atomic<const registry_node*> registries{nullptr};
+std::mutex registries_mutex;
+
+// the first call of date::get_tzdb() parses the text database
+const date::tzdb& timed_get_tzdb()
+{
+    static const bool loaded = []
+    {
+        metric_timer timer{metric_histogram::tzdb_load};
+        date::get_tzdb();
+        return true;
+    }();
+    static_cast<void>(loaded);
+    return date::get_tzdb();
+}
+
+}
+
+const zone_registry& get_zone_registry()
+{
+    const auto& db = timed_get_tzdb();
+    auto node = registries.load(std::memory_order_acquire);
+    if(node != nullptr && &node->registry.tzdb() == &db)
+        return node->registry;
+
+    std::lock_guard<std::mutex> lock{registries_mutex};
+    node = registries.load(std::memory_order_relaxed);
+    for(auto n = node; n != nullptr; n = n->next)
+    {
+        if(&n->registry.tzdb() == &db)
+            return n->registry;
+    }
+    metric_timer timer{metric_histogram::zone_registry_build};
+    node = new registry_node{db, node};
+    registries.store(node, std::memory_order_release);
+    return node->registry;
+}
+
+const date::time_zone* zone_handle::get() const
+{
+    return get_zone_registry().zone(*this);
+}
+
+namespace
+{
+
+// most recently used names of a thread, searched front to back
+// a miss replaces the least recently used entry
+struct intern_cache
+{
+    static constexpr std::size_t size = 8;
+
+    // the names were resolved in this registry, the cache is dropped
+    // when another one becomes current
+    const zone_registry* registry = nullptr;
+
+    std::array<std::string, size> names;
+    std::array<zone_handle, size> handles;
+    std::size_t used = 0;
+    intern_cache_stats stats{0, 0};
+};
+
+thread_local intern_cache cache;
+
+}
+
+zone_handle intern_zone(const std::string& name)
+{
+    auto& c = cache;
+    const auto& registry = get_zone_registry();
+    if(c.registry != &registry)
+    {
+        c.registry = &registry;
+        c.used = 0;
+    }
+    for(std::size_t i = 0; i < c.used; ++i)
+    {
+        if(c.names[i] == name)
+        {
+            ++c.stats.hits;
+            count_metric(metric_counter::intern_cache_hits);
+            const auto h = c.handles[i];
+            std::rotate(c.names.begin(), c.names.begin() + i, c.names.begin() + i + 1);
+            std::rotate(c.handles.begin(), c.handles.begin() + i, c.handles.begin() + i + 1);
+            return h;
+        }
+    }
+    ++c.stats.misses;
+    count_metric(metric_counter::intern_cache_misses);
+    const auto h = registry.intern(name);
+    if(c.used < intern_cache::size)
+        ++c.used;
+    std::rotate(c.names.begin(), c.names.begin() + c.used - 1, c.names.begin() + c.used);
+    std::rotate(c.handles.begin(), c.handles.begin() + c.used - 1, c.handles.begin() + c.used);
+    c.names[0] = name;
+    c.handles[0] = h;
+    return h;
+}
+
+intern_cache_stats intern_zone_cache_stats() noexcept
+{
+    return cache.stats;
+}
+
+}
@@ -0,0 +1,209 @@
+#ifndef CHRONO_DATE_ZONE_REGISTRY_H
+#define CHRONO_DATE_ZONE_REGISTRY_H
+
+// Interned time zones.
+//
+// A zone_handle is the 16 bit id of a zone name. Links get the id of their
+// target. zone_registry resolves names to ids with a perfect hash table
+// that is built once per tzdb, so a lookup costs one hash and one string
+// compare, and ids to zones with an array.
+//
+// get_zone_registry follows date::get_tzdb(): after date::reload_tzdb()
+// it builds the table of the new database on first use. Ids are those of
+// the registry before it, so a zone keeps its id for the whole process
+// and handles stored before a reload, also inside packed_zoned_times,
+// name the same zone after it. Zones the new database added get new ids,
+// and those of zones it removed throw std::runtime_error.
+//
+// intern_zone in addition keeps the names a thread resolved last, so that
+// looking up the same few names over and over does not even hash them.
+
+#include "metrics.h"
+#include <date/tz.h>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace chrono_date
+{
+
+class zone_handle
+{
+public:
+    static constexpr std::uint16_t invalid_id = UINT16_MAX;
+
+    constexpr zone_handle() noexcept
+        : id_{invalid_id}
+    {
+    }
+
+    constexpr explicit zone_handle(std::uint16_t id) noexcept
+        : id_{id}
+    {
+    }
+
+    constexpr std::uint16_t id() const noexcept
+    {
+        return id_;
+    }
+
+    constexpr bool valid() const noexcept
+    {
+        return id_ != invalid_id;
+    }
+
+    constexpr explicit operator bool() const noexcept
+    {
+        return valid();
+    }
+
+    // the zone in the registry of the current tzdb, throws
+    // std::runtime_error if it has none of this id
+    const date::time_zone* get() const;
+
+    const date::time_zone* operator->() const
+    {
+        return get();
+    }
+
+    friend constexpr bool operator==(zone_handle a, zone_handle b) noexcept
+    {
+        return a.id_ == b.id_;
+    }
+
+    friend constexpr bool operator!=(zone_handle a, zone_handle b) noexcept
+    {
+        return a.id_ != b.id_;
+    }
+
+    friend constexpr bool operator<(zone_handle a, zone_handle b) noexcept
+    {
+        return a.id_ < b.id_;
+    }
+
+private:
+    std::uint16_t id_;
+};
+
+class zone_registry
+{
+public:
+    // builds the name table of db, which has to outlive the registry like
+    // the databases of older; zones get the ids their names have in
+    // older, new names the next free ones, and without older their index
+    // in db.zones
+    explicit zone_registry(const date::tzdb& db, const zone_registry* older = nullptr);
+
+    const date::tzdb& tzdb() const noexcept
+    {
+        return *db_;
+    }
+
+    // number of ids, handles are in [0, size()); more than the zones if
+    // an older database had zones this one does not
+    std::size_t size() const noexcept
+    {
+        return zones_.size();
+    }
+
+    // invalid handle if there is no zone or link of that name
+    zone_handle find(const std::string& name) const noexcept;
+
+    // like find, but throws std::runtime_error like date::locate_zone
+    zone_handle intern(const std::string& name) const;
+
+    // handle of a zone of tzdb(), invalid handle for any other zone
+    zone_handle intern(const date::time_zone* zone) const noexcept;
+
+    // throws std::runtime_error for an invalid handle, for ids no
+    // registry gave out and for zones tzdb() no longer has
+    const date::time_zone* zone(zone_handle h) const
+    {
+        if(!h || h.id() >= zones_.size() || zones_[h.id()] == nullptr)
+            throw std::runtime_error("zone handle is not one of the timezone database");
+        return zones_[h.id()];
+    }
+
+private:
+    struct slot
+    {
+        const std::string* name;
+        std::uint16_t id;
+    };
+
+    std::size_t slot_of(std::uint64_t hash) const noexcept;
+
+    const date::tzdb* db_;
+    // name and zone of every id, nullptr for removed zones, and the id
+    // of every zone; the names of older databases stay alive with them
+    std::vector<const std::string*> names_;
+    std::vector<const date::time_zone*> zones_;
+    std::vector<std::uint16_t> ids_;
+    std::vector<std::uint32_t> displacements_;
+    std::vector<slot> slots_;
+};
+
+// registry of date::get_tzdb(), built on the first use of every tzdb;
+// registries are never freed
+const zone_registry& get_zone_registry();
+
+// get_zone_registry().intern(name) with a per thread cache of recent names
+zone_handle intern_zone(const std::string& name);
+
+struct intern_cache_stats
+{
+    std::uint64_t hits;
+    std::uint64_t misses;
+};
+
+// cache statistics of the calling thread
+intern_cache_stats intern_zone_cache_stats() noexcept;
+
+template<class Duration>
+date::zoned_time<typename std::common_type<Duration, std::chrono::seconds>::type>
+make_zoned(zone_handle zone, const date::local_time<Duration>& tp)
+{
+    count_metric(metric_counter::zoned_times);
+#if CHRONO_DATE_METRICS
+    try
+    {
+        return date::make_zoned(zone.get(), tp);
+    }
+    catch(const date::nonexistent_local_time&)
+    {
+        count_metric(metric_counter::local_time_exceptions);
+        throw;
+    }
+    catch(const date::ambiguous_local_time&)
+    {
+        count_metric(metric_counter::local_time_exceptions);
+        throw;
+    }
+#else
+    return date::make_zoned(zone.get(), tp);
+#endif
+}
+
+template<class Duration>
+date::zoned_time<typename std::common_type<Duration, std::chrono::seconds>::type>
+make_zoned(zone_handle zone, const date::local_time<Duration>& tp, date::choose c)
+{
+    count_metric(metric_counter::zoned_times);
+    return date::make_zoned(zone.get(), tp, c);
+}
+
+template<class Duration>
+date::zoned_time<typename std::common_type<Duration, std::chrono::seconds>::type>
+make_zoned(zone_handle zone, const date::sys_time<Duration>& tp)
+{
+    count_metric(metric_counter::zoned_times);
+    return date::make_zoned(zone.get(), tp);
+}
+
+}
+
+#endif